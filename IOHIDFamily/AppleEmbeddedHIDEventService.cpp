@@ -65,7 +65,7 @@ void AppleEmbeddedHIDEventService::dispatchAccelerometerEvent(AbsoluteTime times
     IOHIDEvent * event = IOHIDEvent::accelerometerEvent(timestamp, x, y, z, type, subType, sequence, options);
     
     if ( event ) {
-        dispatchEvent(event);
+        dispatchBatchedEvent(event);
         event->release();
     }
 }
@@ -79,7 +79,7 @@ void AppleEmbeddedHIDEventService::dispatchGyroEvent(AbsoluteTime timestamp, IOF
     IOHIDEvent * event = IOHIDEvent::gyroEvent(timestamp, x, y, z, type, subType, sequence, options);
     
     if ( event ) {
-        dispatchEvent(event);
+        dispatchBatchedEvent(event);
         event->release();
     }
 }
@@ -92,7 +92,7 @@ void AppleEmbeddedHIDEventService::dispatchCompassEvent(AbsoluteTime timestamp,
     IOHIDEvent * event = IOHIDEvent::compassEvent(timestamp, x, y, z, type, subType, sequence, options);
     
     if ( event ) {
-        dispatchEvent(event);
+        dispatchBatchedEvent(event);
         event->release();
     }
 }
@@ -172,7 +172,7 @@ void AppleEmbeddedHIDEventService::dispatchVendorDefinedEvent(AbsoluteTime timeS
     IOHIDEvent * event = IOHIDEvent::vendorDefinedEvent(timeStamp, usagePage, usage, version, data, length, options);
     
     if ( event ) {
-        dispatchEvent(event);
+        dispatchBatchedEvent(event);
         event->release();
     }
 }
@@ -34,6 +34,7 @@
 #include "IOHIDFamilyPrivate.h"
 #include "IOHIDDevice.h"
 #include "IOHIDElementPrivate.h"
+#include "IOHIDEventQueue.h"
 #include "IOHIDParserPriv.h"
 #include "IOHIDInterface.h"
 #include "IOHIDPrivateKeys.h"
@@ -45,6 +46,7 @@
 
 #include <sys/queue.h>
 #include <machine/limits.h>
+#include <libkern/crypto/sha1.h>
 
 #if !TARGET_OS_EMBEDDED
 #include "IOHIKeyboard.h"
@@ -57,6 +59,20 @@
 
 //===========================================================================
 // IOHIDAsyncReportQueue class
+//
+// Reports are copied into a fixed ring of cache line aligned slots that is
+// allocated once, when the queue is created.  Reports that do not fit in a
+// slot, or that arrive while the ring is full, spill over into a heap list
+// that is drained after the ring so that submission order is preserved.
+//
+// Devices that set kIOHIDAsyncReportCoalescingKey let a new report be merged
+// into the newest report that is still waiting to be delivered, rather than
+// queueing behind it, as long as the device's elements allow it.
+
+#define kAsyncReportQueueSlots          32
+#define kAsyncReportQueueBatchSize      8
+#define kAsyncReportQueueMinSlotSize    64
+#define kAsyncReportQueueAlignment      64
 
 class IOHIDAsyncReportQueue : public IOEventSource
 {
@@ -77,13 +93,36 @@ class IOHIDAsyncReportQueue : public IOEventSource
     IOLock *        fQueueLock;
     queue_head_t    fQueueHead;
 
+    uint8_t *                   fRing;
+    UInt32                      fRingSize;
+    UInt32                      fSlotSize;
+    UInt32                      fSlotStride;
+    UInt32                      fHead;
+    UInt32                      fTail;
+    bool                        fConsuming;
+    bool                        fStopped;
+    IOBufferMemoryDescriptor *  fReportDescriptor;
+    uint8_t *                   fCoalesceBuffer;
+
+    AsyncReportEntry *  getSlot(UInt32 index);
+    AsyncReportEntry *  getPendingTail();
+    void                processEntry(AsyncReportEntry * entry);
+    bool                coalesceReport(AbsoluteTime         timeStamp,
+                                       IOMemoryDescriptor * report,
+                                       IOHIDReportType      reportType,
+                                       IOOptionBits         options);
+
 public:
-    static IOHIDAsyncReportQueue *withOwner(IOHIDDevice *inOwner);
+    static IOHIDAsyncReportQueue *withOwner(IOHIDDevice *inOwner, UInt32 slotSize);
 
-    virtual bool init(IOHIDDevice *owner);
+    virtual bool init(IOHIDDevice *owner, UInt32 slotSize);
+
+    virtual void free();
 
     virtual bool checkForWork();
 
+    void abortReports();
+
     virtual IOReturn postReport(AbsoluteTime         timeStamp,
                                 IOMemoryDescriptor * report,
                                 IOHIDReportType      reportType,
@@ -95,14 +134,14 @@ public:
 OSDefineMetaClassAndStructors( IOHIDAsyncReportQueue, IOEventSource )
 
 //---------------------------------------------------------------------------
-IOHIDAsyncReportQueue *IOHIDAsyncReportQueue::withOwner(IOHIDDevice *inOwner)
+IOHIDAsyncReportQueue *IOHIDAsyncReportQueue::withOwner(IOHIDDevice *inOwner, UInt32 slotSize)
 {
     IOHIDAsyncReportQueue *es = NULL;
     bool result = false;
 
     es = OSTypeAlloc( IOHIDAsyncReportQueue );
     if (es) {
-        result = es->init( inOwner/*, inAction*/ );
+        result = es->init( inOwner, slotSize );
 
         if (!result) {
             es->release();
@@ -115,53 +154,259 @@ IOHIDAsyncReportQueue *IOHIDAsyncReportQueue::withOwner(IOHIDDevice *inOwner)
 }
 
 //---------------------------------------------------------------------------
-bool IOHIDAsyncReportQueue::init(IOHIDDevice *owner_I)
+bool IOHIDAsyncReportQueue::init(IOHIDDevice *owner_I, UInt32 slotSize)
 {
     queue_init( &fQueueHead );
+
+    if (!IOEventSource::init(owner_I/*, action*/))
+        return false;
+
     fQueueLock = IOLockAlloc();
-    return IOEventSource::init(owner_I/*, action*/);
+    if (!fQueueLock)
+        return false;
+
+    fSlotSize   = max(slotSize, kAsyncReportQueueMinSlotSize);
+    fSlotStride = (sizeof(AsyncReportEntry) + fSlotSize + kAsyncReportQueueAlignment - 1) & ~(kAsyncReportQueueAlignment - 1);
+    fRingSize   = fSlotStride * kAsyncReportQueueSlots;
+
+    fRing = (uint8_t *)IOMallocAligned(fRingSize, kAsyncReportQueueAlignment);
+    if (!fRing)
+        return false;
+
+    bzero(fRing, fRingSize);
+
+    fReportDescriptor = IOBufferMemoryDescriptor::withCapacity(fSlotSize, kIODirectionOut);
+    if (!fReportDescriptor)
+        return false;
+
+    OSObject *coalesce = owner_I->copyProperty(kIOHIDAsyncReportCoalescingKey);
+
+    // Holds the incoming report followed by the merged result.
+    if (coalesce == kOSBooleanTrue)
+        fCoalesceBuffer = (uint8_t *)IOMalloc(fSlotSize * 2);
+
+    OSSafeReleaseNULL(coalesce);
+
+    return true;
 }
 
 //---------------------------------------------------------------------------
-bool IOHIDAsyncReportQueue::checkForWork()
+void IOHIDAsyncReportQueue::free()
 {
-    bool moreToDo = false;
+    if (fQueueLock)
+        abortReports();
+
+    if (fReportDescriptor) {
+        fReportDescriptor->release();
+        fReportDescriptor = NULL;
+    }
+
+    if (fCoalesceBuffer) {
+        IOFree(fCoalesceBuffer, fSlotSize * 2);
+        fCoalesceBuffer = NULL;
+    }
+
+    if (fRing) {
+        IOFreeAligned(fRing, fRingSize);
+        fRing = NULL;
+    }
+
+    if (fQueueLock) {
+        IOLockFree(fQueueLock);
+        fQueueLock = NULL;
+    }
+
+    IOEventSource::free();
+}
+
+//---------------------------------------------------------------------------
+// Stops accepting reports and completes everything still queued with
+// kIOReturnAborted, so that submitters can release the resources they
+// attached to the completion. Must not run concurrently with checkForWork,
+// so the queue has to be off the workloop.
+
+void IOHIDAsyncReportQueue::abortReports()
+{
+    AsyncReportEntry *  entry;
+    queue_head_t        pending;
+    UInt32              head;
+    UInt32              tail;
+
+    queue_init(&pending);
 
     IOLockLock(fQueueLock);
-    if (!queue_empty(&fQueueHead)) {
 
-        AsyncReportEntry *entry = NULL;
+    fStopped = true;
+
+    head  = fHead;
+    tail  = fTail;
+    fHead = fTail;
+
+    while (!queue_empty(&fQueueHead)) {
         queue_remove_first(&fQueueHead, entry, AsyncReportEntry *, chain);
+        queue_enter(&pending, entry, AsyncReportEntry *, chain);
+    }
 
-        if (entry) {
-            IOLockUnlock(fQueueLock);
+    IOLockUnlock(fQueueLock);
 
-            IOReturn status;
+    // Producers no longer touch the ring, so the released slots stay intact.
+    while (fRing && head != tail) {
+        entry = getSlot(head++);
 
-            IOMemoryDescriptor *md = IOMemoryDescriptor::withAddress(entry->reportData, entry->reportLength, kIODirectionOut);
+        if (entry->completion.action)
+            (entry->completion.action)(entry->completion.target, entry->completion.parameter, kIOReturnAborted, 0);
+    }
 
-            if (md) {
-                md->prepare();
+    while (!queue_empty(&pending)) {
+        queue_remove_first(&pending, entry, AsyncReportEntry *, chain);
 
-                status = ((IOHIDDevice *)owner)->handleReportWithTime(entry->timeStamp, md, entry->reportType, entry->options);
+        if (entry->completion.action)
+            (entry->completion.action)(entry->completion.target, entry->completion.parameter, kIOReturnAborted, 0);
 
-                md->complete();
+        IOFree(entry->reportData, entry->reportLength);
+        IODelete(entry, AsyncReportEntry, 1);
+    }
+}
 
-                md->release();
+//---------------------------------------------------------------------------
+IOHIDAsyncReportQueue::AsyncReportEntry *IOHIDAsyncReportQueue::getSlot(UInt32 index)
+{
+    return (AsyncReportEntry *)(fRing + (index % kAsyncReportQueueSlots) * fSlotStride);
+}
 
-                if (entry->completion.action) {
-                    (entry->completion.action)(entry->completion.target, entry->completion.parameter, status, 0);
-                }
-            }
+//---------------------------------------------------------------------------
+// Returns the newest entry that the workloop has not started delivering yet.
+// Must be called with the queue lock held.
 
-            IOFree(entry->reportData, entry->reportLength);
-            IODelete(entry, AsyncReportEntry, 1);
+IOHIDAsyncReportQueue::AsyncReportEntry *IOHIDAsyncReportQueue::getPendingTail()
+{
+    if (!queue_empty(&fQueueHead))
+        return (AsyncReportEntry *)queue_last(&fQueueHead);
+
+    if ((fTail - fHead) > (fConsuming ? 1 : 0))
+        return getSlot(fTail - 1);
+
+    return NULL;
+}
+
+//---------------------------------------------------------------------------
+// Try to merge a report into the newest pending entry. The pending entry
+// takes on the merged contents and the new time stamp. Must be called with
+// the queue lock held.
+
+bool IOHIDAsyncReportQueue::coalesceReport(
+                                        AbsoluteTime         timeStamp,
+                                        IOMemoryDescriptor * report,
+                                        IOHIDReportType      reportType,
+                                        IOOptionBits         options)
+{
+    AsyncReportEntry *  entry;
+    size_t              reportLength = report->getLength();
+    uint8_t *           merged       = fCoalesceBuffer + fSlotSize;
+
+    if (!fCoalesceBuffer || !reportLength || reportLength > fSlotSize)
+        return false;
+
+    entry = getPendingTail();
+
+    if (!entry ||
+        entry->reportType != reportType ||
+        entry->options != options ||
+        entry->reportLength != reportLength)
+        return false;
+
+    if (report->readBytes(0, fCoalesceBuffer, reportLength) != reportLength)
+        return false;
+
+    if (!((IOHIDDevice *)owner)->coalesceReport(entry->reportData, fCoalesceBuffer, merged, (UInt32)reportLength, reportType))
+        return false;
+
+    bcopy(merged, entry->reportData, reportLength);
+    entry->timeStamp = timeStamp;
+
+    return true;
+}
 
+//---------------------------------------------------------------------------
+void IOHIDAsyncReportQueue::processEntry(AsyncReportEntry * entry)
+{
+    IOMemoryDescriptor *    md      = NULL;
+    IOReturn                status  = kIOReturnNoMemory;
+
+    // Reports that fit are handed to the device through the one descriptor
+    // owned by the queue, which handleReportWithTime can read in place.
+    if (entry->reportLength <= fReportDescriptor->getCapacity()) {
+        bcopy(entry->reportData, fReportDescriptor->getBytesNoCopy(), entry->reportLength);
+        fReportDescriptor->setLength(entry->reportLength);
+
+        status = ((IOHIDDevice *)owner)->handleReportWithTime(entry->timeStamp, fReportDescriptor, entry->reportType, entry->options);
+    }
+    else {
+        md = IOMemoryDescriptor::withAddress(entry->reportData, entry->reportLength, kIODirectionOut);
+
+        if (md) {
+            md->prepare();
+
+            status = ((IOHIDDevice *)owner)->handleReportWithTime(entry->timeStamp, md, entry->reportType, entry->options);
+
+            md->complete();
+
+            md->release();
+        }
+    }
+
+    if (entry->completion.action) {
+        (entry->completion.action)(entry->completion.target, entry->completion.parameter, status, 0);
+    }
+}
+
+//---------------------------------------------------------------------------
+bool IOHIDAsyncReportQueue::checkForWork()
+{
+    AsyncReportEntry *  entry;
+    bool                moreToDo = false;
+    bool                fromRing;
+
+    for (UInt32 count = 0; count < kAsyncReportQueueBatchSize; count++) {
+
+        IOLockLock(fQueueLock);
+
+        // The ring always holds the oldest reports; the overflow list is only
+        // used once the ring is full, or for reports larger than a slot.
+        if (fHead != fTail) {
+            entry = getSlot(fHead);
+            fromRing = true;
+            fConsuming = true;
+        }
+        else if (!queue_empty(&fQueueHead)) {
+            queue_remove_first(&fQueueHead, entry, AsyncReportEntry *, chain);
+            fromRing = false;
+        }
+        else {
+            IOLockUnlock(fQueueLock);
+            break;
+        }
+
+        IOLockUnlock(fQueueLock);
+
+        // Producers neither reuse nor merge into the slot at fHead until it
+        // is released below, so it can be read without holding the queue lock.
+        processEntry(entry);
+
+        if (fromRing) {
             IOLockLock(fQueueLock);
+            fHead++;
+            fConsuming = false;
+            IOLockUnlock(fQueueLock);
+        }
+        else {
+            IOFree(entry->reportData, entry->reportLength);
+            IODelete(entry, AsyncReportEntry, 1);
         }
     }
 
-    moreToDo = (!queue_empty(&fQueueHead));
+    IOLockLock(fQueueLock);
+    moreToDo = (fHead != fTail) || !queue_empty(&fQueueHead);
     IOLockUnlock(fQueueLock);
 
     return moreToDo;
@@ -176,38 +421,96 @@ IOReturn IOHIDAsyncReportQueue::postReport(
                                         UInt32               completionTimeout,
                                         IOHIDCompletion *    completion)
 {
-    AsyncReportEntry *entry;
+    AsyncReportEntry *  entry;
+    size_t              reportLength = report->getLength();
+
+    IOLockLock(fQueueLock);
+
+    if (fStopped) {
+        IOLockUnlock(fQueueLock);
+        return kIOReturnNotReady;
+    }
+
+    // A merged report is delivered as part of the pending entry, so its own
+    // submission is complete as soon as the merge is done.
+    if (coalesceReport(timeStamp, report, reportType, options)) {
+        IOLockUnlock(fQueueLock);
+
+        if (completion && completion->action)
+            (completion->action)(completion->target, completion->parameter, kIOReturnSuccess, 0);
+
+        return kIOReturnSuccess;
+    }
+
+    // Only use the ring while nothing is waiting in the overflow list,
+    // otherwise a newer report could be delivered ahead of an older one.
+    if (queue_empty(&fQueueHead) && (fTail - fHead) < kAsyncReportQueueSlots && reportLength <= fSlotSize) {
+        entry = getSlot(fTail);
+
+        entry->timeStamp            = timeStamp;
+        entry->reportData           = (uint8_t *)(entry + 1);
+        entry->reportLength         = report->readBytes(0, entry->reportData, reportLength);
+        entry->reportType           = reportType;
+        entry->options              = options;
+        entry->completionTimeout    = completionTimeout;
+
+        if (completion)
+            entry->completion = *completion;
+        else
+            bzero(&entry->completion, sizeof(entry->completion));
+
+        fTail++;
+
+        IOLockUnlock(fQueueLock);
+
+        signalWorkAvailable();
+
+        return kIOReturnSuccess;
+    }
+
+    IOLockUnlock(fQueueLock);
 
     entry = IONew(AsyncReportEntry, 1);
     if (!entry)
-        return kIOReturnError;
+        return kIOReturnNoMemory;
 
     bzero(entry, sizeof(AsyncReportEntry));
 
     entry->timeStamp = timeStamp;
 
-    entry->reportLength = report->getLength();
+    entry->reportLength = reportLength;
     entry->reportData = (uint8_t *)IOMalloc(entry->reportLength);
 
-    if (entry->reportData) {
-        report->readBytes(0, entry->reportData, entry->reportLength);
+    if (!entry->reportData) {
+        IODelete(entry, AsyncReportEntry, 1);
+        return kIOReturnNoMemory;
+    }
 
-        entry->reportType = reportType;
-        entry->options = options;
-        entry->completionTimeout = completionTimeout;
+    report->readBytes(0, entry->reportData, entry->reportLength);
 
-        if (completion)
-            entry->completion = *completion;
+    entry->reportType = reportType;
+    entry->options = options;
+    entry->completionTimeout = completionTimeout;
 
-        IOLockLock(fQueueLock);
-        queue_enter(&fQueueHead, entry, AsyncReportEntry *, chain);
+    if (completion)
+        entry->completion = *completion;
+
+    IOLockLock(fQueueLock);
+
+    if (fStopped) {
         IOLockUnlock(fQueueLock);
 
-        signalWorkAvailable();
-    } else {
+        IOFree(entry->reportData, entry->reportLength);
         IODelete(entry, AsyncReportEntry, 1);
+
+        return kIOReturnNotReady;
     }
 
+    queue_enter(&fQueueHead, entry, AsyncReportEntry *, chain);
+    IOLockUnlock(fQueueLock);
+
+    signalWorkAvailable();
+
     return kIOReturnSuccess;
 }
 
@@ -233,15 +536,24 @@ OSDefineMetaClassAndAbstractStructors( IOHIDDevice, IOService )
 #define _asyncReportQueue           _reserved->asyncReportQueue
 #define _workLoop                   _reserved->workLoop
 #define _eventSource                _reserved->eventSource
+#define _changedReportBytes         _reserved->changedReportBytes
+#define _changedReportBytesSize     _reserved->changedReportBytesSize
+#define _reportScratchBuffer        _reserved->reportScratchBuffer
+#define _reportScratchBufferSize    _reserved->reportScratchBufferSize
+#define _recordQueues               _reserved->recordQueues
+#define _reportScratchBufferBusy    _reserved->reportScratchBufferBusy
+#define _reportAllocationCount      _reserved->reportAllocationCount
 
 #define WORKLOOP_LOCK   ((IOHIDEventSource *)_eventSource)->lock()
 #define WORKLOOP_UNLOCK ((IOHIDEventSource *)_eventSource)->unlock()
 
 #define kIOHIDEventThreshold	10
 
-// Number of slots in the report handler dispatch table.
+// Number of slots in the report handler dispatch table. Report IDs are
+// 8 bits wide, so the table has one slot per report ID and every handler
+// chain only holds the elements that belong to that report.
 //
-#define kReportHandlerSlots	8
+#define kReportHandlerSlots	256
 
 // Convert from a report ID to a dispatch table slot index.
 //
@@ -250,15 +562,65 @@ OSDefineMetaClassAndAbstractStructors( IOHIDDevice, IOService )
 #define GetElement(index)  \
     (IOHIDElementPrivate *) _elementArray->getObject((UInt32)index)
 
-// Describes the handler(s) at each report dispatch table slot.
+// Describes the handler(s) at each report dispatch table slot, along with
+// the last interrupt input report seen for that report ID.
 //
 struct IOHIDReportHandler
 {
     IOHIDElementPrivate * head[ kIOHIDReportTypeCount ];
+    UInt8 *               lastInputReport;
+    UInt32                lastInputReportLength;
+    UInt32                lastInputReportCapacity;
 };
 
 #define GetHeadElement(slot, type)  _reportHandlers[slot].head[type]
 
+// Compare an input report against the previous one for the same report ID,
+// setting one bit in changedBytes for every byte that differs, then keep a
+// copy of the report for next time. Returns false if there was no previous
+// report of the same length, in which case the whole report has to be
+// processed.
+//
+static bool DiffInputReport( IOHIDReportHandler *   handler,
+                             const UInt8 *          report,
+                             UInt32                 reportLength,
+                             UInt32 *               changedBytes )
+{
+    bool diffed = false;
+
+    if ( handler->lastInputReport && ( handler->lastInputReportLength == reportLength ) )
+    {
+        bzero( changedBytes, ((reportLength + 31) >> 5) * sizeof(UInt32) );
+
+        if ( bcmp( handler->lastInputReport, report, reportLength ) != 0 )
+        {
+            for ( UInt32 byte = 0; byte < reportLength; byte++ )
+            {
+                if ( handler->lastInputReport[byte] != report[byte] )
+                    changedBytes[byte >> 5] |= (1U << (byte & 0x1f));
+            }
+        }
+
+        diffed = true;
+    }
+    else if ( handler->lastInputReportCapacity < reportLength )
+    {
+        if ( handler->lastInputReport )
+            IOFree( handler->lastInputReport, handler->lastInputReportCapacity );
+
+        handler->lastInputReport         = (UInt8 *) IOMalloc( reportLength );
+        handler->lastInputReportCapacity = handler->lastInputReport ? reportLength : 0;
+    }
+
+    if ( handler->lastInputReport )
+    {
+        bcopy( report, handler->lastInputReport, reportLength );
+        handler->lastInputReportLength = reportLength;
+    }
+
+    return diffed;
+}
+
 // #define DEBUG 1
 #ifdef  DEBUG
 #define DLOG(fmt, args...)  IOLog(fmt, args)
@@ -281,6 +643,181 @@ static SInt32 g3DGameControllerCount = 0;
 static IONotifier   *gDeviceMatchedNotifier             = 0;
 static uint8_t      gDeviceMatchedNotifierInitialized   = 0;
 
+//---------------------------------------------------------------------------
+// Identical devices such as docks, reconnecting Bluetooth devices and
+// virtual devices keep presenting the same report descriptor. The parsed
+// form of recently seen descriptors is kept here, most recently used
+// first, so that parseReportDescriptor can copy it instead of running
+// the parser again.
+
+#define kDescriptorCacheMaxBytes    (256 * 1024)
+
+struct DescriptorCacheEntry {
+    TAILQ_ENTRY(DescriptorCacheEntry)   link;
+    UInt8                               digest[SHA1_RESULTLEN];
+    void *                              descriptor;
+    IOByteCount                         descriptorLength;
+    HIDPreparsedDataRef                 parseData;
+    IOByteCount                         size;
+};
+
+static TAILQ_HEAD(DescriptorCacheEntryList, DescriptorCacheEntry) gDescriptorCache = TAILQ_HEAD_INITIALIZER(gDescriptorCache);
+static IOLock *     gDescriptorCacheLock    = 0;
+static IOByteCount  gDescriptorCacheBytes   = 0;
+
+static IOLock * GetDescriptorCacheLock()
+{
+    if ( !gDescriptorCacheLock )
+    {
+        IOLock * lock = IOLockAlloc();
+
+        if ( lock && !OSCompareAndSwapPtr(0, lock, &gDescriptorCacheLock) )
+            IOLockFree(lock);
+    }
+
+    return gDescriptorCacheLock;
+}
+
+static void FreeDescriptorCacheEntry(DescriptorCacheEntry * entry)
+{
+    if ( entry->parseData )
+        HIDCloseReportDescriptor(entry->parseData);
+
+    if ( entry->descriptor )
+        IOFree(entry->descriptor, entry->descriptorLength);
+
+    IODelete(entry, DescriptorCacheEntry, 1);
+}
+
+static DescriptorCacheEntry * FindDescriptorCacheEntry(
+                                const void *    descriptor,
+                                IOByteCount     length,
+                                const UInt8 *   digest)
+{
+    DescriptorCacheEntry * entry;
+
+    TAILQ_FOREACH(entry, &gDescriptorCache, link)
+    {
+        if ( ( entry->descriptorLength == length ) &&
+             ( memcmp(entry->digest, digest, SHA1_RESULTLEN) == 0 ) &&
+             ( memcmp(entry->descriptor, descriptor, length) == 0 ) )
+            return entry;
+    }
+
+    return 0;
+}
+
+//---------------------------------------------------------------------------
+// Frees the cached entries and the lock when the kext unloads. No devices
+// are left by then, so nothing else can be holding the lock.
+
+static class DescriptorCacheTeardown {
+public:
+    ~DescriptorCacheTeardown()
+    {
+        DescriptorCacheEntry * entry;
+
+        while ( (entry = TAILQ_FIRST(&gDescriptorCache)) )
+        {
+            TAILQ_REMOVE(&gDescriptorCache, entry, link);
+            FreeDescriptorCacheEntry(entry);
+        }
+        gDescriptorCacheBytes = 0;
+
+        if ( gDescriptorCacheLock )
+        {
+            IOLockFree(gDescriptorCacheLock);
+            gDescriptorCacheLock = 0;
+        }
+    }
+} gDescriptorCacheTeardown;
+
+//---------------------------------------------------------------------------
+// Returns a copy of the cached parse of a descriptor, or 0 on a miss.
+
+static HIDPreparsedDataRef CopyCachedParseData(
+                                const void *    descriptor,
+                                IOByteCount     length,
+                                const UInt8 *   digest)
+{
+    IOLock *                lock        = GetDescriptorCacheLock();
+    DescriptorCacheEntry *  entry;
+    HIDPreparsedDataRef     parseData   = 0;
+
+    if ( !lock )
+        return 0;
+
+    IOLockLock(lock);
+
+    entry = FindDescriptorCacheEntry(descriptor, length, digest);
+    if ( entry && ( HIDCopyPreparsedData(entry->parseData, &parseData) == kHIDSuccess ) )
+    {
+        TAILQ_REMOVE(&gDescriptorCache, entry, link);
+        TAILQ_INSERT_HEAD(&gDescriptorCache, entry, link);
+    }
+
+    IOLockUnlock(lock);
+
+    return parseData;
+}
+
+//---------------------------------------------------------------------------
+// Adds a copy of a descriptor's parse to the cache, evicting the least
+// recently used entries to stay within kDescriptorCacheMaxBytes.
+
+static void CacheParseData(     const void *        descriptor,
+                                IOByteCount         length,
+                                const UInt8 *       digest,
+                                HIDPreparsedDataRef parseData)
+{
+    IOLock *                lock    = GetDescriptorCacheLock();
+    DescriptorCacheEntry *  entry   = 0;
+    DescriptorCacheEntry *  evicted;
+
+    require(lock, exit);
+
+    entry = IONew(DescriptorCacheEntry, 1);
+    require(entry, exit);
+
+    bzero(entry, sizeof(DescriptorCacheEntry));
+
+    entry->size = sizeof(DescriptorCacheEntry) + length + HIDGetPreparsedDataSize(parseData);
+    require(entry->size <= kDescriptorCacheMaxBytes, exit);
+
+    entry->descriptor = IOMalloc(length);
+    require(entry->descriptor, exit);
+
+    entry->descriptorLength = length;
+    bcopy(descriptor, entry->descriptor, length);
+    bcopy(digest, entry->digest, SHA1_RESULTLEN);
+
+    require(HIDCopyPreparsedData(parseData, &entry->parseData) == kHIDSuccess, exit);
+
+    IOLockLock(lock);
+
+    // Another device with the same descriptor may have got here first.
+    if ( !FindDescriptorCacheEntry(descriptor, length, digest) )
+    {
+        TAILQ_INSERT_HEAD(&gDescriptorCache, entry, link);
+        gDescriptorCacheBytes += entry->size;
+        entry = 0;
+
+        while ( gDescriptorCacheBytes > kDescriptorCacheMaxBytes )
+        {
+            evicted = TAILQ_LAST(&gDescriptorCache, DescriptorCacheEntryList);
+            TAILQ_REMOVE(&gDescriptorCache, evicted, link);
+            gDescriptorCacheBytes -= evicted->size;
+            FreeDescriptorCacheEntry(evicted);
+        }
+    }
+
+    IOLockUnlock(lock);
+
+exit:
+    if ( entry )
+        FreeDescriptorCacheEntry(entry);
+}
+
 //---------------------------------------------------------------------------
 // Initialize an IOHIDDevice object.
 
@@ -311,6 +848,13 @@ void IOHIDDevice::free()
 {
     if ( _reportHandlers )
     {
+        for ( UInt32 slot = 0; slot < kReportHandlerSlots; slot++ )
+        {
+            if ( _reportHandlers[slot].lastInputReport )
+                IOFree( _reportHandlers[slot].lastInputReport,
+                        _reportHandlers[slot].lastInputReportCapacity );
+        }
+
         IOFree( _reportHandlers,
                 sizeof(IOHIDReportHandler) * kReportHandlerSlots );
         _reportHandlers = 0;
@@ -355,6 +899,30 @@ void IOHIDDevice::free()
         _eventSource = NULL;
     }
     
+    if (_asyncReportQueue)
+    {
+        _asyncReportQueue->release();
+        _asyncReportQueue = NULL;
+    }
+    
+    if (_recordQueues)
+    {
+        _recordQueues->release();
+        _recordQueues = NULL;
+    }
+    
+    if (_changedReportBytes)
+    {
+        IOFree(_changedReportBytes, _changedReportBytesSize);
+        _changedReportBytes = NULL;
+    }
+    
+    if (_reportScratchBuffer)
+    {
+        IOFree(_reportScratchBuffer, _reportScratchBufferSize);
+        _reportScratchBuffer = NULL;
+    }
+    
     if (_workLoop)
     {
         _workLoop->release();
@@ -466,6 +1034,17 @@ bool IOHIDDevice::start( IOService * provider )
     ret = parseReportDescriptor( reportDescriptor );
     require_noerr_action(ret, error, result=false);
 
+    // Preallocate a buffer to copy reports into when they don't arrive in
+    // an IOBufferMemoryDescriptor. Reports that don't fit fall back to a
+    // temporary allocation, so failing here is not fatal.
+    _reportScratchBufferSize = max(_maxInputReportSize,
+                                   max(_maxOutputReportSize, _maxFeatureReportSize));
+    if ( _reportScratchBufferSize ) {
+        _reportScratchBuffer = IOMalloc(_reportScratchBufferSize);
+        if ( !_reportScratchBuffer )
+            _reportScratchBufferSize = 0;
+    }
+
     _hierarchElements = CreateHierarchicalElementList((IOHIDElement *)_elementArray->getObject( 0 ));
     require_action(_hierarchElements, error, result=false);
 
@@ -622,6 +1201,17 @@ void IOHIDDevice::stop(IOService * provider)
         {
             _workLoop->removeEventSource(_eventSource);
         }
+
+        if (_asyncReportQueue)
+        {
+            _workLoop->removeEventSource(_asyncReportQueue);
+        }
+    }
+
+    // Reports queued but not yet delivered are never going to be now.
+    if (_asyncReportQueue)
+    {
+        _asyncReportQueue->abortReports();
     }
 
     _readyForInputReports = false;
@@ -1121,6 +1711,8 @@ IOReturn IOHIDDevice::parseReportDescriptor( IOMemoryDescriptor * report,
     void *               reportData;
     IOByteCount          reportLength;
     IOReturn             ret;
+    SHA1_CTX             digestContext;
+    UInt8                digest[SHA1_RESULTLEN];
 
     reportLength = report->getLength();
 
@@ -1134,13 +1726,31 @@ IOReturn IOHIDDevice::parseReportDescriptor( IOMemoryDescriptor * report,
 
     report->readBytes( 0, reportData, reportLength );
 
-    // Parse the report descriptor.
+    // Use the parse of an identical descriptor if one is cached.
+
+    SHA1Init( &digestContext );
+    SHA1Update( &digestContext, reportData, reportLength );
+    SHA1Final( digest, &digestContext );
+
+    parseData = CopyCachedParseData( reportData, reportLength, digest );
 
-    status = HIDOpenReportDescriptor(
-                reportData,      /* report descriptor */
-                reportLength,    /* report size in bytes */
-                &parseData,      /* pre-parse data */
-                0 );             /* flags */
+    if ( parseData )
+    {
+        status = kHIDSuccess;
+    }
+    else
+    {
+        // Parse the report descriptor.
+
+        status = HIDOpenReportDescriptor(
+                    reportData,      /* report descriptor */
+                    reportLength,    /* report size in bytes */
+                    &parseData,      /* pre-parse data */
+                    0 );             /* flags */
+
+        if ( status == kHIDSuccess )
+            CacheParseData( reportData, reportLength, digest, parseData );
+    }
 
     // Release the buffer
     IOFree( reportData, reportLength );
@@ -1288,6 +1898,18 @@ IOHIDDevice::createElementHierarchy( HIDPreparsedDataRef parseData )
         // Add the input report handler to the element array.
         if ( !createReportHandlerElements(parseData) ) break;
 
+        // The element layout is now final. Precompute how each element
+        // extracts its value so report processing doesn't have to.
+
+        for ( UInt32 slot = 0; slot < kReportHandlerSlots; slot++ ) {
+            for ( UInt32 type = 0; type < kIOHIDReportTypeCount; type++ ) {
+                IOHIDElementPrivate * element = GetHeadElement(slot, type);
+                while ( element ) {
+                    element->compileReportExtraction();
+                    element = element->getNextReportHandler();
+                }
+            }
+        }
 
         // Create a memory to store current element values.
 
@@ -1754,10 +2376,22 @@ bool IOHIDDevice::registerElement( IOHIDElementPrivate * element,
 //---------------------------------------------------------------------------
 // Create a buffer memory descriptor, and divide the memory buffer
 // for each data element.
+//
+// The values for each (report ID, report type) pair are kept together, in
+// report handler chain order, and each group starts on a cache line. This
+// way handling a report only touches the lines that belong to it, and a
+// client can read all of a report's values from one region. The chain order
+// matters to IOHIDLib, which expects the values of a usage range or of
+// duplicate elements to sit next to each other in descending cookie order.
+// The location of each group is published under kIOHIDReportValueDirectoryKey.
+
+#define kElementValueGroupAlignment 64
+
 IOBufferMemoryDescriptor * IOHIDDevice::createMemoryForElementValues()
 {
     IOBufferMemoryDescriptor *  descriptor;
     IOHIDElementPrivate *       element;
+    OSArray *                   directory;
     UInt32                      capacity = 0;
     UInt8 *                     beginning;
     UInt8 *                     buffer;
@@ -1768,6 +2402,16 @@ IOBufferMemoryDescriptor * IOHIDDevice::createMemoryForElementValues()
     for ( UInt32 slot = 0; slot < kReportHandlerSlots; slot++ ) {
         for ( UInt32 type = 0; type < kIOHIDReportTypeCount; type++ ) {
             element = GetHeadElement(slot, type);
+
+            if ( element ) {
+                UInt32 padding = (kElementValueGroupAlignment - (capacity % kElementValueGroupAlignment)) % kElementValueGroupAlignment;
+
+                if ( padding > ULONG_MAX - capacity )
+                    return NULL;
+
+                capacity += padding;
+            }
+
             while ( element ) {
                 UInt32 remaining = ULONG_MAX - capacity;
 
@@ -1786,23 +2430,37 @@ IOBufferMemoryDescriptor * IOHIDDevice::createMemoryForElementValues()
 
     descriptor = IOBufferMemoryDescriptor::withOptions(
                      kIOMemoryKernelUserShared,
-                     capacity );
+                     capacity,
+                     kElementValueGroupAlignment );
 
     if ( ( descriptor == 0 ) || ( descriptor->getBytesNoCopy() == 0 ) ) {
         if ( descriptor ) descriptor->release();
         return 0;
     }
 
+    directory = OSArray::withCapacity(4);
+
     // Now assign the update memory area for each report element.
     beginning = buffer = (UInt8 *) descriptor->getBytesNoCopy();
 
+    bzero( beginning, capacity );
+
     for ( UInt32 slot = 0; slot < kReportHandlerSlots; slot++ ) {
         for ( UInt32 type = 0; type < kIOHIDReportTypeCount; type++ ) {
+            UInt8 * group;
+
             element = GetHeadElement(slot, type);
+            if ( !element )
+                continue;
+
+            buffer += (kElementValueGroupAlignment - ((buffer - beginning) % kElementValueGroupAlignment)) % kElementValueGroupAlignment;
+            group   = buffer;
+
             while ( element ) {
                 assert ( buffer < (beginning + capacity) );
 
                 if(buffer >= (beginning + capacity)) {
+                    OSSafeReleaseNULL(directory);
                     descriptor->release();
                     return 0;
                 }
@@ -1813,12 +2471,88 @@ IOBufferMemoryDescriptor * IOHIDDevice::createMemoryForElementValues()
                 buffer += element->getElementValueSize();
                 element = element->getNextReportHandler();
             }
+
+            if ( directory ) {
+                OSDictionary * entry = OSDictionary::withCapacity(4);
+
+                if ( entry ) {
+                    OSNumber * number;
+
+                    if ( (number = OSNumber::withNumber(slot, 32)) ) {
+                        entry->setObject(kIOHIDElementReportIDKey, number);
+                        number->release();
+                    }
+                    if ( (number = OSNumber::withNumber(type, 32)) ) {
+                        entry->setObject(kIOHIDReportValueTypeKey, number);
+                        number->release();
+                    }
+                    if ( (number = OSNumber::withNumber(group - beginning, 32)) ) {
+                        entry->setObject(kIOHIDElementValueLocationKey, number);
+                        number->release();
+                    }
+                    if ( (number = OSNumber::withNumber(buffer - group, 32)) ) {
+                        entry->setObject(kIOHIDReportValueSizeKey, number);
+                        number->release();
+                    }
+
+                    directory->setObject(entry);
+                    entry->release();
+                }
+            }
         }
     }
 
+    if ( directory ) {
+        setProperty(kIOHIDReportValueDirectoryKey, directory);
+        directory->release();
+    }
+
     return descriptor;
 }
 
+//---------------------------------------------------------------------------
+// Merge an input report that is still waiting in the async report queue
+// with a newer report that has the same ID. The result is built in the
+// caller's merged buffer, and is only valid if true is returned.
+
+bool IOHIDDevice::coalesceReport( const void *    olderReport,
+                                  const void *    newerReport,
+                                  void *          mergedReport,
+                                  UInt32          reportLength,
+                                  IOHIDReportType reportType )
+{
+    IOHIDElementPrivate *   element;
+    UInt8                   reportID = 0;
+    bool                    result   = false;
+
+    if ( !_reportHandlers || !_readyForInputReports ||
+         ( reportType != kIOHIDReportTypeInput ) || !reportLength )
+        return false;
+
+    if ( _reportCount > 1 ) {
+        reportID = *((const UInt8 *) newerReport);
+
+        if ( reportID != *((const UInt8 *) olderReport) )
+            return false;
+    }
+
+    element = GetHeadElement(GetReportHandlerSlot(reportID), reportType);
+    if ( !element )
+        return false;
+
+    bcopy(newerReport, mergedReport, reportLength);
+
+    do {
+        result = element->coalesceReport(reportID,
+                                         (const UInt8 *) olderReport,
+                                         (UInt8 *) mergedReport,
+                                         reportLength << 3,
+                                         &element);
+    } while ( result && element );
+
+    return result;
+}
+
 //---------------------------------------------------------------------------
 // Get a reference to the memory descriptor created by
 // createMemoryForElementValues().
@@ -1851,6 +2585,18 @@ IOReturn IOHIDDevice::startEventDelivery( IOHIDEventQueue *  queue,
 
         ret = element->addEventQueue( queue ) ?
               kIOReturnSuccess : kIOReturnNoMemory;
+
+        // Queues that take report records need to be told when a report
+        // has been fully handled.
+        if ( ( ret == kIOReturnSuccess ) &&
+             ( queue->getOptions() & kIOHIDQueueOptionsTypeReportRecords ) )
+        {
+            if ( !_recordQueues )
+                _recordQueues = OSArray::withCapacity(2);
+
+            if ( _recordQueues && ( _recordQueues->getNextIndexOfObject(queue, 0) < 0 ) )
+                _recordQueues->setObject(queue);
+        }
     }
     while ( false );
 
@@ -1888,6 +2634,17 @@ IOReturn IOHIDDevice::stopEventDelivery( IOHIDEventQueue *  queue,
     }
     while ( cookie == 0 );
 
+    if ( ( cookie == 0 ) && _recordQueues )
+    {
+        int index = _recordQueues->getNextIndexOfObject(queue, 0);
+
+        if ( index >= 0 )
+        {
+            queue->flushReportRecord();
+            _recordQueues->removeObject(index);
+        }
+    }
+
     WORKLOOP_UNLOCK;
 
     return removed ? kIOReturnSuccess : kIOReturnNotFound;
@@ -2062,7 +2819,8 @@ IOReturn IOHIDDevice::postElementValues(IOHIDElementCookie * cookies, UInt32 coo
       
         reportID = cookieElement->getReportID();
 
-        // Start at the head element and iterate through
+        // Start at the head element and iterate through the handlers
+        // registered for this report ID.
         element = GetHeadElement(GetReportHandlerSlot(reportID), reportType);
 
         while ( element ) {
@@ -2184,13 +2942,107 @@ IOReturn IOHIDDevice::handleReportWithTime(
     IOMemoryDescriptor * report,
     IOHIDReportType      reportType,
     IOOptionBits         options)
+{
+    IOReturn                    ret                 = kIOReturnNotReady;
+    bool                        shouldTickle        = false;
+    UInt32                      allocationCount     = 0;
+
+    if ((reportType == kIOHIDReportTypeInput) && !_readyForInputReports)
+        return kIOReturnOffline;
+
+    WORKLOOP_LOCK;
+
+    ret = handleReportLocked(timeStamp, report, reportType, options, &shouldTickle, &allocationCount);
+
+    WORKLOOP_UNLOCK;
+
+    if ( allocationCount )
+        setProperty(kIOHIDReportAllocationCountKey, allocationCount, 32);
+
+    if ( shouldTickle )
+        tickleActivity(timeStamp);
+
+    return ret;
+}
+
+//---------------------------------------------------------------------------
+// Handle several input reports from the device under one workloop lock.
+
+OSMetaClassDefineReservedUsed(IOHIDDevice, 12);
+IOReturn IOHIDDevice::handleReportsWithTime( const IOHIDReportBatch & batch )
+{
+    IOReturn                    ret                 = kIOReturnSuccess;
+    IOReturn                    status;
+    AbsoluteTime                tickleTime;
+    bool                        shouldTickle        = false;
+    bool                        reportTickle;
+    UInt32                      allocationCount     = 0;
+
+    if ( !batch.count )
+        return kIOReturnSuccess;
+
+    if ( !batch.entries )
+        return kIOReturnBadArgument;
+
+    AbsoluteTime_to_scalar(&tickleTime) = 0;
+
+    WORKLOOP_LOCK;
+
+    for ( UInt32 index = 0; index < batch.count; index++ ) {
+        const IOHIDReportBatchEntry * entry = &batch.entries[index];
+
+        reportTickle = false;
+
+        status = handleReportLocked(entry->timeStamp,
+                                    entry->report,
+                                    entry->reportType,
+                                    entry->options,
+                                    &reportTickle,
+                                    &allocationCount);
+
+        if ( reportTickle ) {
+            shouldTickle = true;
+            tickleTime   = entry->timeStamp;
+        }
+
+        if ( ( status != kIOReturnSuccess ) && ( ret == kIOReturnSuccess ) )
+            ret = status;
+    }
+
+    WORKLOOP_UNLOCK;
+
+    if ( allocationCount )
+        setProperty(kIOHIDReportAllocationCountKey, allocationCount, 32);
+
+    // Only the newest report that asked for it tickles, since its time stamp
+    // is the one that decides the next deadline.
+    if ( shouldTickle )
+        tickleActivity(tickleTime);
+
+    return ret;
+}
+
+//---------------------------------------------------------------------------
+// Process one report. Must be called with the workloop lock held. Sets
+// shouldTickle if the report changed an element that tickles activity, and
+// sets allocationCount if the report needed a heap allocation.
+
+IOReturn IOHIDDevice::handleReportLocked(
+    AbsoluteTime         timeStamp,
+    IOMemoryDescriptor * report,
+    IOHIDReportType      reportType,
+    IOOptionBits         options,
+    bool *               shouldTickle,
+    UInt32 *             allocationCount)
 {
     IOBufferMemoryDescriptor *  bufferDescriptor    = NULL;
     void *                      reportData          = NULL;
     IOByteCount                 reportLength        = 0;
     IOReturn                    ret                 = kIOReturnNotReady;
     bool                        changed             = false;
-    bool                        shouldTickle        = false;
+    bool                        tickle              = false;
+    bool                        allocated           = false;
+    bool                        scratch             = false;
     UInt8                       reportID            = 0;
 
     IOHID_DEBUG(kIOHIDDebugCode_HandleReport, reportType, options, __OSAbsoluteTime(timeStamp), getRegistryEntryID());
@@ -2213,31 +3065,78 @@ IOReturn IOHIDDevice::handleReportWithTime(
         reportData = bufferDescriptor->getBytesNoCopy();
         if ( !reportData )
             return kIOReturnNoMemory;
-    } else {
-        reportData = IOMalloc(reportLength);
-        if ( !reportData )
-            return kIOReturnNoMemory;
-        
+    }
+    else {
+        // Copy the report into the preallocated buffer, which the workloop
+        // lock protects. Only allocate if the report doesn't fit, or if the
+        // buffer is already in use further up the stack.
+        if ( _reportScratchBuffer && !_reportScratchBufferBusy && ( reportLength <= _reportScratchBufferSize ) ) {
+            reportData = _reportScratchBuffer;
+            _reportScratchBufferBusy = true;
+            scratch = true;
+        } else {
+            reportData = IOMalloc(reportLength);
+            if ( !reportData )
+                return kIOReturnNoMemory;
+            allocated = true;
+            *allocationCount = ++_reportAllocationCount;
+        }
+
         report->readBytes( 0, reportData, reportLength );
     }
-    
-    WORKLOOP_LOCK;
 
     if ( _readyForInputReports ) {
         IOHIDElementPrivate * element;
+        IOHIDReportHandler *  handler;
+        UInt32 *              changedBytes = NULL;
 
         // The first byte in the report, may be the report ID.
         // XXX - Do we need to advance the start of the report data?
 
         reportID = ( _reportCount > 1 ) ? *((UInt8 *) reportData) : 0;
 
-        // Get the first element in the report handler chain.
+        handler = &_reportHandlers[GetReportHandlerSlot(reportID)];
+
+        // Work out which bytes changed since the last interrupt report with
+        // this ID, so that elements whose bits are untouched can be skipped.
+        // Reports that did not come from the interrupt pipe may carry values
+        // the last interrupt report didn't, so they invalidate the copy.
+
+        if ( reportType == kIOHIDReportTypeInput ) {
+            if ( options & kIOHIDReportOptionNotInterrupt ) {
+                handler->lastInputReportLength = 0;
+            }
+            else {
+                UInt32 bitmapSize = (UInt32)(((reportLength + 31) >> 5) * sizeof(UInt32));
+
+                if ( _changedReportBytesSize < bitmapSize ) {
+                    if ( _changedReportBytes )
+                        IOFree( _changedReportBytes, _changedReportBytesSize );
+
+                    _changedReportBytes     = (UInt32 *) IOMalloc( bitmapSize );
+                    _changedReportBytesSize = _changedReportBytes ? bitmapSize : 0;
+                }
+
+                if ( _changedReportBytes &&
+                     DiffInputReport( handler, (UInt8 *) reportData, (UInt32) reportLength, _changedReportBytes ) )
+                    changedBytes = _changedReportBytes;
+            }
+        }
 
-        element = GetHeadElement( GetReportHandlerSlot(reportID),
-                                  reportType);
+        // Get the first element in the report handler chain. The chain
+        // only holds the handlers registered for this report ID.
+
+        element = handler->head[reportType];
 
         while ( element ) {
-            shouldTickle |= element->shouldTickleActivity();
+            tickle |= element->shouldTickleActivity();
+
+            if ( changedBytes && element->skipUnchangedReport( reportID,
+                                                                (UInt32)(reportLength << 3),
+                                                                changedBytes,
+                                                                &element ) )
+                continue;
+
             changed |= element->processReport( reportID,
                                                reportData,
                                                reportLength << 3,
@@ -2246,6 +3145,15 @@ IOReturn IOHIDDevice::handleReportWithTime(
                                                options );
         }
 
+        // Hand each report record queue everything this report changed.
+        if ( _recordQueues )
+        {
+            IOHIDEventQueue * queue;
+
+            for ( UInt32 i = 0; (queue = (IOHIDEventQueue *) _recordQueues->getObject(i)); i++ )
+                queue->flushReportRecord();
+        }
+
         ret = kIOReturnSuccess;
     }
 
@@ -2254,16 +3162,25 @@ IOReturn IOHIDDevice::handleReportWithTime(
         _interfaceNub->handleReport(timeStamp, report, reportType, reportID, options);
     }
 
-    WORKLOOP_UNLOCK;
+    if ( scratch )
+        _reportScratchBufferBusy = false;
 
-    if ( !bufferDescriptor && reportData ) {
-        // Release the buffer
+    // Release the buffer
+    if ( allocated )
         IOFree(reportData, reportLength);
-    }
 
-    // RY: If this is a non-system HID device, post a null hid
-    // event to prevent the system from sleeping.
-    if (changed && shouldTickle && _performTickle
+    *shouldTickle = changed && tickle;
+
+    return ret;
+}
+
+//---------------------------------------------------------------------------
+// RY: If this is a non-system HID device, post a null hid
+// event to prevent the system from sleeping.
+
+void IOHIDDevice::tickleActivity( AbsoluteTime timeStamp )
+{
+    if (_performTickle
             && (CMP_ABSOLUTETIME(&timeStamp, &_eventDeadline) > 0))
     {
         AbsoluteTime ts;
@@ -2276,8 +3193,6 @@ IOReturn IOHIDDevice::handleReportWithTime(
 
         IOHIDSystemActivityTickle(NX_NULLEVENT, this);
     }
-
-    return ret;
 }
 
 //---------------------------------------------------------------------------
@@ -2312,7 +3227,7 @@ IOReturn IOHIDDevice::handleReportWithTimeAsync(
     WORKLOOP_LOCK;
 
     if (!_asyncReportQueue) {
-        _asyncReportQueue = IOHIDAsyncReportQueue::withOwner(this);
+        _asyncReportQueue = IOHIDAsyncReportQueue::withOwner(this, _maxInputReportSize);
 
         if (_asyncReportQueue) {
             /*status =*/ getWorkLoop()->addEventSource ( _asyncReportQueue );
@@ -2328,7 +3243,6 @@ IOReturn IOHIDDevice::handleReportWithTimeAsync(
     return result;
 }
 
-OSMetaClassDefineReservedUnused(IOHIDDevice, 12);
 OSMetaClassDefineReservedUnused(IOHIDDevice, 13);
 OSMetaClassDefineReservedUnused(IOHIDDevice, 14);
 OSMetaClassDefineReservedUnused(IOHIDDevice, 15);
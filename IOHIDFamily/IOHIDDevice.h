@@ -81,6 +81,32 @@ enum
     kIOHIDReportOptionNotInterrupt	= 0x100
 };
 
+/*!
+    @typedef IOHIDReportBatchEntry
+    @abstract One report passed to IOHIDDevice::handleReportsWithTime.
+    @param timeStamp The timestamp of the report.
+    @param report A memory descriptor that describes the report.
+    @param reportType The type of report.
+    @param options Options for the report, as for handleReportWithTime.
+*/
+typedef struct IOHIDReportBatchEntry {
+    AbsoluteTime            timeStamp;
+    IOMemoryDescriptor *    report;
+    IOHIDReportType         reportType;
+    IOOptionBits            options;
+} IOHIDReportBatchEntry;
+
+/*!
+    @typedef IOHIDReportBatch
+    @abstract A set of reports, in the order they were received.
+    @param entries Array of reports.
+    @param count Number of reports in the array.
+*/
+typedef struct IOHIDReportBatch {
+    const IOHIDReportBatchEntry *   entries;
+    UInt32                          count;
+} IOHIDReportBatch;
+
 
 /*! @class IOHIDDevice : public IOService
     @abstract IOHIDDevice defines a Human Interface Device (HID) object,
@@ -106,6 +132,7 @@ class IOHIDDevice : public IOService
 
     friend class IOHIDLibUserClient;
     friend class IOHIDDeviceShim;
+    friend class IOHIDAsyncReportQueue;
 
 private:
     OSArray *                   _elementArray;
@@ -132,6 +159,13 @@ private:
         IOHIDAsyncReportQueue * asyncReportQueue;
         IOWorkLoop *            workLoop;
         IOEventSource *         eventSource;
+        UInt32 *                changedReportBytes;
+        UInt32                  changedReportBytesSize;
+        void *                  reportScratchBuffer;
+        UInt32                  reportScratchBufferSize;
+        bool                    reportScratchBufferBusy;
+        UInt32                  reportAllocationCount;
+        OSArray *               recordQueues;
     };
     /*! @var reserved
         Reserved for future use.  (Internal use only)  */
@@ -174,6 +208,21 @@ private:
 
     IOBufferMemoryDescriptor * createMemoryForElementValues();
 
+    IOReturn handleReportLocked( AbsoluteTime         timeStamp,
+                                 IOMemoryDescriptor * report,
+                                 IOHIDReportType      reportType,
+                                 IOOptionBits         options,
+                                 bool *               shouldTickle,
+                                 UInt32 *             allocationCount );
+
+    void tickleActivity( AbsoluteTime timeStamp );
+
+    bool coalesceReport( const void *    olderReport,
+                         const void *    newerReport,
+                         void *          mergedReport,
+                         UInt32          reportLength,
+                         IOHIDReportType reportType );
+
 
     static bool _publishDisplayNotificationHandler(void * target,
                                                    void * ref,
@@ -705,7 +754,18 @@ public:
     OSMetaClassDeclareReservedUsed(IOHIDDevice, 11);
     virtual OSArray * newDeviceUsagePairs();
 
-    OSMetaClassDeclareReservedUnused(IOHIDDevice, 12);
+/*! @function handleReportsWithTime
+    @abstract Handle several reports received from the HID device at once.
+    @discussion Behaves like calling handleReportWithTime for each report in
+    the batch, in order, but the workloop lock is taken once for the whole
+    batch and system activity is tickled at most once.
+    @param batch The reports to handle.
+    @result kIOReturnSuccess if every report was handled, or the error
+    returned for the first report that failed. */
+
+    OSMetaClassDeclareReservedUsed(IOHIDDevice, 12);
+    virtual IOReturn handleReportsWithTime( const IOHIDReportBatch & batch );
+
     OSMetaClassDeclareReservedUnused(IOHIDDevice, 13);
     OSMetaClassDeclareReservedUnused(IOHIDDevice, 14);
     OSMetaClassDeclareReservedUnused(IOHIDDevice, 15);
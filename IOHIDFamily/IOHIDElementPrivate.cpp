@@ -28,6 +28,7 @@
 #include "IOHIDElementPrivate.h"
 #include "IOHIDEventQueue.h"
 #include "IOHIDParserPriv.h"
+#include "IOHIDReportBits.h"
 #include "IOHIDPrivateKeys.h"
 
 #define IsRange() \
@@ -59,6 +60,18 @@
 
 #define GetArrayItemSel(index) \
             (index + _logicalMin)
+
+// Selector ranges up to this many values are diffed with bitsets.
+#define kArraySelectorRangeMax  4096
+
+#define BitsetWords(bits)   (((bits) + 31) >> 5)
+
+#define ArraySelectorBitsSize(range, count) \
+            ((2 * BitsetWords(range) + BitsetWords(count)) * sizeof(UInt32))
+
+#define TestBit(bits, index)    ((bits)[(index) >> 5] & (1U << ((index) & 0x1f)))
+#define SetBit(bits, index)     ((bits)[(index) >> 5] |= (1U << ((index) & 0x1f)))
+#define ClearBit(bits, index)   ((bits)[(index) >> 5] &= ~(1U << ((index) & 0x1f)))
 			
 OSDefineMetaClassAndAbstractStructors(IOHIDElement, OSCollection)
 OSMetaClassDefineReservedUsed(IOHIDElement,  0);
@@ -117,6 +130,9 @@ bool IOHIDElementPrivate::init( IOHIDDevice * owner, IOHIDElementType type )
     _arrayItems = 0;
     _duplicateElements = 0;
     _oldArraySelectors = 0;
+    _newArraySelectors = 0;
+    _arraySelectorBits = 0;
+    _arraySelectorRange = 0;
     _usagePage = 0;
     _usageMin = _usageMax = 0;
     _isInterruptReportHandler = 0;
@@ -498,6 +514,18 @@ void IOHIDElementPrivate::free()
         _oldArraySelectors = 0;
     }
 
+    if (_newArraySelectors)
+    {
+        IOFree (_newArraySelectors, sizeof(UInt32) * _reportCount);
+        _newArraySelectors = 0;
+    }
+
+    if (_arraySelectorBits)
+    {
+        IOFree (_arraySelectorBits, ArraySelectorBitsSize(_arraySelectorRange, _reportCount));
+        _arraySelectorBits = 0;
+    }
+
     if (_colArrayReportHandlers)
     {
         _colArrayReportHandlers->release();
@@ -642,6 +670,25 @@ IOHIDElementPrivate * IOHIDElementPrivate::arrayHandlerElement(
         goto ARRAY_HANDLER_ELEMENT_RELEASE;
 
     bzero ( element->_oldArraySelectors, sizeof(UInt32) * element->_reportCount);
+
+    element->_newArraySelectors = (UInt32 *)IOMalloc(sizeof(UInt32) * element->_reportCount);
+
+    if (element->_newArraySelectors == NULL)
+        goto ARRAY_HANDLER_ELEMENT_RELEASE;
+
+    // Selectors outside of a small logical range are looked up by scanning.
+    if ((element->_logicalMax >= element->_logicalMin) &&
+        ((element->_logicalMax - element->_logicalMin) < kArraySelectorRangeMax))
+    {
+        element->_arraySelectorRange = element->_logicalMax - element->_logicalMin + 1;
+    }
+
+    element->_arraySelectorBits = (UInt32 *)IOMalloc(ArraySelectorBitsSize(element->_arraySelectorRange, element->_reportCount));
+
+    if (element->_arraySelectorBits == NULL)
+        goto ARRAY_HANDLER_ELEMENT_RELEASE;
+
+    bzero ( element->_arraySelectorBits, ArraySelectorBitsSize(element->_arraySelectorRange, element->_reportCount));
     
     if (element->_reportCount > 1)
     {
@@ -936,114 +983,24 @@ UInt32 IOHIDElementPrivate::getElementValueSize() const
 }
 
 //---------------------------------------------------------------------------
-// Not very efficient, will do for now.
+// Precompute the byte offset, shift, mask and sign extension needed to pull
+// this element's value out of a report. Only values that fit in a single
+// word qualify; anything larger keeps going through readReportBits.
 
-#define BIT_MASK(bits)  ((1 << (bits)) - 1)
-
-#define UpdateByteOffsetAndShift(bits, offset, shift)  \
-    do { offset = bits >> 3; shift = bits & 0x07; } while (0)
-
-#define UpdateWordOffsetAndShift(bits, offset, shift)  \
-    do { offset = bits >> 5; shift = bits & 0x1f; } while (0)
-
-static void readReportBits( const UInt8 * src,
-                           UInt32 *      dst,
-                           UInt32        bitsToCopy,
-                           UInt32        srcStartBit = 0,
-                           bool          shouldSignExtend = false,
-                           bool *        valueChanged = 0)
+void IOHIDElementPrivate::compileReportExtraction()
 {
-    UInt32 srcOffset;
-    UInt32 srcShift;
-    UInt32 dstShift      = 0;
-    UInt32 dstStartBit   = 0;
-    UInt32 dstOffset     = 0;
-    UInt32 lastDstOffset = 0;
-    UInt32 word          = 0;
-    UInt8  bitsProcessed;
-	UInt32 totalBitsProcessed = 0;
-
-    while ( bitsToCopy )
-    {
-        UInt32 tmp;
-
-        UpdateByteOffsetAndShift( srcStartBit, srcOffset, srcShift );
-
-        bitsProcessed = min( bitsToCopy,
-                             min( 8 - srcShift, 32 - dstShift ) );
-
-        tmp = (src[srcOffset] >> srcShift) & BIT_MASK(bitsProcessed);
-
-        word |= ( tmp << dstShift );
-
-        dstStartBit += bitsProcessed;
-        srcStartBit += bitsProcessed;
-        bitsToCopy  -= bitsProcessed;
-		totalBitsProcessed += bitsProcessed;
-
-        UpdateWordOffsetAndShift( dstStartBit, dstOffset, dstShift );
+    UInt32 bits = _reportBits * _reportCount;
 
-        if ( ( dstOffset != lastDstOffset ) || ( bitsToCopy == 0 ) )
-        {
-            // sign extend negative values
-			// if this is the leftmost word of the result
-			if ((lastDstOffset == 0) &&
-				// and the logical min or max is less than zero
-				// so we should sign extend
-				(shouldSignExtend))
-			{
-				// SInt32 temp = word;
-				
-				// is this less than a full word
-				if ((totalBitsProcessed < 32) && 
-					// and the value negative (high bit set)
-					(word & (1 << (totalBitsProcessed - 1))))
-					// or in all 1s above the significant bit
-					word |= ~(BIT_MASK(totalBitsProcessed));
-			}
-
-			
-			if ( dst[lastDstOffset] != word )
-            {
-                dst[lastDstOffset] = word;
-				if (valueChanged) *valueChanged = true;
-            }
-            word = 0;
-            lastDstOffset = dstOffset;
-        }
-    }
-}
+    bzero(&_reportExtraction, sizeof(_reportExtraction));
 
-static void writeReportBits( const UInt32 * src,
-                           UInt8 *        dst,
-                           UInt32         bitsToCopy,
-                           UInt32         dstStartBit = 0)
-{
-    UInt32 dstOffset;
-    UInt32 dstShift;
-    UInt32 srcShift    = 0;
-    UInt32 srcStartBit = 0;
-    UInt32 srcOffset   = 0;
-    UInt8  bitsProcessed;
-    UInt32 tmp;
-
-    while ( bitsToCopy )
-    {
-        UpdateByteOffsetAndShift( dstStartBit, dstOffset, dstShift );
-
-        bitsProcessed = min( bitsToCopy,
-                             min( 8 - dstShift, 32 - srcShift ) );
-
-        tmp = (src[srcOffset] >> srcShift) & BIT_MASK(bitsProcessed);
-
-        dst[dstOffset] |= ( tmp << dstShift );
+    if ( (bits == 0) || (bits > 32) )
+        return;
 
-        dstStartBit += bitsProcessed;
-        srcStartBit += bitsProcessed;
-        bitsToCopy  -= bitsProcessed;
+    UpdateByteOffsetAndShift( _reportStartBit, _reportExtraction.byteOffset, _reportExtraction.shift );
 
-        UpdateWordOffsetAndShift( srcStartBit, srcOffset, srcShift );
-    }
+    _reportExtraction.byteCount  = (_reportExtraction.shift + bits + 7) >> 3;
+    _reportExtraction.mask       = WORD_MASK(bits);
+    _reportExtraction.signExtend = (bits < 32) && (((SInt32)_logicalMin < 0) || ((SInt32)_logicalMax < 0));
 }
 
 //---------------------------------------------------------------------------
@@ -1124,12 +1081,30 @@ bool IOHIDElementPrivate::processReport(
 		
         // Get the element value from the report.
 
-        readReportBits( (UInt8 *) reportData,   /* source buffer      */
-                       _elementValue->value,   /* destination buffer */
-                       (_reportBits * _reportCount), /* bits to copy       */
-                       _reportStartBit,        /* source start bit   */
-                       (((SInt32)_logicalMin < 0) || ((SInt32)_logicalMax < 0)), /* should sign extend */
-                       &changed );             /* did value change?  */
+        if ( _reportExtraction.byteCount )
+        {
+            UInt32 value = extractReportValue( (UInt8 *) reportData,
+                                               _reportExtraction.byteOffset,
+                                               _reportExtraction.byteCount,
+                                               _reportExtraction.shift,
+                                               _reportExtraction.mask,
+                                               _reportExtraction.signExtend );
+
+            if ( _elementValue->value[0] != value )
+            {
+                _elementValue->value[0] = value;
+                changed = true;
+            }
+        }
+        else
+        {
+            readReportBits( (UInt8 *) reportData,   /* source buffer      */
+                           _elementValue->value,   /* destination buffer */
+                           (_reportBits * _reportCount), /* bits to copy       */
+                           _reportStartBit,        /* source start bit   */
+                           (((SInt32)_logicalMin < 0) || ((SInt32)_logicalMax < 0)), /* should sign extend */
+                           &changed );             /* did value change?  */
+        }
 
         // Set a timestamp to indicate the last modification time.
         // We should set the time stamp if the generation is 1 regardless if the value
@@ -1153,7 +1128,7 @@ bool IOHIDElementPrivate::processReport(
             for ( UInt32 i = 0; (queue = (IOHIDEventQueue *) _queueArray->getObject(i)); i++ )
             {
                 if ( shouldProcess || (queue->getOptions() & kIOHIDQueueOptionsTypeEnqueueAll))
-                    queue->enqueue( (void *) _elementValue, _elementValue->totalSize );
+                    queue->enqueueElementValue( _elementValue );
                 }
         } while ( 0 );
 
@@ -1169,6 +1144,135 @@ bool IOHIDElementPrivate::processReport(
     return changed;
 }
 
+//---------------------------------------------------------------------------
+// Called in place of processReport() when the device knows which bytes of
+// the report changed since the previous report with the same ID. Returns
+// true if the element's bits are untouched and processReport() would have
+// left its value alone, after applying the few side effects processReport()
+// has for an unchanged value. Returns false if the report must be processed.
+
+bool IOHIDElementPrivate::skipUnchangedReport(
+                                    UInt8                       reportID,
+                                    UInt32                      reportBits,
+                                    const UInt32 *              changedBytes,
+                                    IOHIDElementPrivate **      next)
+{
+    UInt32 startBit = _reportStartBit;
+    UInt32 endBit   = _reportStartBit + (_reportBits * _reportCount);
+
+    // Interrupt report handlers and relative elements are processed on
+    // every report, even if it did not change. Array and rollover handling
+    // have their own rules, so leave those to processReport() as well.
+    if ( ( _reportID != reportID ) ||
+         _isInterruptReportHandler ||
+         ( _flags & kHIDDataRelativeBit ) ||
+         IsArrayElement(this) ||
+         _rollOverElementPtr )
+        return false;
+
+    if ( ( _reportSize && ( reportBits < _reportSize ) ) ||
+         ( endBit > reportBits ) ||
+         ( endBit == startBit ) )
+        return false;
+
+    for ( UInt32 byte = startBit >> 3; byte <= ((endBit - 1) >> 3); byte++ )
+    {
+        if ( changedBytes[byte >> 5] & (1U << (byte & 0x1f)) )
+            return false;
+    }
+
+    // Queues that want every report still get one.
+    if ( _queueArray )
+    {
+        IOHIDEventQueue * queue;
+
+        for ( UInt32 i = 0; (queue = (IOHIDEventQueue *) _queueArray->getObject(i)); i++ )
+        {
+            if ( queue->getOptions() & kIOHIDQueueOptionsTypeEnqueueAll )
+                return false;
+        }
+    }
+
+    _previousValue = _elementValue->value[0];
+
+    if (_transactionState)
+        _transactionState = kIOHIDTransactionStateIdle;
+
+    if (next)
+        *next = _nextReportHandler;
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+// Folds an older, still queued report into a newer one with the same ID so
+// that only the newer report has to be delivered. Absolute values already
+// hold their newest state in the newer report; relative values are replaced
+// by the sum of both reports. Returns false if this element cannot be merged
+// without losing information, in which case both reports must be delivered.
+
+bool IOHIDElementPrivate::coalesceReport(
+                                    UInt8                       reportID,
+                                    const UInt8 *               olderReport,
+                                    UInt8 *                     newerReport,
+                                    UInt32                      reportBits,
+                                    IOHIDElementPrivate **      next)
+{
+    UInt32  bits = _reportBits * _reportCount;
+    bool    signExtend;
+    SInt64  sum;
+    UInt32  older = 0;
+    UInt32  newer = 0;
+
+    if (next)
+        *next = _nextReportHandler;
+
+    if ( _reportID != reportID )
+        return true;
+
+    // Every button transition and key press has to be seen.
+    if ( IsArrayElement(this) ||
+         ( _usagePage == kHIDPage_Button ) ||
+         ( _usagePage == kHIDPage_KeyboardOrKeypad ) )
+        return false;
+
+    if ( ( _flags & kHIDDataRelativeBit ) == 0 )
+        return true;
+
+    if ( ( _reportCount != 1 ) ||
+         ( bits == 0 ) ||
+         ( bits > 32 ) ||
+         ( ( _reportStartBit + bits ) > reportBits ) )
+        return false;
+
+    signExtend = (bits < 32) && (((SInt32)_logicalMin < 0) || ((SInt32)_logicalMax < 0));
+
+    readReportBits( olderReport, &older, bits, _reportStartBit, signExtend );
+    readReportBits( newerReport, &newer, bits, _reportStartBit, signExtend );
+
+    if ( signExtend )
+        sum = (SInt64)(SInt32)older + (SInt64)(SInt32)newer;
+    else
+        sum = (SInt64)older + (SInt64)newer;
+
+    // A sum the field cannot represent would be clipped by the device's
+    // own rules, so leave both reports alone instead.
+    if ( signExtend ) {
+        if ( ( sum < (SInt32)_logicalMin ) || ( sum > (SInt32)_logicalMax ) )
+            return false;
+    }
+    else if ( sum > WORD_MASK(bits) ) {
+        return false;
+    }
+
+    newer = (UInt32) sum;
+
+    clearReportBits( newerReport, bits, _reportStartBit );
+    writeReportBits( &newer, newerReport, bits, _reportStartBit );
+
+    return true;
+}
+
 //---------------------------------------------------------------------------
 // 
 
@@ -1567,14 +1671,38 @@ void IOHIDElementPrivate::setArrayElementValue(UInt32 index, UInt32 value)
                 (queue = (IOHIDEventQueue *) element->_queueArray->getObject(i));
                 i++ )
         {
-            queue->enqueue( (void *) element->_elementValue,
-                            element->_elementValue->totalSize );
+            queue->enqueueElementValue( element->_elementValue );
         }
     }
         
 
 }
 
+//---------------------------------------------------------------------------
+// Returns whether a selector is in a set of array selectors. Selectors
+// inside the bitset's range are looked up directly, anything else is
+// found by scanning the selectors themselves.
+
+static inline bool ContainsArraySelector( UInt32            arraySel,
+                                          UInt32            index,
+                                          UInt32            range,
+                                          const UInt32 *    bits,
+                                          const UInt32 *    selectors,
+                                          const UInt32 *    present,
+                                          UInt32            count )
+{
+    if ( index < range )
+        return TestBit(bits, index) != 0;
+
+    for ( UInt32 i = 0; i < count; i++ )
+    {
+        if ( ( !present || TestBit(present, i) ) && ( selectors[i] == arraySel ) )
+            return true;
+    }
+
+    return false;
+}
+
 bool IOHIDElementPrivate::processArrayReport(	UInt8			reportID,
                                         void *			reportData,
                                         UInt32			reportBits,
@@ -1586,6 +1714,10 @@ bool IOHIDElementPrivate::processArrayReport(	UInt8			reportID,
     UInt32		iOldArray	= 0;
     bool		found		= false;
     bool		changed		= false;
+    UInt32 *    oldBits     = _arraySelectorBits;
+    UInt32 *    newBits     = oldBits + BitsetWords(_arraySelectorRange);
+    UInt32 *    presentBits = newBits + BitsetWords(_arraySelectorRange);
+    UInt32      index;
         
     // RY: Process the arry selector elements.  If any of their values
     // haven't changed, don't bother with any further processing.  
@@ -1615,57 +1747,70 @@ bool IOHIDElementPrivate::processArrayReport(	UInt8			reportID,
         }
     }
                                     
+    // Gather the new selectors, and build bitsets of the old and new ones
+    // so that each side can be checked against the other in one pass.
+    for (iNewArray = 0; iNewArray < _reportCount; iNewArray ++)
+    {
+        element = (_duplicateElements) ? (IOHIDElementPrivate *)_duplicateElements->getObject(iNewArray) : this;
+        if (!element)
+            continue;
+
+        arraySel = element->_elementValue->value[0];
+
+        _newArraySelectors[iNewArray] = arraySel;
+        SetBit(presentBits, iNewArray);
+
+        if ((index = GetArrayItemIndex(arraySel)) < _arraySelectorRange)
+            SetBit(newBits, index);
+    }
+
+    for (iOldArray = 0; iOldArray < _reportCount; iOldArray ++)
+    {
+        if ((index = GetArrayItemIndex(_oldArraySelectors[iOldArray])) < _arraySelectorRange)
+            SetBit(oldBits, index);
+    }
+
     // Check the existing indexes against the originals
     for (iOldArray = 0; iOldArray < _reportCount; iOldArray ++)
     {
         arraySel = _oldArraySelectors[iOldArray];
-        
-        found = false;
 
-        for (iNewArray = 0; iNewArray < _reportCount; iNewArray ++)
-        {
-            element = (_duplicateElements) ? (IOHIDElementPrivate *)_duplicateElements->getObject(iNewArray) : this;
-            if (element && (arraySel == element->_elementValue->value[0]))
-            {
-                found = true;
-                break;
-            }
-        }
-        
         // The index is no longer present.  Set its value to 0.
-        if (!found)
+        if (!ContainsArraySelector(arraySel, GetArrayItemIndex(arraySel), _arraySelectorRange, newBits, _newArraySelectors, presentBits, _reportCount))
             setArrayElementValue(GetArrayItemIndex(arraySel), 0);
     }
     
     // Now add new indexes to _oldArraySelectors
     for (iNewArray = 0; iNewArray < _reportCount; iNewArray ++)
     {
-        if (!(element = (_duplicateElements) ? (IOHIDElementPrivate *)_duplicateElements->getObject(iNewArray) : this))
+        if (!TestBit(presentBits, iNewArray))
             continue;
             
-        arraySel = element->_elementValue->value[0];
+        arraySel = _newArraySelectors[iNewArray];
                 
-        found = false;
-
-        for (iOldArray = 0; iOldArray < _reportCount; iOldArray ++)
-        {
-            if (arraySel == _oldArraySelectors[iOldArray])
-            {
-                found = true;
-                break;
-            }
-        }
-        
         // This is a new index.  Set its value to 1.
-        if (!found)
+        if (!ContainsArraySelector(arraySel, GetArrayItemIndex(arraySel), _arraySelectorRange, oldBits, _oldArraySelectors, NULL, _reportCount))
             setArrayElementValue(GetArrayItemIndex(arraySel), 1);
     }
             
-    // save the new array to _oldArraySelectors for future reference
+    // save the new array to _oldArraySelectors for future reference, and
+    // leave the bitsets clear for the next report
     for (iOldArray = 0; iOldArray < _reportCount; iOldArray ++)
     {
-        if ( NULL != (element = ((_duplicateElements) ? (IOHIDElementPrivate *)_duplicateElements->getObject(iOldArray) : this)) )
-        _oldArraySelectors[iOldArray] = element->_elementValue->value[0];
+        if ((index = GetArrayItemIndex(_oldArraySelectors[iOldArray])) < _arraySelectorRange)
+            ClearBit(oldBits, index);
+
+        if (!TestBit(presentBits, iOldArray))
+            continue;
+
+        ClearBit(presentBits, iOldArray);
+
+        arraySel = _newArraySelectors[iOldArray];
+
+        if ((index = GetArrayItemIndex(arraySel)) < _arraySelectorRange)
+            ClearBit(newBits, index);
+
+        _oldArraySelectors[iOldArray] = arraySel;
     }
 
     return changed;
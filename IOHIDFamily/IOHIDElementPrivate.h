@@ -92,6 +92,12 @@ protected:
     OSArray                *_duplicateElements;
     UInt32                 *_oldArraySelectors;
     
+    // Scratch space used to diff array selectors: the new selectors, then
+    // bitsets of the old and new selectors and of which new ones are set.
+    UInt32                 *_newArraySelectors;
+    UInt32                 *_arraySelectorBits;
+    UInt32                  _arraySelectorRange;
+    
     bool                    _isInterruptReportHandler;
     
     bool                    _shouldTickleActivity;
@@ -108,6 +114,16 @@ protected:
     
     UInt32                  _previousValue;
     
+    // Precomputed location of a single word value within its report.
+    // A zero byteCount means the generic bit walk must be used.
+    struct {
+        UInt32     byteOffset;
+        UInt32     mask;
+        UInt8      byteCount;
+        UInt8      shift;
+        bool       signExtend;
+    } _reportExtraction;
+    
     virtual bool init( IOHIDDevice * owner, IOHIDElementType type );
 
     virtual void free();
@@ -174,6 +190,17 @@ public:
                                 IOHIDElementPrivate **      next    = 0,
                                 IOOptionBits                options = 0 );
 
+    bool skipUnchangedReport( UInt8                     reportID,
+                              UInt32                    reportBits,
+                              const UInt32 *            changedBytes,
+                              IOHIDElementPrivate **    next );
+
+    bool coalesceReport( UInt8                      reportID,
+                         const UInt8 *              olderReport,
+                         UInt8 *                    newerReport,
+                         UInt32                     reportBits,
+                         IOHIDElementPrivate **     next );
+
     virtual bool createReport( UInt8           reportID,
                                void *        reportData, // report should be allocated outside this method
                                UInt32 *        reportLength,
@@ -198,6 +225,8 @@ public:
                                     IOVirtualAddress        address,
                                     void *                  location);
 
+    void compileReportExtraction();
+
     virtual IOHIDElementPrivate * setNextReportHandler( IOHIDElementPrivate * element );
 
     virtual void setRollOverElementPtr(IOHIDElementPrivate ** rollOverElementPtr);
@@ -38,6 +38,284 @@
 
 OSDefineMetaClassAndStructors(IOHIDEvent, OSObject)
 
+//==============================================================================
+// Event object and payload caches
+//
+// Digitizer, sensor and pointer services create and release an event for
+// every report.  Released event objects and payloads are kept on free lists
+// rather than handed back to the allocator.  Payload caches are keyed by the
+// sizes IOHIDEventGetSize reports, so each one serves every event type that
+// shares a layout.  Payloads of any other size, such as vendor defined events
+// with additional capacity, bypass the caches.
+//==============================================================================
+#define kIOHIDEventCacheObjectDepth     128
+#define kIOHIDEventCacheDataDepth       32
+
+struct IOHIDEventCacheEntry {
+    IOHIDEventCacheEntry *  next;
+};
+
+struct IOHIDEventCache {
+    IOHIDEventCacheEntry *  free;
+    IOByteCount             size;
+    UInt32                  count;
+    UInt32                  depth;
+    UInt64                  hits;
+    UInt64                  misses;
+};
+
+// Entry 0 caches event objects, the rest cache payloads sorted by size.
+static IOHIDEventCache  gIOHIDEventCaches[kIOHIDEventTypeCount + 1];
+static UInt32           gIOHIDEventCacheCount   = 0;
+static IOSimpleLock *   gIOHIDEventCacheLock    = 0;
+
+static IOSimpleLock * IOHIDEventCacheLock()
+{
+    if ( !gIOHIDEventCacheLock ) {
+        IOSimpleLock * lock = IOSimpleLockAlloc();
+
+        if ( lock && !OSCompareAndSwapPtr(0, lock, &gIOHIDEventCacheLock) )
+            IOSimpleLockFree(lock);
+    }
+
+    return gIOHIDEventCacheLock;
+}
+
+//==============================================================================
+// IOHIDEventCacheInit
+//
+// Builds the size classes.  Called with the cache lock held.
+//==============================================================================
+static void IOHIDEventCacheInit()
+{
+    UInt32  type, index, count = 1;
+    size_t  size;
+
+    gIOHIDEventCaches[0].size   = sizeof(IOHIDEvent);
+    gIOHIDEventCaches[0].depth  = kIOHIDEventCacheObjectDepth;
+
+    for ( type=0; type<kIOHIDEventTypeCount; type++ ) {
+        size = 0;
+
+        IOHIDEventGetSize(type, size);
+
+        if ( size < sizeof(IOHIDEventCacheEntry) )
+            continue;
+
+        for ( index=1; index<count && gIOHIDEventCaches[index].size<size; index++ ) {}
+
+        if ( index<count && gIOHIDEventCaches[index].size==size )
+            continue;
+
+        for ( UInt32 i=count; i>index; i-- )
+            gIOHIDEventCaches[i] = gIOHIDEventCaches[i-1];
+
+        bzero(&gIOHIDEventCaches[index], sizeof(IOHIDEventCache));
+
+        gIOHIDEventCaches[index].size   = size;
+        gIOHIDEventCaches[index].depth  = kIOHIDEventCacheDataDepth;
+        count++;
+    }
+
+    gIOHIDEventCacheCount = count;
+}
+
+//==============================================================================
+// IOHIDEventCacheFind
+//
+// Returns the cache for an object or payload of the given size, or NULL if
+// there is none.  Called with the cache lock held.
+//==============================================================================
+static IOHIDEventCache * IOHIDEventCacheFind(bool object, IOByteCount size)
+{
+    UInt32 low, high, mid;
+
+    if ( !gIOHIDEventCacheCount )
+        IOHIDEventCacheInit();
+
+    if ( object )
+        return ( size == gIOHIDEventCaches[0].size ) ? &gIOHIDEventCaches[0] : NULL;
+
+    low     = 1;
+    high    = gIOHIDEventCacheCount;
+
+    while ( low < high ) {
+        mid = (low + high) / 2;
+
+        if ( gIOHIDEventCaches[mid].size < size )
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    return ( low < gIOHIDEventCacheCount && gIOHIDEventCaches[low].size == size ) ? &gIOHIDEventCaches[low] : NULL;
+}
+
+//==============================================================================
+// IOHIDEventCacheGet
+//==============================================================================
+static void * IOHIDEventCacheGet(bool object, IOByteCount size)
+{
+    IOSimpleLock *          lock    = IOHIDEventCacheLock();
+    IOHIDEventCache *       cache;
+    IOHIDEventCacheEntry *  entry   = NULL;
+
+    if ( !lock )
+        return NULL;
+
+    IOSimpleLockLock(lock);
+
+    if ( (cache = IOHIDEventCacheFind(object, size)) ) {
+        if ( (entry = cache->free) ) {
+            cache->free = entry->next;
+            cache->count--;
+            cache->hits++;
+        } else {
+            cache->misses++;
+        }
+    }
+
+    IOSimpleLockUnlock(lock);
+
+    return entry;
+}
+
+//==============================================================================
+// IOHIDEventCachePut
+//
+// Returns false if the memory was not cached and should be freed.
+//==============================================================================
+static bool IOHIDEventCachePut(bool object, void * mem, IOByteCount size)
+{
+    IOSimpleLock *          lock    = IOHIDEventCacheLock();
+    IOHIDEventCache *       cache;
+    IOHIDEventCacheEntry *  entry   = (IOHIDEventCacheEntry *)mem;
+    bool                    cached  = false;
+
+    if ( !lock )
+        return false;
+
+    IOSimpleLockLock(lock);
+
+    cache = IOHIDEventCacheFind(object, size);
+    if ( cache && cache->count < cache->depth ) {
+        entry->next = cache->free;
+        cache->free = entry;
+        cache->count++;
+        cached = true;
+    }
+
+    IOSimpleLockUnlock(lock);
+
+    return cached;
+}
+
+//==============================================================================
+// IOHIDEventCacheTeardown
+//
+// Hands the cached objects and payloads back to the allocator and frees the
+// lock when the kext unloads.  No events are left by then: the kext cannot
+// unload while instances of its classes exist.
+//==============================================================================
+static class IOHIDEventCacheTeardown {
+public:
+    ~IOHIDEventCacheTeardown()
+    {
+        IOHIDEventCacheEntry * entry;
+
+        for ( UInt32 index=0; index<gIOHIDEventCacheCount; index++ ) {
+            IOHIDEventCache * cache = &gIOHIDEventCaches[index];
+
+            while ( (entry = cache->free) ) {
+                cache->free = entry->next;
+
+                if ( index == 0 )
+                    OSObject::operator delete(entry, cache->size);
+                else
+                    IOFree(entry, cache->size);
+            }
+            cache->count = 0;
+        }
+        gIOHIDEventCacheCount = 0;
+
+        if ( gIOHIDEventCacheLock ) {
+            IOSimpleLockFree(gIOHIDEventCacheLock);
+            gIOHIDEventCacheLock = 0;
+        }
+    }
+} gIOHIDEventCacheTeardown;
+
+static IOHIDEventData * IOHIDEventAllocData(IOByteCount capacity)
+{
+    IOHIDEventData * data = (IOHIDEventData *)IOHIDEventCacheGet(false, capacity);
+
+    if ( !data )
+        data = (IOHIDEventData *)IOMalloc(capacity);
+
+    return data;
+}
+
+static void IOHIDEventFreeData(IOHIDEventData * data, IOByteCount capacity)
+{
+    if ( !IOHIDEventCachePut(false, data, capacity) )
+        IOFree(data, capacity);
+}
+
+//==============================================================================
+// IOHIDEvent::operator new
+//==============================================================================
+void * IOHIDEvent::operator new(size_t size)
+{
+    void * mem = IOHIDEventCacheGet(true, size);
+
+    if ( !mem )
+        return super::operator new(size);
+
+    bzero(mem, size);
+
+    return mem;
+}
+
+//==============================================================================
+// IOHIDEvent::operator delete
+//==============================================================================
+void IOHIDEvent::operator delete(void * mem, size_t size)
+{
+    if ( !IOHIDEventCachePut(true, mem, size) )
+        super::operator delete(mem, size);
+}
+
+//==============================================================================
+// IOHIDEvent::getCacheStatistics
+//==============================================================================
+bool IOHIDEvent::getCacheStatistics(UInt32 index, IOByteCount * size, UInt64 * hits, UInt64 * misses)
+{
+    IOSimpleLock *  lock    = IOHIDEventCacheLock();
+    bool            result  = false;
+
+    if ( !lock )
+        return false;
+
+    IOSimpleLockLock(lock);
+
+    if ( !gIOHIDEventCacheCount )
+        IOHIDEventCacheInit();
+
+    if ( index < gIOHIDEventCacheCount ) {
+        if ( size )
+            *size = gIOHIDEventCaches[index].size;
+        if ( hits )
+            *hits = gIOHIDEventCaches[index].hits;
+        if ( misses )
+            *misses = gIOHIDEventCaches[index].misses;
+        result = true;
+    }
+
+    IOSimpleLockUnlock(lock);
+
+    return result;
+}
+
 //==============================================================================
 // IOHIDEvent::initWithCapacity
 //==============================================================================
@@ -46,10 +324,11 @@ bool IOHIDEvent::initWithCapacity(IOByteCount capacity)
     if (!super::init())
         return false;
 
-    if (_data && (!capacity || _capacity < capacity) ) {
+    if (_data && (!capacity || _allocatedCapacity < capacity) ) {
         // clean out old data's storage if it isn't big enough
-        IOFree(_data, _capacity);
+        IOHIDEventFreeData(_data, _allocatedCapacity);
         _data = 0;
+        _allocatedCapacity = 0;
     }
 
     _capacity = capacity;
@@ -57,12 +336,20 @@ bool IOHIDEvent::initWithCapacity(IOByteCount capacity)
     if ( !_capacity )
         return false;
 
-    if ( !_data && !(_data = (IOHIDEventData *) IOMalloc(_capacity)))
-        return false;
+    // A larger payload left over from an earlier init is reused as is, and
+    // keeps its allocation size so it goes back to the right cache.
+    if ( !_data ) {
+        if ( !(_data = IOHIDEventAllocData(_capacity)) )
+            return false;
+        _allocatedCapacity = _capacity;
+    }
 
     bzero(_data, _capacity);
     _data->size = _capacity;
-    _children = NULL;
+    releaseChildren();
+
+    // The event is now a single payload with no children
+    adjustLength((SInt64)_capacity - (SInt64)_length, 1 - (SInt32)_eventCount);
     
     return true;
 }
@@ -106,17 +393,16 @@ bool IOHIDEvent::initWithTypeTimeStamp(IOHIDEventType type, AbsoluteTime timeSta
 //==============================================================================
 void IOHIDEvent::free()
 {
-    if (_capacity != EXTERNAL && _data && _capacity) {
-        IOFree(_data, _capacity);
+    if (_capacity != EXTERNAL && _data && _allocatedCapacity) {
+        IOHIDEventFreeData(_data, _allocatedCapacity);
         _data = NULL;
         _capacity = 0;
+        _allocatedCapacity = 0;
     }
 
-    if ( _children ) {
-        // We should probably iterate over each child to clear the parent
-        _children->release();
-        _children = NULL;
-    }
+    // We should probably iterate over each child to clear the parent
+    releaseChildren();
+
     super::free();
 }
 
@@ -990,6 +1276,57 @@ IOHIDEvent * IOHIDEvent::vendorDefinedEvent(
     return me;
 }
 
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// IOHIDEvent::batchEvent
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+IOHIDEvent * IOHIDEvent::batchEvent(
+                                    AbsoluteTime            timeStamp,
+                                    UInt32                  usagePage,
+                                    UInt32                  usage,
+                                    IOHIDEventType          sampleType,
+                                    UInt32                  maxSamples,
+                                    UInt32                  sampleDataLength,
+                                    IOOptionBits            options)
+{
+    IOHIDVendorDefinedEventData *   event;
+    IOHIDEventBatchData *           batch;
+    IOHIDEvent *                    me          = NULL;
+    size_t                          sampleSize  = 0;
+    UInt32                          stride;
+
+    IOHIDEventGetSize(sampleType, sampleSize);
+    if ( !sampleSize || !maxSamples || sampleDataLength > UINT32_MAX - sizeof(uint64_t) - sampleSize )
+        return NULL;
+
+    stride = (UInt32)(sizeof(uint64_t) + sampleSize + sampleDataLength);
+    if ( maxSamples > (UINT32_MAX - sizeof(IOHIDVendorDefinedEventData) - sizeof(IOHIDEventBatchData)) / stride )
+        return NULL;
+
+    me = new IOHIDEvent;
+    if (me && !me->initWithTypeTimeStamp(kIOHIDEventTypeVendorDefined, timeStamp, options, sizeof(IOHIDEventBatchData) + (maxSamples * stride))) {
+        me->release();
+        return NULL;
+    }
+
+    event = (IOHIDVendorDefinedEventData *)me->_data;
+    batch = (IOHIDEventBatchData *)event->data;
+
+    event->usagePage    = usagePage;
+    event->usage        = usage;
+    event->version      = kIOHIDEventBatchVersion;
+    event->length       = sizeof(IOHIDEventBatchData);
+
+    batch->sampleType   = sampleType;
+    batch->sampleStride = stride;
+    batch->sampleCount  = 0;
+
+    // Only the samples appended so far are serialized
+    event->size = sizeof(IOHIDVendorDefinedEventData) + sizeof(IOHIDEventBatchData);
+    me->adjustLength((SInt64)event->size - (SInt64)me->_capacity, 0);
+
+    return me;
+}
+
 //++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 // IOHIDEvent::biometricEvent
 //++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
@@ -1115,15 +1452,121 @@ exit:
 //==============================================================================
 void IOHIDEvent::appendChild(IOHIDEvent *childEvent)
 {
-    if (!_children) {
-        const OSObject *events[] = { childEvent };
+    IOHIDEvent **   children;
+    IOHIDEvent *    ancestor;
+    UInt32          capacity;
+
+    // An event belongs to at most one parent, whose cached length and event
+    // count include it, and can't be appended to itself or its descendants.
+    if ( !childEvent || childEvent->_parent )
+        return;
+
+    for ( ancestor=this; ancestor; ancestor=ancestor->_parent ) {
+        if ( ancestor == childEvent )
+            return;
+    }
 
-        _children = OSArray::withObjects(events, 1);
-        
-        _data->options |= kIOHIDEventOptionIsCollection;
-    } else {
-        _children->setObject(childEvent);
+    capacity = _children ? _childCapacity : kIOHIDEventInlineChildCount;
+
+    if ( _childCount == capacity ) {
+        // Spill to the heap, doubling the capacity each time it fills up
+        children = (IOHIDEvent **)IOMalloc(capacity * 2 * sizeof(IOHIDEvent *));
+        if ( !children )
+            return;
+
+        bcopy(getChildren(), children, _childCount * sizeof(IOHIDEvent *));
+
+        if ( _children )
+            IOFree(_children, _childCapacity * sizeof(IOHIDEvent *));
+
+        _children       = children;
+        _childCapacity  = capacity * 2;
     }
+
+    childEvent->retain();
+    getChildren()[_childCount++] = childEvent;
+
+    // Later changes to the child's subtree are propagated to its parent.
+    childEvent->_parent = this;
+
+    adjustLength(childEvent->_length, childEvent->_eventCount);
+
+    _data->options |= kIOHIDEventOptionIsCollection;
+}
+
+//==============================================================================
+// IOHIDEvent::appendBatchSample
+//==============================================================================
+bool IOHIDEvent::appendBatchSample(IOHIDEvent * sample)
+{
+    IOHIDVendorDefinedEventData *   event = (IOHIDVendorDefinedEventData *)_data;
+    IOHIDEventBatchData *           batch;
+    IOHIDEventBatchSample *         entry;
+
+    if ( !sample || _capacity == EXTERNAL )
+        return false;
+
+    if ( event->type != kIOHIDEventTypeVendorDefined || event->version != kIOHIDEventBatchVersion )
+        return false;
+
+    batch = (IOHIDEventBatchData *)event->data;
+
+    if ( sample->_data->type != batch->sampleType || sample->_data->size + sizeof(uint64_t) != batch->sampleStride )
+        return false;
+
+    if ( event->size + batch->sampleStride > _capacity )
+        return false;
+
+    entry = IOHIDEventBatchGetSample(batch, batch->sampleCount);
+    entry->timeStamp = *((uint64_t *)&sample->_timeStamp);
+    bcopy(sample->_data, IOHIDEventBatchGetSampleData(entry), sample->_data->size);
+
+    batch->sampleCount++;
+    event->length   += batch->sampleStride;
+    event->size     += batch->sampleStride;
+
+    adjustLength(batch->sampleStride, 0);
+
+    return true;
+}
+
+//==============================================================================
+// IOHIDEvent::adjustLength
+//
+// Keeps the serialized length and event count of this event and each of
+// its ancestors current, so that getLength does not have to walk the tree.
+//==============================================================================
+void IOHIDEvent::adjustLength(SInt64 lengthDelta, SInt32 countDelta)
+{
+    IOHIDEvent * event;
+
+    for ( event=this; event; event=event->_parent ) {
+        event->_length      += lengthDelta;
+        event->_eventCount  += countDelta;
+    }
+}
+
+//==============================================================================
+// IOHIDEvent::releaseChildren
+//==============================================================================
+void IOHIDEvent::releaseChildren()
+{
+    IOHIDEvent **   children = getChildren();
+    UInt32          i;
+
+    for ( i=0; i<_childCount; i++ ) {
+        if ( children[i]->_parent == this )
+            children[i]->_parent = NULL;
+
+        children[i]->release();
+    }
+
+    if ( _children )
+        IOFree(_children, _childCapacity * sizeof(IOHIDEvent *));
+
+    _children       = NULL;
+    _childCapacity  = 0;
+    _childCount     = 0;
 }
 
 //==============================================================================
@@ -1242,43 +1685,13 @@ void IOHIDEvent::setDoubleValue( IOHIDEventField         key,
 //==============================================================================
 size_t IOHIDEvent::getLength()
 {
-    _eventCount = 0;
-    return getLength(&_eventCount);
-}
-
-//==============================================================================
-// IOHIDEvent::getLength
-//==============================================================================
-IOByteCount IOHIDEvent::getLength(UInt32 * count)
-{
-    IOByteCount length = _data->size;
-
-    length += sizeof(IOHIDSystemQueueElement);
-
-    if ( _children )
-    {
-        UInt32          i, childCount;
-        IOHIDEvent *    child;
-
-        childCount = _children->getCount();
-
-        for(i=0 ;i<childCount; i++) {
-            if ( (child = (IOHIDEvent *)_children->getObject(i)) ) {
-                length += child->getLength(count) - sizeof(IOHIDSystemQueueElement);
-            }
-        }
-    }
-
-    if ( count )
-        *count = *count + 1;
-
-    return length;
+    return _length + sizeof(IOHIDSystemQueueElement);
 }
 
 //==============================================================================
 // IOHIDEvent::appendBytes
 //==============================================================================
-IOByteCount IOHIDEvent::appendBytes(UInt8 * bytes, IOByteCount withLength)
+IOByteCount IOHIDEvent::appendBytes(UInt8 * bytes, IOByteCount withLength, UInt8 depth)
 {
     IOByteCount size = 0;
 
@@ -1289,17 +1702,19 @@ IOByteCount IOHIDEvent::appendBytes(UInt8 * bytes, IOByteCount withLength)
 
     bcopy(_data, bytes, size);
 
-    if ( _children )
-    {
-        UInt32          i, childCount;
-        IOHIDEvent *    child;
+    // Record the tree depth so that withBytes can rebuild the hierarchy
+    ((IOHIDEventData *)bytes)->depth = depth;
 
-        childCount = _children->getCount();
+    if ( depth < UINT8_MAX )
+        depth++;
 
-        for(i=0 ;i<childCount; i++) {
-            if ( (child = (IOHIDEvent *)_children->getObject(i)) ) {
-                size += child->appendBytes(bytes + size, withLength - size);
-            }
+    if ( _childCount )
+    {
+        UInt32          i;
+        IOHIDEvent **   children = getChildren();
+
+        for(i=0 ;i<_childCount; i++) {
+            size += children[i]->appendBytes(bytes + size, withLength - size, depth);
         }
     }
 
@@ -1312,45 +1727,59 @@ IOByteCount IOHIDEvent::appendBytes(UInt8 * bytes, IOByteCount withLength)
 IOHIDEvent * IOHIDEvent::withBytes(     const void *            bytes,
                                         IOByteCount             size)
 {
-    IOHIDSystemQueueElement *   queueElement= NULL;
-    IOHIDEvent *                parent      = NULL;
-    UInt32                      index       = 0;
-    UInt32                      total       = 0;
-    UInt32                      offset      = 0;
-
-    if ( !bytes || !size || ( sizeof(IOHIDSystemQueueElement) > size ) )
+    IOHIDEventView          view;
+    const IOHIDEventData *  eventData;
+    IOHIDEvent *            parent          = NULL;
+    IOHIDEvent *            current         = NULL;
+    IOHIDEvent *            event;
+    IOByteCount             offset          = 0;
+    UInt32                  currentDepth    = 0;
+    UInt32                  depth;
+    size_t                  typeSize;
+
+    // The view only passes events of a known type that are at least as
+    // large as that type's layout.
+    if ( !view.initWithBytes(bytes, size) )
         return NULL;
 
-    queueElement    = (IOHIDSystemQueueElement *)bytes;
-    total           = size - sizeof(IOHIDSystemQueueElement);
+    while ( (eventData = view.getNextEvent(&offset)) ) {
+        typeSize = 0;
+        IOHIDEventGetSize(eventData->type, typeSize);
 
-    for (index=0; index<queueElement->eventCount && offset<total; index++)
-    {
-        if ( (queueElement->attributeLength + offset) > total )
-            break;
-        IOHIDEventData *    eventData   = (IOHIDEventData *)(queueElement->payload + queueElement->attributeLength + offset);
-        if ( eventData->type >= kIOHIDEventTypeCount )
-            break;
-        IOHIDEvent *        event       = IOHIDEvent::withType(eventData->type);
+        event = new IOHIDEvent;
+        if ( event && !event->initWithType(eventData->type, eventData->size - typeSize) ) {
+            event->release();
+            event = NULL;
+        }
 
         if ( !event )
             continue;
 
-        bcopy(eventData, event->_data, event->_data->size);
-        AbsoluteTime_to_scalar(&(event->_timeStamp)) = queueElement->timeStamp;
-        event->_options = queueElement->options;
-        event->_senderID = queueElement->senderID;
+        bcopy(eventData, event->_data, eventData->size);
+        event->_data->depth = 0;
+        event->_timeStamp   = view.getTimeStamp();
+        event->_options     = view.getOptions();
+        event->_senderID    = view.getSenderID();
 
-        if ( !parent )
-            parent = event;
-        else {
-            //Append event here;
-            event->release();
+        if ( !parent ) {
+            parent  = current = event;
+            continue;
         }
-        
-        if ( ((UInt32) (offset + eventData->size) ) <= offset )
-            break;
-        offset += eventData->size;
+
+        // Writers that do not record depth lay the children out flat under
+        // the first event.
+        depth = eventData->depth ? eventData->depth : 1;
+
+        while ( currentDepth >= depth && current->_parent ) {
+            current = current->_parent;
+            currentDepth--;
+        }
+
+        current->appendChild(event);
+        event->release();
+
+        current = event;
+        currentDepth++;
     }
 
     return parent;
@@ -1416,3 +1845,136 @@ uint64_t IOHIDEvent::getLatency(uint32_t scaleFactor)
 
     return ns / scaleFactor;
 }
+
+//==============================================================================
+// IOHIDEventView::initWithBytes
+//==============================================================================
+bool IOHIDEventView::initWithBytes(const void * bytes, IOByteCount size)
+{
+    const IOHIDSystemQueueElement * queueElement = (const IOHIDSystemQueueElement *)bytes;
+    const IOHIDEventData *          eventData;
+    IOByteCount                     total;
+    IOByteCount                     offset  = 0;
+    UInt32                          count   = 0;
+    size_t                          typeSize;
+
+    _bytes      = NULL;
+    _events     = NULL;
+    _length     = 0;
+    _eventCount = 0;
+
+    if ( !bytes || ( sizeof(IOHIDSystemQueueElement) > size ) )
+        return false;
+
+    total = size - sizeof(IOHIDSystemQueueElement);
+
+    if ( queueElement->attributeLength > total )
+        return false;
+
+    _bytes  = (const UInt8 *)bytes;
+    _events = queueElement->payload + queueElement->attributeLength;
+    total  -= queueElement->attributeLength;
+
+    // Validate every event once so that getNextEvent can trust the sizes
+    while ( count < queueElement->eventCount && ( total - offset ) >= sizeof(IOHIDEventData) ) {
+        eventData = (const IOHIDEventData *)(_events + offset);
+
+        if ( eventData->type >= kIOHIDEventTypeCount )
+            break;
+
+        typeSize = 0;
+        IOHIDEventGetSize(eventData->type, typeSize);
+
+        // Types without a known layout can't be rebuilt, and every event
+        // needs at least the common header that withBytes writes to.
+        if ( !typeSize || eventData->size < typeSize || eventData->size < sizeof(IOHIDEventData) )
+            break;
+
+        if ( eventData->size > ( total - offset ) )
+            break;
+
+        offset += eventData->size;
+        count++;
+    }
+
+    _length     = offset;
+    _eventCount = count;
+
+    return ( count != 0 );
+}
+
+//==============================================================================
+// IOHIDEventView::getNextEvent
+//==============================================================================
+const IOHIDEventData * IOHIDEventView::getNextEvent(IOByteCount * offset) const
+{
+    const IOHIDEventData * eventData;
+
+    if ( *offset >= _length )
+        return NULL;
+
+    eventData = (const IOHIDEventData *)(_events + *offset);
+    *offset  += eventData->size;
+
+    return eventData;
+}
+
+//==============================================================================
+// IOHIDEventView::getTimeStamp
+//==============================================================================
+AbsoluteTime IOHIDEventView::getTimeStamp() const
+{
+    AbsoluteTime timeStamp;
+
+    AbsoluteTime_to_scalar(&timeStamp) = ((const IOHIDSystemQueueElement *)_bytes)->timeStamp;
+
+    return timeStamp;
+}
+
+//==============================================================================
+// IOHIDEventView::getSenderID
+//==============================================================================
+UInt64 IOHIDEventView::getSenderID() const
+{
+    return ((const IOHIDSystemQueueElement *)_bytes)->senderID;
+}
+
+//==============================================================================
+// IOHIDEventView::getOptions
+//==============================================================================
+IOOptionBits IOHIDEventView::getOptions() const
+{
+    return ((const IOHIDSystemQueueElement *)_bytes)->options;
+}
+
+//==============================================================================
+// IOHIDEventView::getIntegerValue
+//==============================================================================
+SInt32 IOHIDEventView::getIntegerValue(const IOHIDEventData * eventData, IOHIDEventField key)
+{
+    IOHIDEventType  fieldEvType = IOHIDEventFieldEventType(key);
+    uint32_t        fieldOffset = IOHIDEventFieldOffset(key);
+    SInt32          value       = 0;
+
+    if ( fieldEvType == kIOHIDEventTypeNULL || fieldEvType == eventData->type ) {
+        GET_EVENTDATA_VALUE(eventData, fieldEvType, fieldOffset, value, false);
+    }
+
+    return value;
+}
+
+//==============================================================================
+// IOHIDEventView::getFixedValue
+//==============================================================================
+IOFixed IOHIDEventView::getFixedValue(const IOHIDEventData * eventData, IOHIDEventField key)
+{
+    IOHIDEventType  fieldEvType = IOHIDEventFieldEventType(key);
+    uint32_t        fieldOffset = IOHIDEventFieldOffset(key);
+    IOFixed         value       = 0;
+
+    if ( fieldEvType == kIOHIDEventTypeNULL || fieldEvType == eventData->type ) {
+        GET_EVENTDATA_VALUE(eventData, fieldEvType, fieldOffset, value, true);
+    }
+
+    return value;
+}
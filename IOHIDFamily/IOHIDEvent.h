@@ -36,25 +36,36 @@
 
 typedef struct IOHIDEventData IOHIDEventData;
 
+// Collection events keep up to this many children inline before moving
+// them to a heap array.
+#define kIOHIDEventInlineChildCount 8
+
 class IOHIDEvent: public OSObject
 {
     OSDeclareAbstractStructors( IOHIDEvent )
     
     IOHIDEventData *    _data;
-    OSArray *           _children;
+    IOHIDEvent **       _children;
+    IOHIDEvent *        _inlineChildren[kIOHIDEventInlineChildCount];
+    UInt32              _childCount;
+    UInt32              _childCapacity;
     IOHIDEvent *        _parent;
     size_t              _capacity;
+    size_t              _allocatedCapacity;     // size of the _data allocation
     AbsoluteTime        _timeStamp;
     UInt64              _senderID;
     uint64_t            _typeMask;
     IOOptionBits        _options;
     UInt32              _eventCount;
+    IOByteCount         _length;
 
     bool initWithCapacity(IOByteCount capacity);
     bool initWithType(IOHIDEventType type, IOByteCount additionalCapacity=0);
     bool initWithTypeTimeStamp(IOHIDEventType type, AbsoluteTime timeStamp, IOOptionBits options = 0, IOByteCount additionalCapacity=0);
-    IOByteCount getLength(UInt32 * eventCount);
-    IOByteCount appendBytes(UInt8 * bytes, IOByteCount withLength);
+    void adjustLength(SInt64 lengthDelta, SInt32 countDelta);
+    IOByteCount appendBytes(UInt8 * bytes, IOByteCount withLength, UInt8 depth = 0);
+    void releaseChildren();
+    inline IOHIDEvent ** getChildren() { return _children ? _children : _inlineChildren; };
     
     static IOHIDEvent * _axisEvent (    IOHIDEventType          type,
                                         AbsoluteTime            timeStamp,
@@ -74,6 +85,18 @@ class IOHIDEvent: public OSObject
                                         IOOptionBits            options = 0);
 
 public:
+    static void *           operator new(size_t size);
+    static void             operator delete(void * mem, size_t size);
+
+    // Reports the size, hit and miss counts of the event cache at index.
+    // Index 0 is the event object cache, the rest are payload size classes.
+    // Returns false once index is past the last cache.
+    static bool             getCacheStatistics(
+                                        UInt32                  index,
+                                        IOByteCount *           size,
+                                        UInt64 *                hits,
+                                        UInt64 *                misses);
+
     static IOHIDEvent *     withBytes(  const void *            bytes,
                                         IOByteCount             size);
 
@@ -320,6 +343,19 @@ public:
                                         UInt32                  length,
                                         IOOptionBits            options = 0);
 
+    // Creates an empty batch with room for maxSamples events of sampleType.
+    // The batch is a vendor defined event whose data is an IOHIDEventBatchData.
+    // sampleDataLength is the data each sample carries past the fixed layout
+    // of its type, such as the payload of a vendor defined event.
+    static IOHIDEvent *     batchEvent(
+                                        AbsoluteTime            timeStamp,
+                                        UInt32                  usagePage,
+                                        UInt32                  usage,
+                                        IOHIDEventType          sampleType,
+                                        UInt32                  maxSamples,
+                                        UInt32                  sampleDataLength = 0,
+                                        IOOptionBits            options = 0);
+
     static IOHIDEvent *     biometricEvent(AbsoluteTime timeStamp, IOFixed level, IOHIDBiometricEventType eventType, IOOptionBits options=0);
 
     static IOHIDEvent *     atmosphericPressureEvent(AbsoluteTime timeStamp, IOFixed level, UInt32 sequence=0, IOOptionBits options=0);
@@ -360,8 +396,14 @@ public:
                                         IOFixed                         joystickRz,
                                         IOOptionBits                    options = 0);
 
+    // Does nothing if childEvent already has a parent, or is this event or
+    // one of its ancestors.
     virtual void            appendChild(IOHIDEvent *childEvent);
 
+    // Copies sample and its time stamp into a batch created by batchEvent.
+    // Returns false if the sample does not match the batch or it is full.
+    bool                    appendBatchSample(IOHIDEvent * sample);
+
     virtual AbsoluteTime    getTimeStamp();
     virtual void            setTimeStamp(AbsoluteTime timeStamp);
     
@@ -399,4 +441,32 @@ public:
 
 };
 
+// A read-only view of an event tree serialized by IOHIDEvent::readBytes.
+// It points into the caller's buffer, which must outlive it, and allocates
+// nothing, so replay and monitoring code can inspect every event without
+// building an IOHIDEvent for each child.  Events are returned in the order
+// they were serialized; each one's depth field gives its level in the tree.
+class IOHIDEventView
+{
+    const UInt8 *           _bytes;
+    const UInt8 *           _events;
+    IOByteCount             _length;
+    UInt32                  _eventCount;
+
+public:
+    bool                    initWithBytes(const void * bytes, IOByteCount size);
+
+    inline UInt32           getEventCount() const { return _eventCount; };
+
+    AbsoluteTime            getTimeStamp() const;
+    UInt64                  getSenderID() const;
+    IOOptionBits            getOptions() const;
+
+    // Start with *offset at 0.  Returns NULL after the last event.
+    const IOHIDEventData *  getNextEvent(IOByteCount * offset) const;
+
+    static SInt32           getIntegerValue(const IOHIDEventData * eventData, IOHIDEventField key);
+    static IOFixed          getFixedValue(const IOHIDEventData * eventData, IOHIDEventField key);
+};
+
 #endif /* _IOKIT_IOHIDEVENT_H */
@@ -78,6 +78,39 @@ typedef struct __attribute__((packed)) _IOHIDVendorDefinedEventData {
     uint8_t         data[0];
 } IOHIDVendorDefinedEventData;
 
+/*!
+    @typedef    IOHIDEventBatchData
+    @abstract   Payload of a batched sensor event.
+    @discussion A batch is a vendor defined event whose version is
+                kIOHIDEventBatchVersion.  Its data holds this header followed
+                by sampleCount samples of sampleStride bytes.  Each sample is an
+                IOHIDEventBatchSample: the sample time stamp followed by event
+                data laid out as IOHIDEventGetSize describes for sampleType.
+    @field      sampleType      Event type of every sample in the batch
+    @field      sampleStride    Size, in bytes, of each sample
+    @field      sampleCount     Number of samples in the batch
+*/
+#define kIOHIDEventBatchVersion     0x42415443  /* 'BATC' */
+
+typedef struct __attribute__((packed)) _IOHIDEventBatchSample {
+    uint64_t        timeStamp;
+    IOHIDEVENT_BASE;
+} IOHIDEventBatchSample;
+
+typedef struct __attribute__((packed)) _IOHIDEventBatchData {
+    uint32_t        sampleType;
+    uint32_t        sampleStride;
+    uint32_t        sampleCount;
+    uint32_t        reserved;
+    uint8_t         samples[0];
+} IOHIDEventBatchData;
+
+#define IOHIDEventBatchGetSample(batch, index)  \
+    ((IOHIDEventBatchSample *)((batch)->samples + ((index) * (batch)->sampleStride)))
+
+#define IOHIDEventBatchGetSampleData(sample)    \
+    ((IOHIDEventData *)&(sample)->size)
+
 enum {
     kIOHIDKeyboardIsRepeat          = kIOHIDEventOptionIsRepeat, // DEPRECATED
     kIOHIDKeyboardStickyKeyDown     = 0x00020000,
@@ -31,6 +31,13 @@ enum {
     kHIDQueueDisabled   = 0x02
 };
     
+// Largest report record built before it is handed to the queue. A report
+// that changes more values than fit is split across several records.
+#define kIOHIDReportRecordMaxSize   4096
+
+#define _record         _reserved->record
+#define _recordSize     _reserved->recordSize
+
 #define super IOSharedDataQueue
 OSDefineMetaClassAndStructors( IOHIDEventQueue, super )
 
@@ -48,6 +55,16 @@ IOHIDEventQueue * IOHIDEventQueue::withCapacity( UInt32 size )
         goto exit;
     }
 
+    queue->_reserved = IONew(ExpansionData, 1);
+    if ( !queue->_reserved )
+    {
+        queue->release();
+        queue = 0;
+        goto exit;
+    }
+
+    bzero(queue->_reserved, sizeof(ExpansionData));
+
     queue->_state               = 0;
     queue->_lock                = IOLockAlloc();
     queue->_numEntries          = size / DEFAULT_HID_ENTRY_SIZE;
@@ -95,6 +112,15 @@ void IOHIDEventQueue::free()
         _descriptor = 0;
     }
 
+    if ( _reserved )
+    {
+        if ( _record )
+            IOFree(_record, kIOHIDReportRecordMaxSize);
+
+        IODelete(_reserved, ExpansionData, 1);
+        _reserved = 0;
+    }
+
     super::free();
 }
 
@@ -133,6 +159,68 @@ Boolean IOHIDEventQueue::enqueue( void * data, UInt32 dataSize )
 }
 
 
+//---------------------------------------------------------------------------
+// Queue an element value. Queues created with
+// kIOHIDQueueOptionsTypeReportRecords collect the values into a report
+// record instead, which the device queues once it has handled the whole
+// report. The record is only touched from the device's workloop.
+
+Boolean IOHIDEventQueue::enqueueElementValue( IOHIDElementValue * value )
+{
+    IOHIDReportRecord * record;
+
+    if ( !(_options & kIOHIDQueueOptionsTypeReportRecords) || !_reserved )
+        return enqueue( value, value->totalSize );
+
+    if ( value->totalSize > kIOHIDReportRecordMaxSize - sizeof(IOHIDReportRecord) )
+        return enqueue( value, value->totalSize );
+
+    if ( !_record )
+    {
+        _record = (UInt8 *) IOMalloc(kIOHIDReportRecordMaxSize);
+        if ( !_record )
+            return enqueue( value, value->totalSize );
+    }
+
+    if ( _recordSize + value->totalSize > kIOHIDReportRecordMaxSize )
+        flushReportRecord();
+
+    record = (IOHIDReportRecord *) _record;
+
+    if ( !_recordSize )
+    {
+        record->cookie      = kIOHIDReportRecordCookie;
+        record->valueCount  = 0;
+        _recordSize         = sizeof(IOHIDReportRecord);
+    }
+
+    bcopy( value, _record + _recordSize, value->totalSize );
+
+    _recordSize += value->totalSize;
+    record->valueCount++;
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+// Queue the values collected for the current report, if any.
+
+Boolean IOHIDEventQueue::flushReportRecord()
+{
+    Boolean ret = true;
+
+    if ( !_reserved || !_recordSize )
+        return true;
+
+    ((IOHIDReportRecord *) _record)->totalSize = _recordSize;
+
+    ret = enqueue( _record, _recordSize );
+
+    _recordSize = 0;
+
+    return ret;
+}
+
 //---------------------------------------------------------------------------
 // Start the queue.
 
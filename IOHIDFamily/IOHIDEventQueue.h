@@ -59,7 +59,10 @@ protected:
     
     IOHIDQueueOptionsType   _options;
 
-    struct ExpansionData { };
+    struct ExpansionData {
+        UInt8 *             record;
+        UInt32              recordSize;
+    };
     /*! @var reserved
         Reserved for future use.  (Internal use only)  */
     ExpansionData * _reserved;
@@ -94,6 +97,9 @@ public:
 
     virtual IOMemoryDescriptor *getMemoryDescriptor();
 
+    Boolean enqueueElementValue( IOHIDElementValue * value );
+    Boolean flushReportRecord();
+
     OSMetaClassDeclareReservedUnused(IOHIDEventQueue,  0);
     OSMetaClassDeclareReservedUnused(IOHIDEventQueue,  1);
     OSMetaClassDeclareReservedUnused(IOHIDEventQueue,  2);
@@ -112,6 +112,17 @@ enum {
 #if TARGET_OS_EMBEDDED
 
 #define     _clientDict                         _reserved->clientDict
+#define     _batch                              _reserved->batch
+
+// Batched events are allocated up front for maxSamples samples
+#define     kBatchMaxSamplesLimit               256
+#define     kBatchMaxLatencyUSLimit             1000000
+
+// libkern's min() takes signed ints
+static inline UInt32 boundBatchValue(UInt32 value, UInt32 limit)
+{
+    return ( value > limit ) ? limit : value;
+}
 
 #define     kDebuggerDelayMS                    2500
 #define     kDebuggerLongDelayMS                5000
@@ -231,6 +242,26 @@ bool IOHIDEventService::start ( IOService * provider )
     if (!_multiAxis.timer || (_workLoop->addEventSource(_multiAxis.timer) != kIOReturnSuccess))
         return false;
 
+#if TARGET_OS_EMBEDDED
+    _batch.timer =
+    IOTimerEventSource::timerEventSource(this,
+                                         OSMemberFunctionCast(IOTimerEventSource::Action,
+                                                              this,
+                                                              &IOHIDEventService::batchTimerCallback));
+    if (!_batch.timer || (_workLoop->addEventSource(_batch.timer) != kIOReturnSuccess))
+        return false;
+
+    number = (OSNumber*)copyProperty(kIOHIDEventServiceBatchMaxSamplesKey);
+    if ( OSDynamicCast(OSNumber, number) )
+        __atomic_store_n(&_batch.maxSamples, boundBatchValue(number->unsigned32BitValue(), kBatchMaxSamplesLimit), __ATOMIC_RELEASE);
+    OSSafeReleaseNULL(number);
+
+    number = (OSNumber*)copyProperty(kIOHIDEventServiceBatchMaxLatencyKey);
+    if ( OSDynamicCast(OSNumber, number) )
+        _batch.maxLatencyUS = boundBatchValue(number->unsigned32BitValue(), kBatchMaxLatencyUSLimit);
+    OSSafeReleaseNULL(number);
+#endif
+
 
     _commandGate = IOCommandGate::commandGate(this);
     if (!_commandGate || (_workLoop->addEventSource(_commandGate) != kIOReturnSuccess))
@@ -322,6 +353,11 @@ static void stopAndReleaseShim ( IOService * service, IOService * provider )
 //====================================================================================================
 void IOHIDEventService::stop( IOService * provider )
 {
+#if TARGET_OS_EMBEDDED
+    if ( _commandGate )
+        _commandGate->runAction(OSMemberFunctionCast(IOCommandGate::Action, this, &IOHIDEventService::flushBatchedEvent));
+#endif
+
     handleStop ( provider );
     _provider = NULL;
 
@@ -362,6 +398,15 @@ void IOHIDEventService::stop( IOService * provider )
 
 #if TARGET_OS_EMBEDDED
 
+    if ( _batch.timer ) {
+        _batch.timer->cancelTimeout();
+        if ( _workLoop )
+            _workLoop->removeEventSource(_batch.timer);
+
+        _batch.timer->release();
+        _batch.timer = 0;
+    }
+
     if ( _keyboard.debug.nmiTimer ) {
         _keyboard.debug.nmiTimer->cancelTimeout();
         if ( _workLoop )
@@ -705,6 +750,27 @@ IOReturn IOHIDEventService::setSystemProperties( OSDictionary * properties )
     if (setCapsDelay) {
         calculateCapsLockDelay();
     }
+
+#if TARGET_OS_EMBEDDED
+    number = OSDynamicCast(OSNumber, properties->getObject(kIOHIDEventServiceBatchMaxSamplesKey));
+    if (number) {
+        UInt32 maxSamples = boundBatchValue(number->unsigned32BitValue(), kBatchMaxSamplesLimit);
+
+        if ( _commandGate )
+            _commandGate->runAction(OSMemberFunctionCast(IOCommandGate::Action, this, &IOHIDEventService::setBatchMaxSamplesGated), &maxSamples);
+        else
+            __atomic_store_n(&_batch.maxSamples, maxSamples, __ATOMIC_RELEASE);
+
+        setProperty(kIOHIDEventServiceBatchMaxSamplesKey, maxSamples, 32);
+    }
+
+    number = OSDynamicCast(OSNumber, properties->getObject(kIOHIDEventServiceBatchMaxLatencyKey));
+    if (number) {
+        _batch.maxLatencyUS = boundBatchValue(number->unsigned32BitValue(), kBatchMaxLatencyUSLimit);
+        setProperty(kIOHIDEventServiceBatchMaxLatencyKey, _batch.maxLatencyUS, 32);
+    }
+#endif
+
     if ( properties->getObject(kIOHIDDeviceParametersKey) == kOSBooleanTrue ) {
         OSDictionary * eventServiceProperties = (OSDictionary*)copyProperty(kIOHIDEventServicePropertiesKey);
         if ( OSDynamicCast(OSDictionary, eventServiceProperties) ) {
@@ -1171,6 +1237,16 @@ void IOHIDEventService::free()
         _clientDict = NULL;
     }
 
+    if (_batch.timer) {
+        if ( _workLoop )
+            _workLoop->removeEventSource(_batch.timer);
+
+        _batch.timer->release();
+        _batch.timer = 0;
+    }
+
+    OSSafeReleaseNULL(_batch.event);
+
     if (_keyboard.debug.nmiTimer) {
         if ( _workLoop )
             _workLoop->removeEventSource(_keyboard.debug.nmiTimer);
@@ -2196,38 +2272,39 @@ void IOHIDEventService::dispatchMultiAxisPointerEvent(
             GET_RELATIVE_VALUE_FROM_CENTERED(z, sx);
 
 #if TARGET_OS_EMBEDDED
-        IOHIDEvent * subEvent = IOHIDEvent::multiAxisPointerEvent(timeStamp, x, y, z, rX, rY, rZ, buttonState, _multiAxis.buttonState, options);
-        if ( subEvent ) {
-
-            IOHIDEvent * event;
-
-            if ( validRelative || (!validRelative && !validScroll) ) {
-                event = IOHIDEvent::relativePointerEvent(timeStamp, dx, dy, 0, buttonState);
-                if ( event ) {
-
-                    if ( subEvent ) {
-                        event->appendChild(subEvent);
-                    }
-
-                    dispatchEvent(event);
-                    event->release();
+        IOHIDEvent * subEvent;
+        IOHIDEvent * event;
+
+        // An event can only have one parent, so the relative and scroll
+        // events each get their own multi axis child.
+        if ( validRelative || (!validRelative && !validScroll) ) {
+            event = IOHIDEvent::relativePointerEvent(timeStamp, dx, dy, 0, buttonState);
+            if ( event ) {
+
+                subEvent = IOHIDEvent::multiAxisPointerEvent(timeStamp, x, y, z, rX, rY, rZ, buttonState, _multiAxis.buttonState, options);
+                if ( subEvent ) {
+                    event->appendChild(subEvent);
+                    subEvent->release();
                 }
-            }
 
-            if ( validScroll ) {
-                event = IOHIDEvent::scrollEvent(timeStamp, sx, sy, 0);
-                if ( event ) {
+                dispatchEvent(event);
+                event->release();
+            }
+        }
 
-                    if ( subEvent ) {
-                        event->appendChild(subEvent);
-                    }
+        if ( validScroll ) {
+            event = IOHIDEvent::scrollEvent(timeStamp, sx, sy, 0);
+            if ( event ) {
 
-                    dispatchEvent(event);
-                    event->release();
+                subEvent = IOHIDEvent::multiAxisPointerEvent(timeStamp, x, y, z, rX, rY, rZ, buttonState, _multiAxis.buttonState, options);
+                if ( subEvent ) {
+                    event->appendChild(subEvent);
+                    subEvent->release();
                 }
-            }
 
-            subEvent->release();
+                dispatchEvent(event);
+                event->release();
+            }
         }
 #else
         dispatchRelativePointerEvent(timeStamp, dx, dy, buttonState, options);
@@ -2550,6 +2627,107 @@ void IOHIDEventService::dispatchExtendedGameControllerEvent(
     }
 }
 
+//==============================================================================
+// IOHIDEventService::dispatchBatchedEvent
+//==============================================================================
+OSMetaClassDefineReservedUsed(IOHIDEventService,  14);
+void IOHIDEventService::dispatchBatchedEvent(IOHIDEvent * event, IOOptionBits options)
+{
+    if ( !event )
+        return;
+
+    // Services that do not batch keep dispatching outside of the gate.  A
+    // pending batch is flushed before batching is turned off, so nothing
+    // can be overtaken here.
+    if ( !_commandGate || __atomic_load_n(&_batch.maxSamples, __ATOMIC_ACQUIRE) < 2 ) {
+        dispatchEvent(event, options);
+        return;
+    }
+
+    _commandGate->runAction(OSMemberFunctionCast(IOCommandGate::Action, this, &IOHIDEventService::dispatchBatchedEventGated), event, &options);
+}
+
+//==============================================================================
+// IOHIDEventService::dispatchBatchedEventGated
+//==============================================================================
+void IOHIDEventService::dispatchBatchedEventGated(IOHIDEvent * event, IOOptionBits * pOptions)
+{
+    IOOptionBits    options     = *pOptions;
+    UInt32          dataLength  = 0;
+
+    if ( _batch.maxSamples < 2 ) {
+        flushBatchedEvent();
+        dispatchEvent(event, options);
+        return;
+    }
+
+    if ( _batch.event ) {
+        if ( options == _batch.options && _batch.event->appendBatchSample(event) ) {
+            if ( ++_batch.count >= _batch.maxSamples )
+                flushBatchedEvent();
+            return;
+        }
+
+        // The sample does not fit in the pending batch
+        flushBatchedEvent();
+    }
+
+    if ( event->getType() == kIOHIDEventTypeVendorDefined )
+        dataLength = event->getIntegerValue(kIOHIDEventFieldVendorDefinedDataLength);
+
+    _batch.event = IOHIDEvent::batchEvent(event->getTimeStamp(), getPrimaryUsagePage(), getPrimaryUsage(), event->getType(), _batch.maxSamples, dataLength);
+    if ( !_batch.event || !_batch.event->appendBatchSample(event) ) {
+        OSSafeReleaseNULL(_batch.event);
+        dispatchEvent(event, options);
+        return;
+    }
+
+    _batch.count    = 1;
+    _batch.options  = options;
+
+    if ( _batch.maxLatencyUS && _batch.timer )
+        _batch.timer->setTimeoutUS(_batch.maxLatencyUS);
+}
+
+//==============================================================================
+// IOHIDEventService::setBatchMaxSamplesGated
+//==============================================================================
+void IOHIDEventService::setBatchMaxSamplesGated(UInt32 * pMaxSamples)
+{
+    if ( *pMaxSamples < 2 )
+        flushBatchedEvent();
+
+    __atomic_store_n(&_batch.maxSamples, *pMaxSamples, __ATOMIC_RELEASE);
+}
+
+//==============================================================================
+// IOHIDEventService::flushBatchedEvent
+//==============================================================================
+void IOHIDEventService::flushBatchedEvent()
+{
+    IOHIDEvent * event = _batch.event;
+
+    if ( !event )
+        return;
+
+    _batch.event = NULL;
+    _batch.count = 0;
+
+    if ( _batch.timer )
+        _batch.timer->cancelTimeout();
+
+    dispatchEvent(event, _batch.options);
+    event->release();
+}
+
+//==============================================================================
+// IOHIDEventService::batchTimerCallback
+//==============================================================================
+void IOHIDEventService::batchTimerCallback(IOTimerEventSource *sender __unused)
+{
+    flushBatchedEvent();
+}
+
 
 void IOHIDEventService::close(IOService *forClient, IOOptionBits options)
 {
@@ -2721,8 +2899,8 @@ OSMetaClassDefineReservedUnused(IOHIDEventService, 10);
 OSMetaClassDefineReservedUnused(IOHIDEventService, 11);
 OSMetaClassDefineReservedUnused(IOHIDEventService, 12);
 OSMetaClassDefineReservedUnused(IOHIDEventService, 13);
-#endif /* TARGET_OS_EMBEDDED */
 OSMetaClassDefineReservedUnused(IOHIDEventService, 14);
+#endif /* TARGET_OS_EMBEDDED */
 OSMetaClassDefineReservedUnused(IOHIDEventService, 15);
 OSMetaClassDefineReservedUnused(IOHIDEventService, 16);
 OSMetaClassDefineReservedUnused(IOHIDEventService, 17);
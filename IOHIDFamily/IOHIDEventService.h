@@ -168,6 +168,17 @@ private:
             UInt32                  buttonState;
         } relativePointer;
 
+#if TARGET_OS_EMBEDDED
+        struct {
+            IOHIDEvent *            event;
+            UInt32                  count;
+            UInt32                  maxSamples;
+            UInt32                  maxLatencyUS;
+            IOOptionBits            options;
+            IOTimerEventSource *    timer;
+        } batch;
+#endif
+
 
     };
     ExpansionData *         _reserved;
@@ -202,6 +213,14 @@ private:
     void                    debuggerTimerCallback(IOTimerEventSource *sender);
 
     void                    stackshotTimerCallback(IOTimerEventSource *sender);
+
+    void                    batchTimerCallback(IOTimerEventSource *sender);
+
+    void                    dispatchBatchedEventGated(IOHIDEvent * event, IOOptionBits * pOptions);
+
+    void                    setBatchMaxSamplesGated(UInt32 * pMaxSamples);
+
+    void                    flushBatchedEvent();
 #endif
     
     void                    multiAxisTimerCallback(IOTimerEventSource *sender);
@@ -728,6 +747,20 @@ protected:
                                                                 IOFixed                         joystickRz,
                                                                 IOOptionBits                    options         = 0 );
     
+    /*!
+     @function dispatchBatchedEvent
+     @abstract Dispatch a sample as part of a batched event
+     @discussion Meant for sensors that report at a high rate.  Samples of the same type are
+     copied into one batched event, see IOHIDEventBatchData, which is dispatched once it holds
+     kIOHIDEventServiceBatchMaxSamplesKey samples or its oldest sample is
+     kIOHIDEventServiceBatchMaxLatencyKey microseconds old.  A sample of a different type
+     dispatches the pending batch first.  Samples are dispatched individually when batching
+     is not configured.
+     @param event       Sample to be dispatched.  The event is copied and may be reused.
+     @param options     Additional options to be used when dispatching the batch.
+     */
+    OSMetaClassDeclareReservedUsed(IOHIDEventService,  14);
+    virtual void            dispatchBatchedEvent(IOHIDEvent * event, IOOptionBits options=0);
 
 #else
     OSMetaClassDeclareReservedUnused(IOHIDEventService,  7);
@@ -737,8 +770,8 @@ protected:
     OSMetaClassDeclareReservedUnused(IOHIDEventService, 11);
     OSMetaClassDeclareReservedUnused(IOHIDEventService, 12);
     OSMetaClassDeclareReservedUnused(IOHIDEventService, 13);
-#endif
     OSMetaClassDeclareReservedUnused(IOHIDEventService, 14);
+#endif
     OSMetaClassDeclareReservedUnused(IOHIDEventService, 15);
     OSMetaClassDeclareReservedUnused(IOHIDEventService, 16);
     OSMetaClassDeclareReservedUnused(IOHIDEventService, 17);
@@ -342,10 +342,14 @@ typedef uint32_t IOHIDOptionsType;
   @constant kIOHIDQueueOptionsTypeNone Default option.
   @constant kIOHIDQueueOptionsTypeEnqueueAll Force the IOHIDQueue
     to enqueue all events, relative or absolute, regardless of change.
+  @constant kIOHIDQueueOptionsTypeReportRecords Have the device enqueue
+    one entry per report, holding all the values that report changed,
+    rather than one entry per value.
 */
 enum {
     kIOHIDQueueOptionsTypeNone     = 0x00,
-    kIOHIDQueueOptionsTypeEnqueueAll = 0x01
+    kIOHIDQueueOptionsTypeEnqueueAll = 0x01,
+    kIOHIDQueueOptionsTypeReportRecords = 0x02
 };
 typedef uint32_t IOHIDQueueOptionsType;
 
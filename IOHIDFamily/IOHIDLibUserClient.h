@@ -81,6 +81,22 @@ typedef struct _IOHIDElementValue
 	UInt32				value[1];
 }IOHIDElementValue;
 
+/*
+ * Entry enqueued once per report on queues created with
+ * kIOHIDQueueOptionsTypeReportRecords.  It is followed by valueCount
+ * IOHIDElementValue blocks, each totalSize bytes long.  The cookie field
+ * lines up with the one in IOHIDElementValue, so a record can be told
+ * apart from a single value.
+ */
+#define kIOHIDReportRecordCookie	((IOHIDElementCookie)(uintptr_t)0xffffffff)
+
+typedef struct _IOHIDReportRecord
+{
+	IOHIDElementCookie	cookie;
+	UInt32				totalSize;
+	UInt32				valueCount;
+}IOHIDReportRecord;
+
 typedef struct _IOHIDReportReq
 {
 	UInt32		reportType;
@@ -262,6 +262,14 @@ struct HIDStringItem
 typedef struct HIDStringItem HIDStringItem;
 typedef HIDStringItem HIDDesignatorItem;
 
+struct HIDUsageIndexEntry
+{
+	HIDUsage	usage;
+	UInt32		reportItem;
+};
+typedef struct HIDUsageIndexEntry HIDUsageIndexEntry;
+
+// Must match the parser's definition in IOHIDDescriptorParser/HIDPriv.h
 struct HIDPreparsedData
 {
 	UInt32				hidTypeIfValid;
@@ -280,6 +288,11 @@ struct HIDPreparsedData
 	UInt8 *				rawMemPtr;
 	UInt32				flags;
 	IOByteCount			numBytesAllocated;
+	IOByteCount			arenaSize;
+	HIDUsageIndexEntry	*usageIndex;
+	UInt32				usageIndexCount;
+	UInt32				*wideItems;
+	UInt32				wideItemCount;
 };
 typedef struct HIDPreparsedData HIDPreparsedData;
 typedef HIDPreparsedData * HIDPreparsedDataPtr;
@@ -40,6 +40,36 @@ __BEGIN_DECLS
 
 #define kIOHIDReportModeKey                 "ReportMode"
 
+/*!
+    @defined kIOHIDReportAllocationCountKey
+    @abstract Number of input reports that could not be copied into the
+        device's preallocated report buffer and needed a heap allocation.
+*/
+#define kIOHIDReportAllocationCountKey      "ReportAllocationCount"
+
+/*!
+    @defined kIOHIDReportValueDirectoryKey
+    @abstract Array describing where the values of each report live in the
+        shared element value memory.
+    @discussion Each entry is a dictionary with kIOHIDElementReportIDKey,
+        kIOHIDReportValueTypeKey (an IOHIDReportType), kIOHIDElementValueLocationKey
+        (the offset of the first value) and kIOHIDReportValueSizeKey (the size
+        in bytes of all the values of that report).
+*/
+#define kIOHIDReportValueDirectoryKey       "ReportValueDirectory"
+#define kIOHIDReportValueTypeKey            "ReportType"
+#define kIOHIDReportValueSizeKey            "ValueSize"
+
+/*!
+    @defined kIOHIDAsyncReportCoalescingKey
+    @abstract Boolean that lets reports queued through handleReportWithTimeAsync
+        be merged while the device's workloop is backlogged.
+    @discussion Only input reports with the same ID and length are merged.
+        Relative values are summed and absolute values keep the newest value.
+        Reports with button, keyboard or array elements are never merged.
+*/
+#define kIOHIDAsyncReportCoalescingKey      "AsyncReportCoalescing"
+
 typedef enum { 
     kIOHIDReportModeTypeNormal      = 0,
     kIOHIDReportModeTypeFiltered
@@ -80,6 +110,24 @@ typedef enum {
 #define kIOHIDAbsoluteAxisBoundsRemovalPercentage   "AbsoluteAxisBoundsRemovalPercentage"
 
 #define kIOHIDEventServiceQueueSize         "QueueSize"
+
+/*!
+    @defined kIOHIDEventServiceBatchMaxSamplesKey
+    @abstract Number of samples an event service collects into one batched
+        event before dispatching it.
+    @discussion Only events passed to dispatchBatchedEvent are batched.  A value
+        of 0 or 1 dispatches every sample on its own.  Values above 256 are
+        treated as 256.
+*/
+#define kIOHIDEventServiceBatchMaxSamplesKey    "BatchMaxSamples"
+
+/*!
+    @defined kIOHIDEventServiceBatchMaxLatencyKey
+    @abstract Longest time, in microseconds, a sample is held in a partially
+        filled batch before the batch is dispatched.  Values above one second
+        are treated as one second.
+*/
+#define kIOHIDEventServiceBatchMaxLatencyKey    "BatchMaxLatency"
 #define kIOHIDAltSenderIdKey                "alt_sender_id"
 
 #define kIOHIDAppleVendorSupported          "AppleVendorSupported"
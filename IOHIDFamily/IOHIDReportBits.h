@@ -0,0 +1,207 @@
+/*
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ * 
+ * Copyright (c) 2012 Apple Computer, Inc.  All Rights Reserved.
+ * 
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ * 
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ * 
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+#ifndef _IOKIT_HID_IOHIDREPORTBITS_H
+#define _IOKIT_HID_IOHIDREPORTBITS_H
+
+#include <IOKit/IOLib.h>
+
+//---------------------------------------------------------------------------
+// Report bits are moved a word at a time: the bytes covering each 32 bit
+// chunk are gathered into one 64 bit value and shifted into place, rather
+// than walking the field a byte at a time. Byte aligned fields wider than
+// a word are copied as plain bytes on little endian hosts, where the
+// element value words have the same layout as the report.
+
+#define BIT_MASK(bits)  ((1U << (bits)) - 1)
+
+#define WORD_MASK(bits) (((bits) >= 32) ? 0xffffffff : BIT_MASK(bits))
+
+#define UpdateByteOffsetAndShift(bits, offset, shift)  \
+    do { offset = bits >> 3; shift = bits & 0x07; } while (0)
+
+static inline UInt32 extractReportValue( const UInt8 *  src,
+                                         UInt32         byteOffset,
+                                         UInt32         byteCount,
+                                         UInt32         shift,
+                                         UInt32         mask,
+                                         bool           signExtend )
+{
+    UInt64 raw = 0;
+    UInt32 value;
+
+    src += byteOffset;
+
+    for ( UInt32 i = 0; i < byteCount; i++ )
+        raw |= ((UInt64) src[i]) << (i << 3);
+
+    value = ((UInt32)(raw >> shift)) & mask;
+
+    // Sign extend negative values by or'ing in all 1s above the
+    // significant bit.
+    if ( signExtend && (value & ~(mask >> 1)) )
+        value |= ~mask;
+
+    return value;
+}
+
+static inline void readReportBits( const UInt8 * src,
+                           UInt32 *      dst,
+                           UInt32        bitsToCopy,
+                           UInt32        srcStartBit = 0,
+                           bool          shouldSignExtend = false,
+                           bool *        valueChanged = 0)
+{
+    UInt32 srcOffset;
+    UInt32 srcShift;
+    UInt32 dstOffset;
+    UInt32 bitsProcessed;
+    UInt32 word;
+
+#if defined(__LITTLE_ENDIAN__)
+    // Byte aligned blobs, such as vendor data elements, are compared and
+    // copied as bytes. Sign extension only ever applies to values smaller
+    // than a word, so it doesn't come into play here.
+    if ( ( bitsToCopy > 32 ) && ( ( ( srcStartBit | bitsToCopy ) & 0x07 ) == 0 ) )
+    {
+        UInt8 *  dstBytes  = (UInt8 *) dst;
+        UInt32   byteCount = bitsToCopy >> 3;
+        UInt32   tailCount = (4 - (byteCount & 0x03)) & 0x03;
+
+        src += srcStartBit >> 3;
+
+        if ( bcmp( dstBytes, src, byteCount ) != 0 )
+        {
+            bcopy( src, dstBytes, byteCount );
+            if (valueChanged) *valueChanged = true;
+        }
+
+        // The unused bytes of the last word are always zero.
+        for ( dstBytes += byteCount; tailCount; tailCount--, dstBytes++ )
+        {
+            if ( *dstBytes )
+            {
+                *dstBytes = 0;
+                if (valueChanged) *valueChanged = true;
+            }
+        }
+
+        return;
+    }
+#endif
+
+    for ( dstOffset = 0; bitsToCopy; dstOffset++ )
+    {
+        bitsProcessed = min( bitsToCopy, 32 );
+
+        UpdateByteOffsetAndShift( srcStartBit, srcOffset, srcShift );
+
+        // Sign extend negative values only if this is the leftmost word
+        // of the result and it holds less than a full word.
+        word = extractReportValue( src,
+                                   srcOffset,
+                                   (srcShift + bitsProcessed + 7) >> 3,
+                                   srcShift,
+                                   WORD_MASK(bitsProcessed),
+                                   ( shouldSignExtend && ( dstOffset == 0 ) && ( bitsProcessed < 32 ) ) );
+
+        if ( dst[dstOffset] != word )
+        {
+            dst[dstOffset] = word;
+            if (valueChanged) *valueChanged = true;
+        }
+
+        srcStartBit += bitsProcessed;
+        bitsToCopy  -= bitsProcessed;
+    }
+}
+
+static inline void writeReportBits( const UInt32 * src,
+                           UInt8 *        dst,
+                           UInt32         bitsToCopy,
+                           UInt32         dstStartBit = 0)
+{
+    UInt32 dstOffset;
+    UInt32 dstShift;
+    UInt32 srcOffset;
+    UInt32 bitsProcessed;
+    UInt32 byteCount;
+    UInt64 raw;
+
+#if defined(__LITTLE_ENDIAN__)
+    // Byte aligned blobs are or'ed into the report a byte at a time,
+    // without any shifting.
+    if ( ( bitsToCopy > 32 ) && ( ( ( dstStartBit | bitsToCopy ) & 0x07 ) == 0 ) )
+    {
+        const UInt8 * srcBytes = (const UInt8 *) src;
+
+        dst      += dstStartBit >> 3;
+        byteCount = bitsToCopy >> 3;
+
+        for ( UInt32 i = 0; i < byteCount; i++ )
+            dst[i] |= srcBytes[i];
+
+        return;
+    }
+#endif
+
+    for ( srcOffset = 0; bitsToCopy; srcOffset++ )
+    {
+        bitsProcessed = min( bitsToCopy, 32 );
+
+        UpdateByteOffsetAndShift( dstStartBit, dstOffset, dstShift );
+
+        raw       = ((UInt64)(src[srcOffset] & WORD_MASK(bitsProcessed))) << dstShift;
+        byteCount = (dstShift + bitsProcessed + 7) >> 3;
+
+        for ( UInt32 i = 0; i < byteCount; i++, raw >>= 8 )
+            dst[dstOffset + i] |= (UInt8) raw;
+
+        dstStartBit += bitsProcessed;
+        bitsToCopy  -= bitsProcessed;
+    }
+}
+
+static inline void clearReportBits( UInt8 *        dst,
+                             UInt32         bitsToClear,
+                             UInt32         dstStartBit = 0)
+{
+    UInt32 dstOffset;
+    UInt32 dstShift;
+    UInt32 bitsProcessed;
+
+    while ( bitsToClear )
+    {
+        UpdateByteOffsetAndShift( dstStartBit, dstOffset, dstShift );
+
+        bitsProcessed = min( bitsToClear, 8 - dstShift );
+
+        dst[dstOffset] &= ~(BIT_MASK(bitsProcessed) << dstShift);
+
+        dstStartBit += bitsProcessed;
+        bitsToClear -= bitsProcessed;
+    }
+}
+
+#endif /* _IOKIT_HID_IOHIDREPORTBITS_H */
@@ -95,6 +95,7 @@ IOHIDQueueClass::IOHIDQueueClass() : IOHIDIUnknown(NULL)
     fQueueEntrySizeChanged  = false;
     fQueueMappedMemory      = NULL;
     fQueueMappedMemorySize  = 0;
+    fRecordOffset           = 0;
     fOwningDevice           = NULL;
     fEventCallback          = NULL;
     fEventRefcon            = NULL;
@@ -333,6 +334,7 @@ IOReturn IOHIDQueueClass::dispose()
                                     mappedMem);
         fQueueMappedMemory = NULL;
         fQueueMappedMemorySize = 0;
+        fRecordOffset = 0;
     }    
 
 
@@ -457,6 +459,7 @@ IOReturn IOHIDQueueClass::start (IOOptionBits options __unused)
                                     (uintptr_t)fQueueMappedMemory);
         fQueueMappedMemory      = NULL;
         fQueueMappedMemorySize  = 0;
+        fRecordOffset           = 0;
     }    
 
     uint64_t    input       = fQueueRef;
@@ -466,6 +469,9 @@ IOReturn IOHIDQueueClass::start (IOOptionBits options __unused)
 
     if (ret != kIOReturnSuccess)
         return ret;
+
+    // starting the queue empties it, along with any partly read record
+    fRecordOffset = 0;
     
     // get the queue shared memory
     if ( !fQueueMappedMemory )
@@ -541,6 +547,23 @@ IOReturn IOHIDQueueClass::copyNextEventValue (IOHIDValueRef     *pEvent,
 
     uint32_t dataSize = sizeof(IOHIDElementValue);
     
+    // Report records hold several values. Hand them out one at a time and
+    // only dequeue the record once the last one has been taken.
+    if ( entrySize >= sizeof(IOHIDReportRecord) )
+    {
+        IOHIDReportRecord * record = (IOHIDReportRecord *) &(nextEntry->data);
+        IOHIDElementCookie  cookie = record->cookie;
+        uint32_t            recordSize = record->totalSize;
+
+        ROSETTA_ONLY(
+            cookie = (IOHIDElementCookie)OSSwapInt32((uint32_t)cookie);
+            recordSize = OSSwapInt32(recordSize);
+        );
+
+        if ( cookie == kIOHIDReportRecordCookie )
+            return copyNextRecordValue(pEvent, record, (recordSize < entrySize) ? recordSize : entrySize);
+    }
+
     // check size of next entry
     // Make sure that it is not smaller than IOHIDElementValue
     if (entrySize < sizeof(IOHIDElementValue))
@@ -569,6 +592,58 @@ IOReturn IOHIDQueueClass::copyNextEventValue (IOHIDValueRef     *pEvent,
     return ret;
 }
 
+IOReturn IOHIDQueueClass::copyNextRecordValue (IOHIDValueRef       *pEvent,
+                                               IOHIDReportRecord   *record,
+                                               uint32_t            recordSize)
+{
+    IOHIDElementValue * elementValue;
+    IOHIDElementCookie  cookie;
+    uint32_t            valueSize;
+    uint32_t            dataSize = sizeof(IOHIDElementValue);
+    IOReturn            ret      = kIOReturnSuccess;
+
+    if ( fRecordOffset < sizeof(IOHIDReportRecord) )
+        fRecordOffset = sizeof(IOHIDReportRecord);
+
+    if ( fRecordOffset + sizeof(IOHIDElementValue) > recordSize )
+    {
+        ret = kIOReturnUnderrun;
+    }
+    else
+    {
+        elementValue    = (IOHIDElementValue *)((uint8_t *)record + fRecordOffset);
+        cookie          = elementValue->cookie;
+        valueSize       = elementValue->totalSize;
+
+        ROSETTA_ONLY(
+            cookie = (IOHIDElementCookie)OSSwapInt32((uint32_t)cookie);
+            valueSize = OSSwapInt32(valueSize);
+        );
+
+        if ( ( valueSize < sizeof(IOHIDElementValue) ) || ( fRecordOffset + valueSize > recordSize ) )
+        {
+            HIDLog ("IOHIDQueueClass: Malformed report record (%u, %u)\n", valueSize, recordSize);
+            ret         = kIOReturnUnderrun;
+            valueSize   = recordSize - fRecordOffset;
+        }
+        else if ( pEvent )
+        {
+            *pEvent = _IOHIDValueCreateWithElementValuePtr(kCFAllocatorDefault, fOwningDevice->getElement(cookie), elementValue);
+        }
+
+        fRecordOffset += valueSize;
+    }
+
+    // Dequeue the record once all of its values have been handed out.
+    if ( fRecordOffset + sizeof(IOHIDElementValue) > recordSize )
+    {
+        IODataQueueDequeue(fQueueMappedMemory, NULL, &dataSize);
+        fRecordOffset = 0;
+    }
+
+    return ret;
+}
+
 IOReturn IOHIDQueueClass::setEventCallback (IOHIDCallback callback, void * refcon)
 {
     fEventCallback = callback;
@@ -27,6 +27,7 @@
 #include <IOKit/IODataQueueShared.h>
 
 #include "IOHIDDeviceClass.h"
+#include "IOHIDLibUserClient.h"
 
 class IOHIDQueueClass : public IOHIDIUnknown
 {
@@ -54,6 +55,9 @@ protected:
     IODataQueueMemory * fQueueMappedMemory;
     vm_size_t           fQueueMappedMemorySize;
     
+    // offset of the next value in the report record at the queue head
+    uint32_t            fRecordOffset;
+    
     // owming device
     IOHIDDeviceClass *	fOwningDevice;
         
@@ -95,6 +99,7 @@ public:
     virtual IOReturn start (IOOptionBits options = 0);
     virtual IOReturn stop (IOOptionBits options = 0);
     virtual IOReturn copyNextEventValue (IOHIDValueRef * pEvent, uint32_t timeout, IOOptionBits options = 0);
+    IOReturn copyNextRecordValue (IOHIDValueRef * pEvent, IOHIDReportRecord * record, uint32_t recordSize);
     virtual IOReturn setEventCallback (IOHIDCallback callback, void * refcon);
 
     static void queueEventSourceCallback(CFMachPortRef cfPort, mach_msg_header_t *msg, CFIndex size, void *info);
@@ -58,32 +58,82 @@
 */
 
 #include "HIDLib.h"
+#include <string.h>
 
 /*
  *------------------------------------------------------------------------------
  *
- * HIDGetButtonsOnPage - Get the state of the buttons for a Page
+ * HIDSaveButton - Record a pressed button
+ *
+ *	 Input:
+ *			  usage				   - The usage of the button
+ *			  piUsageList			- Usages for pressed buttons, or NULL
+ *			  piUsageListLength		- Entries in UsageList
+ *			  piUsageBitmap			- Bitmap of pressed buttons, or NULL
+ *			  iMaxUsages			- Max entries in UsageList, or usages in
+ *										the bitmap
+ *	 Output:
+ *			  piUsageListLength		- Entries in UsageList, or buttons saved
+ *										in the bitmap
+ *	 Returns:
+ *			  kHIDSuccess		   - Success
+ *			  kHIDBufferTooSmallErr	- No room for the usage
+ *
+ *------------------------------------------------------------------------------
+*/
+static inline OSStatus HIDSaveButton(HIDUsage usage,
+									 HIDUsage *piUsageList,
+									 UInt32 *piUsageListLength,
+									 UInt32 *piUsageBitmap,
+									 UInt32 iMaxUsages)
+{
+	if (piUsageBitmap != NULL)
+	{
+		if (usage >= iMaxUsages)
+			return kHIDBufferTooSmallErr;
+		HIDSetUsageBit(piUsageBitmap, usage);
+		(*piUsageListLength)++;
+		return kHIDSuccess;
+	}
+	if (*piUsageListLength >= iMaxUsages)
+		return kHIDBufferTooSmallErr;
+	piUsageList[(*piUsageListLength)++] = usage;
+	return kHIDSuccess;
+}
+
+/*
+ *------------------------------------------------------------------------------
+ *
+ * HIDGetButtonsOnPageInternal - Get the state of the buttons for a Page
  *
  *	 Input:
  *			  reportType		   - HIDP_Input, HIDP_Output, HIDP_Feature
  *			  usagePage			   - Page Criteria or zero
  *			  iCollection			- Collection Criteria or zero
- *			  piUsageList			- Usages for pressed buttons
- *			  piUsageListLength		- Max entries in UsageList
+ *			  piUsageList			- Usages for pressed buttons, or NULL
+ *			  piUsageListLength		- Max entries in UsageList, or usages in
+ *										the bitmap
+ *			  piUsageBitmap			- Bitmap of pressed buttons, or NULL
  *			  ptPreparsedData		- Pre-Parsed Data
  *			  psReport				- An HID Report
  *			  iReportLength			- The length of the Report
  *	 Output:
- *			  piValue				- Pointer to usage Value
+ *			  piUsageList			- Usages for pressed buttons
+ *			  piUsageListLength		- Entries in UsageList
+ *			  piUsageBitmap			- A bit set for each pressed button
  *	 Returns:
  *
+ *	Pressed buttons go either into the usage list or into the bitmap,
+ *	  whichever one is passed in.
+ *
  *------------------------------------------------------------------------------
 */
-OSStatus HIDGetButtonsOnPage(HIDReportType reportType,
+static OSStatus HIDGetButtonsOnPageInternal(HIDReportType reportType,
 						   HIDUsage usagePage,
 						   UInt32 iCollection,
 						   HIDUsage *piUsageList,
 						   UInt32 *piUsageListLength,
+						   UInt32 *piUsageBitmap,
 						   HIDPreparsedDataRef preparsedDataRef,
 						   void *psReport,
 						   IOByteCount iReportLength)
@@ -104,7 +154,7 @@ OSStatus HIDGetButtonsOnPage(HIDReportType reportType,
  *	Disallow Null Pointers
 */
 	if ((ptPreparsedData == NULL)
-	 || (piUsageList == NULL)
+	 || ((piUsageList == NULL) && (piUsageBitmap == NULL))
 	 || (piUsageListLength == NULL)
 	 || (psReport == NULL))
 		return kHIDNullPointerErr;
@@ -120,6 +170,8 @@ OSStatus HIDGetButtonsOnPage(HIDReportType reportType,
 */
 	iMaxUsages = *piUsageListLength;
 	*piUsageListLength = 0;
+	if (piUsageBitmap != NULL)
+		memset(piUsageBitmap, 0, HIDUsageBitmapWords(iMaxUsages) * sizeof(UInt32));
 /*
  *	Search only the scope of the Collection specified
  *	Go through the ReportItems
@@ -169,9 +221,10 @@ OSStatus HIDGetButtonsOnPage(HIDReportType reportType,
 						iStart += ptReportItem->globals.reportSize;
 						if (usagePage == tUsageAndPage.usagePage)
 						{
-							if (*piUsageListLength >= iMaxUsages)
-								return kHIDBufferTooSmallErr;
-							piUsageList[(*piUsageListLength)++] = iValue;
+							iStatus = HIDSaveButton(iValue, piUsageList, piUsageListLength,
+													piUsageBitmap, iMaxUsages);
+							if (iStatus != kHIDSuccess)
+								return iStatus;
 						}
 					}
 /*
@@ -188,9 +241,10 @@ OSStatus HIDGetButtonsOnPage(HIDReportType reportType,
 							HIDUsageAndPageFromIndex(preparsedDataRef,ptReportItem,iE,&tUsageAndPage);
 							if (usagePage == tUsageAndPage.usagePage)
 							{
-								if (*piUsageListLength >= iMaxUsages)
-									return kHIDBufferTooSmallErr;
-								piUsageList[(*piUsageListLength)++] = tUsageAndPage.usage;
+								iStatus = HIDSaveButton(tUsageAndPage.usage, piUsageList, piUsageListLength,
+														piUsageBitmap, iMaxUsages);
+								if (iStatus != kHIDSuccess)
+									return iStatus;
 							}
 						}
 					}
@@ -212,3 +266,75 @@ OSStatus HIDGetButtonsOnPage(HIDReportType reportType,
 	}
 	return kHIDSuccess;
 }
+
+/*
+ *------------------------------------------------------------------------------
+ *
+ * HIDGetButtonsOnPage - Get the state of the buttons for a Page
+ *
+ *	 Input:
+ *			  reportType		   - HIDP_Input, HIDP_Output, HIDP_Feature
+ *			  usagePage			   - Page Criteria or zero
+ *			  iCollection			- Collection Criteria or zero
+ *			  piUsageList			- Usages for pressed buttons
+ *			  piUsageListLength		- Max entries in UsageList
+ *			  ptPreparsedData		- Pre-Parsed Data
+ *			  psReport				- An HID Report
+ *			  iReportLength			- The length of the Report
+ *	 Output:
+ *			  piValue				- Pointer to usage Value
+ *	 Returns:
+ *
+ *------------------------------------------------------------------------------
+*/
+OSStatus HIDGetButtonsOnPage(HIDReportType reportType,
+						   HIDUsage usagePage,
+						   UInt32 iCollection,
+						   HIDUsage *piUsageList,
+						   UInt32 *piUsageListLength,
+						   HIDPreparsedDataRef preparsedDataRef,
+						   void *psReport,
+						   IOByteCount iReportLength)
+{
+	if (piUsageList == NULL)
+		return kHIDNullPointerErr;
+	return HIDGetButtonsOnPageInternal(reportType, usagePage, iCollection,
+									   piUsageList, piUsageListLength, NULL,
+									   preparsedDataRef, psReport, iReportLength);
+}
+
+/*
+ *------------------------------------------------------------------------------
+ *
+ * HIDGetButtonsBitmap - Get the state of the buttons for a Page as a bitmap
+ *
+ *	 Input:
+ *			  reportType		   - HIDP_Input, HIDP_Output, HIDP_Feature
+ *			  usagePage			   - Page Criteria or zero
+ *			  iCollection			- Collection Criteria or zero
+ *			  piUsageBitmap			- Bitmap of pressed buttons
+ *			  iUsageBitmapSize		- Number of usages in the bitmap
+ *			  ptPreparsedData		- Pre-Parsed Data
+ *			  psReport				- An HID Report
+ *			  iReportLength			- The length of the Report
+ *	 Output:
+ *			  piUsageBitmap			- A bit set for each pressed button
+ *	 Returns:
+ *
+ *------------------------------------------------------------------------------
+*/
+OSStatus HIDGetButtonsBitmap(HIDReportType reportType,
+						   HIDUsage usagePage,
+						   UInt32 iCollection,
+						   UInt32 *piUsageBitmap,
+						   UInt32 iUsageBitmapSize,
+						   HIDPreparsedDataRef preparsedDataRef,
+						   void *psReport,
+						   IOByteCount iReportLength)
+{
+	if (piUsageBitmap == NULL)
+		return kHIDNullPointerErr;
+	return HIDGetButtonsOnPageInternal(reportType, usagePage, iCollection,
+									   NULL, &iUsageBitmapSize, piUsageBitmap,
+									   preparsedDataRef, psReport, iReportLength);
+}
@@ -76,6 +76,7 @@ OSStatus HIDGetData(void * report, IOByteCount iReportLength,
 						 Boolean bSignExtend)
 {
 	UInt8 * psReport = (UInt8 *)report;
+	UInt64 bytes;	// up to 7 leading bits and 32 data bits span 5 bytes
 	unsigned data;
 	unsigned iSignBit;
 	unsigned iExtendMask;
@@ -91,10 +92,10 @@ OSStatus HIDGetData(void * report, IOByteCount iReportLength,
 		return kHIDBadParameterErr;
 
 	// Pick up the data bytes backwards
-    data = 0;
+    bytes = 0;
     for (iCurrentByte = iLastByte; iCurrentByte >= (int) iStartByte; iCurrentByte--)
     {
-        data <<= 8;
+        bytes <<= 8;
 
 		iMask = 0xff;	//  1111 1111 initial mask
 		// if this is the 'last byte', then we need to mask off the top part of the byte
@@ -108,11 +109,11 @@ OSStatus HIDGetData(void * report, IOByteCount iReportLength,
 		if (iCurrentByte == iLastByte)
 			iMask = ((1 << (((unsigned) iLastBit % 8) + 1)) - 1);
 
-        data |= (unsigned) psReport[iCurrentByte] & iMask;
+        bytes |= (unsigned) psReport[iCurrentByte] & iMask;
 	}
 
 	// Shift to the right to byte align the least significant bit
-	data >>= startBit;
+	data = (unsigned) (bytes >> startBit);
 
 	// Sign extend the report item
 	if (bSignExtend)
@@ -91,7 +91,7 @@ OSStatus HIDGetUsageValue
 	HIDCollection *ptCollection;
 	HIDReportItem *ptReportItem;
 	OSStatus iStatus;
-	int iR;
+	HIDUsageSearch tSearch;
 	SInt32 iValue;
 	int iStart;
 	int iReportItem;
@@ -117,9 +117,9 @@ OSStatus HIDGetUsageValue
  *	Filter on ReportType and usagePage
 */
 	ptCollection = &ptPreparsedData->collections[iCollection];
-	for (iR=0; iR<ptCollection->reportItemCount; iR++)
+	HIDBeginUsageSearch(preparsedDataRef, ptCollection, usage, &tSearch);
+	while (HIDNextUsageSearchItem(preparsedDataRef, &tSearch, &iReportItem))
 	{
-		iReportItem = ptCollection->firstReportItem + iR;
 		ptReportItem = &ptPreparsedData->reportItems[iReportItem];
 		if (HIDIsVariable(ptReportItem, preparsedDataRef)
 		 && HIDHasUsage(preparsedDataRef,ptReportItem,usagePage,usage,&iUsageIndex,NULL))
@@ -194,7 +194,7 @@ OSStatus HIDGetScaledUsageValue(HIDReportType reportType,
 	HIDCollection *ptCollection;
 	HIDReportItem *ptReportItem;
 	OSStatus iStatus;
-	int iR;
+	HIDUsageSearch tSearch;
 	SInt32 iValue;
 	int iStart;
 	int iReportItem;
@@ -220,9 +220,9 @@ OSStatus HIDGetScaledUsageValue(HIDReportType reportType,
  *	Filter on ReportType and usagePage
 */
 	ptCollection = &ptPreparsedData->collections[iCollection];
-	for (iR=0; iR<ptCollection->reportItemCount; iR++)
+	HIDBeginUsageSearch(preparsedDataRef, ptCollection, usage, &tSearch);
+	while (HIDNextUsageSearchItem(preparsedDataRef, &tSearch, &iReportItem))
 	{
-		iReportItem = ptCollection->firstReportItem + iR;
 		ptReportItem = &ptPreparsedData->reportItems[iReportItem];
 		if (HIDIsVariable(ptReportItem, preparsedDataRef)
 		 && HIDHasUsage(preparsedDataRef,ptReportItem,usagePage,usage,&iUsageIndex,NULL))
@@ -269,3 +269,274 @@ OSStatus HIDGetScaledUsageValue(HIDReportType reportType,
 		return kHIDIncompatibleReportErr;
 	return kHIDUsageNotFoundErr;
 }
+
+/*
+ *------------------------------------------------------------------------------
+ *
+ * HIDReportItemHasUsage - Quick check for a usage in a report item
+ *
+ *	 Input:
+ *			  ptPreparsedData		- Pre-Parsed Data
+ *			  ptReportItem			- The Report Item
+ *			  usagePage			   - Page Criteria or zero
+ *			  usage				   - The usage to find
+ *	 Output:
+ *	 Returns:
+ *			  true when HIDHasUsage would find the usage
+ *
+ *	Answers the same question as HIDHasUsage without working out the
+ *	  usage index, which is only needed for the usages that match.
+ *
+ *------------------------------------------------------------------------------
+*/
+static inline Boolean HIDReportItemHasUsage(HIDPreparsedDataPtr ptPreparsedData,
+											HIDReportItem *ptReportItem,
+											HIDUsage usagePage,
+											HIDUsage usage)
+{
+	HIDP_UsageItem *ptUsageItem = &ptPreparsedData->usageItems[ptReportItem->firstUsageItem];
+	int i;
+
+	for (i=0; i<ptReportItem->usageItemCount; i++, ptUsageItem++)
+	{
+		if ((usagePage != 0) && (usagePage != ptUsageItem->usagePage))
+			continue;
+		if (ptUsageItem->isRange
+			? ((usage >= (UInt32) ptUsageItem->usageMinimum) && (usage <= (UInt32) ptUsageItem->usageMaximum))
+			: (usage == ptUsageItem->usage))
+			return true;
+	}
+	return false;
+}
+
+/*
+ *------------------------------------------------------------------------------
+ *
+ * HIDGetUsageValuesInternal - Get the values for a list of usages
+ *
+ *	 Input:
+ *			  reportType		   - HIDP_Input, HIDP_Output, HIDP_Feature
+ *			  iCollection			- Collection Criteria or zero
+ *			  ptUsageList			- The usages and pages to get the values for
+ *			  iUsageListSize		- Number of usages in the list
+ *			  piUsageValues			- User-supplied place to put the values
+ *			  piUsageStatus			- User-supplied place to put the status of
+ *										each value
+ *			  ptPreparsedData		- Pre-Parsed Data
+ *			  psReport				- An HID Report
+ *			  iReportLength			- The length of the Report
+ *			  bScaled				- Scale the values
+ *	 Output:
+ *			  piUsageValues			- The usage Values
+ *			  piUsageStatus			- The status of each value
+ *	 Returns:
+ *
+ *	Each report item is checked against the report once, no matter how
+ *	  many of the usages it has.  A usage is done once it has a value or
+ *	  an error other than kHIDIncompatibleReportErr, which gives each
+ *	  usage the result HIDGetUsageValue or HIDGetScaledUsageValue would.
+ *
+ *------------------------------------------------------------------------------
+*/
+static OSStatus HIDGetUsageValuesInternal
+		  (HIDReportType			reportType,
+		   UInt32					iCollection,
+		   HIDUsageAndPage *		ptUsageList,
+		   UInt32					iUsageListSize,
+		   SInt32 *					piUsageValues,
+		   OSStatus *				piUsageStatus,
+		   HIDPreparsedDataRef		preparsedDataRef,
+		   void *					psReport,
+		   IOByteCount				iReportLength,
+		   Boolean					bScaled)
+{
+	HIDPreparsedDataPtr ptPreparsedData = (HIDPreparsedDataPtr) preparsedDataRef;
+	HIDCollection *ptCollection;
+	HIDReportItem *ptReportItem;
+	OSStatus iStatus;
+	OSStatus iCheckStatus;
+	Boolean bChecked;
+	UInt32 iPending;
+	UInt32 i;
+	int iR;
+	SInt32 iValue;
+	int iStart;
+	int iReportItem;
+	UInt32 iUsageIndex;
+/*
+ *	Disallow Null Pointers
+*/
+	if ((ptPreparsedData == NULL)
+	 || (ptUsageList == NULL)
+	 || (piUsageValues == NULL)
+	 || (piUsageStatus == NULL)
+	 || (psReport == NULL))
+		return kHIDNullPointerErr;
+	if (ptPreparsedData->hidTypeIfValid != kHIDOSType)
+		return kHIDInvalidPreparsedDataErr;
+/*
+ *	The Collection must be in range
+*/
+	if (iCollection >= ptPreparsedData->collectionCount)
+		return kHIDBadParameterErr;
+/*
+ *	Until a usage is found, its status says why not
+*/
+	for (i=0; i<iUsageListSize; i++)
+		piUsageStatus[i] = kHIDUsageNotFoundErr;
+	iPending = iUsageListSize;
+/*
+ *	Search only the scope of the Collection specified
+ *	Go through the ReportItems once, stopping when every usage is done
+*/
+	ptCollection = &ptPreparsedData->collections[iCollection];
+	for (iR=0; (iR<ptCollection->reportItemCount) && (iPending > 0); iR++)
+	{
+		iReportItem = ptCollection->firstReportItem + iR;
+		ptReportItem = &ptPreparsedData->reportItems[iReportItem];
+		if (!HIDIsVariable(ptReportItem, preparsedDataRef))
+			continue;
+		bChecked = false;
+		iCheckStatus = kHIDSuccess;
+		for (i=0; i<iUsageListSize; i++)
+		{
+			if ((piUsageStatus[i] != kHIDUsageNotFoundErr)
+			 && (piUsageStatus[i] != kHIDIncompatibleReportErr))
+				continue;
+			if (!HIDReportItemHasUsage(ptPreparsedData,ptReportItem,ptUsageList[i].usagePage,
+									   ptUsageList[i].usage)
+			 || !HIDHasUsage(preparsedDataRef,ptReportItem,ptUsageList[i].usagePage,
+							 ptUsageList[i].usage,&iUsageIndex,NULL))
+				continue;
+/*
+ *			Let's check for the proper Report ID, Type, and Length,
+ *			  once for all of the usages in this report item
+*/
+			if (!bChecked)
+			{
+				iCheckStatus = HIDCheckReport(reportType,preparsedDataRef,ptReportItem,
+											  psReport,iReportLength);
+				bChecked = true;
+			}
+/*
+ *			The Report ID or Type may not match.
+ *			This may not be an error (yet)
+*/
+			if (iCheckStatus != kHIDSuccess)
+			{
+				piUsageStatus[i] = iCheckStatus;
+				if (iCheckStatus != kHIDIncompatibleReportErr)
+					iPending--;
+				continue;
+			}
+/*
+ *			Pick up the data
+*/
+			iStart = ptReportItem->startBit
+				   + (ptReportItem->globals.reportSize * iUsageIndex);
+			iStatus = HIDGetData(psReport, iReportLength, iStart,
+								   ptReportItem->globals.reportSize, &iValue,
+								   ((ptReportItem->globals.logicalMinimum < 0)
+								  ||(ptReportItem->globals.logicalMaximum < 0)));
+			if (!iStatus)
+				iStatus = HIDPostProcessRIValue (ptReportItem, &iValue);
+/*
+ *			Try to scale the data
+*/
+			if (!bScaled)
+				piUsageValues[i] = iValue;
+			else if (iStatus == kHIDSuccess)
+			{
+				iStatus = HIDScaleUsageValueIn(ptReportItem,iValue,&iValue);
+				piUsageValues[i] = iValue;
+			}
+			piUsageStatus[i] = iStatus;
+			iPending--;
+		}
+	}
+/*
+ *	Report the first usage that did not get a value
+*/
+	for (i=0; i<iUsageListSize; i++)
+		if (piUsageStatus[i] != kHIDSuccess)
+			return piUsageStatus[i];
+	return kHIDSuccess;
+}
+
+/*
+ *------------------------------------------------------------------------------
+ *
+ * HIDGetUsageValues - Get the values for a list of usages
+ *
+ *	 Input:
+ *			  reportType		   - HIDP_Input, HIDP_Output, HIDP_Feature
+ *			  iCollection			- Collection Criteria or zero
+ *			  ptUsageList			- The usages and pages to get the values for
+ *			  iUsageListSize		- Number of usages in the list
+ *			  piUsageValues			- User-supplied place to put the values
+ *			  piUsageStatus			- User-supplied place to put the status of
+ *										each value
+ *			  ptPreparsedData		- Pre-Parsed Data
+ *			  psReport				- An HID Report
+ *			  iReportLength			- The length of the Report
+ *	 Output:
+ *			  piUsageValues			- The usage Values
+ *			  piUsageStatus			- The status of each value
+ *	 Returns:
+ *
+ *------------------------------------------------------------------------------
+*/
+OSStatus HIDGetUsageValues
+		  (HIDReportType			reportType,
+		   UInt32					iCollection,
+		   HIDUsageAndPage *		ptUsageList,
+		   UInt32					iUsageListSize,
+		   SInt32 *					piUsageValues,
+		   OSStatus *				piUsageStatus,
+		   HIDPreparsedDataRef		preparsedDataRef,
+		   void *					psReport,
+		   IOByteCount				iReportLength)
+{
+	return HIDGetUsageValuesInternal(reportType, iCollection, ptUsageList, iUsageListSize,
+									 piUsageValues, piUsageStatus, preparsedDataRef,
+									 psReport, iReportLength, false);
+}
+
+/*
+ *------------------------------------------------------------------------------
+ *
+ * HIDGetScaledUsageValues - Get the scaled values for a list of usages
+ *
+ *	 Input:
+ *			  reportType		   - HIDP_Input, HIDP_Output, HIDP_Feature
+ *			  iCollection			- Collection Criteria or zero
+ *			  ptUsageList			- The usages and pages to get the values for
+ *			  iUsageListSize		- Number of usages in the list
+ *			  piUsageValues			- User-supplied place to put the values
+ *			  piUsageStatus			- User-supplied place to put the status of
+ *										each value
+ *			  ptPreparsedData		- Pre-Parsed Data
+ *			  psReport				- An HID Report
+ *			  iReportLength			- The length of the Report
+ *	 Output:
+ *			  piUsageValues			- The scaled usage Values
+ *			  piUsageStatus			- The status of each value
+ *	 Returns:
+ *
+ *------------------------------------------------------------------------------
+*/
+OSStatus HIDGetScaledUsageValues
+		  (HIDReportType			reportType,
+		   UInt32					iCollection,
+		   HIDUsageAndPage *		ptUsageList,
+		   UInt32					iUsageListSize,
+		   SInt32 *					piUsageValues,
+		   OSStatus *				piUsageStatus,
+		   HIDPreparsedDataRef		preparsedDataRef,
+		   void *					psReport,
+		   IOByteCount				iReportLength)
+{
+	return HIDGetUsageValuesInternal(reportType, iCollection, ptUsageList, iUsageListSize,
+									 piUsageValues, piUsageStatus, preparsedDataRef,
+									 psReport, iReportLength, true);
+}
@@ -93,7 +93,7 @@ OSStatus HIDGetUsageValueArray(HIDReportType reportType,
 	HIDReportItem *ptReportItem;
 	OSStatus iStatus;
 	int i;
-	int iR;
+	HIDUsageSearch tSearch;
 	SInt32 iValue;
 	int iStart;
 	int iReportItem;
@@ -121,9 +121,9 @@ OSStatus HIDGetUsageValueArray(HIDReportType reportType,
  *	Filter on ReportType and usagePage
 */
 	ptCollection = &ptPreparsedData->collections[iCollection];
-	for (iR=0; iR<ptCollection->reportItemCount; iR++)
+	HIDBeginUsageSearch(preparsedDataRef, ptCollection, usage, &tSearch);
+	while (HIDNextUsageSearchItem(preparsedDataRef, &tSearch, &iReportItem))
 	{
-		iReportItem = ptCollection->firstReportItem + iR;
 		ptReportItem = &ptPreparsedData->reportItems[iReportItem];
 		if (HIDIsVariable(ptReportItem, preparsedDataRef)
 		 && HIDHasUsage(preparsedDataRef,ptReportItem,usagePage,usage,&iUsageIndex,&iCount))
@@ -188,3 +188,150 @@ Boolean HIDHasUsage (HIDPreparsedDataRef preparsedDataRef,
 	}
 	return false;
 }
+
+/*
+ *------------------------------------------------------------------------------
+ *
+ * HIDBeginUsageSearch - Start walking the report items that may have a usage
+ *
+ *	 Input:
+ *			  ptPreparsedData		- The Preparsed Data
+ *			  ptCollection			- The Collection to search
+ *			  usage				   - The usage to find
+ *			  ptSearch				- The search state
+ *	 Output:
+ *			  ptSearch				- The search state
+ *	 Returns:
+ *
+ *	The search returns the report items of the collection in order.  When
+ *	  the Preparsed Data has a usage index, items that cannot have the usage
+ *	  on any page are skipped.  Callers still check each item with HIDHasUsage.
+ *
+ *------------------------------------------------------------------------------
+*/
+void HIDBeginUsageSearch (HIDPreparsedDataRef preparsedDataRef,
+						  HIDCollection *ptCollection,
+						  HIDUsage usage,
+						  HIDUsageSearch *ptSearch)
+{
+	HIDPreparsedDataPtr ptPreparsedData = (HIDPreparsedDataPtr) preparsedDataRef;
+	HIDUsageIndexEntry *ptEntry;
+	UInt32 iLow;
+	UInt32 iHigh;
+	UInt32 iMid;
+
+	ptSearch->usage = usage;
+	ptSearch->firstReportItem = ptCollection->firstReportItem;
+	ptSearch->endReportItem = ptCollection->firstReportItem + ptCollection->reportItemCount;
+	ptSearch->nextReportItem = ptSearch->firstReportItem;
+	ptSearch->nextEntry = 0;
+	ptSearch->nextWideItem = 0;
+	ptSearch->lastReportItem = -1;
+	ptSearch->indexed = (ptPreparsedData->usageIndex != NULL);
+	if (!ptSearch->indexed)
+		return;
+/*
+ *	Find the first index entry for this usage in the collection
+*/
+	iLow = 0;
+	iHigh = ptPreparsedData->usageIndexCount;
+	while (iLow < iHigh)
+	{
+		iMid = iLow + (iHigh - iLow) / 2;
+		ptEntry = &ptPreparsedData->usageIndex[iMid];
+		if ((ptEntry->usage < usage)
+		 || ((ptEntry->usage == usage) && (ptEntry->reportItem < ptSearch->firstReportItem)))
+			iLow = iMid + 1;
+		else
+			iHigh = iMid;
+	}
+	ptSearch->nextEntry = iLow;
+/*
+ *	And the first report item in the collection with a wide usage range
+*/
+	iLow = 0;
+	iHigh = ptPreparsedData->wideItemCount;
+	while (iLow < iHigh)
+	{
+		iMid = iLow + (iHigh - iLow) / 2;
+		if (ptPreparsedData->wideItems[iMid] < ptSearch->firstReportItem)
+			iLow = iMid + 1;
+		else
+			iHigh = iMid;
+	}
+	ptSearch->nextWideItem = iLow;
+}
+
+/*
+ *------------------------------------------------------------------------------
+ *
+ * HIDNextUsageSearchItem - Get the next report item that may have the usage
+ *
+ *	 Input:
+ *			  ptPreparsedData		- The Preparsed Data
+ *			  ptSearch				- The search state
+ *	 Output:
+ *			  ptSearch				- The search state
+ *			  piReportItem			- Index of the report item
+ *	 Returns:
+ *			  false if there are no more report items
+ *
+ *------------------------------------------------------------------------------
+*/
+Boolean HIDNextUsageSearchItem (HIDPreparsedDataRef preparsedDataRef,
+								HIDUsageSearch *ptSearch,
+								int *piReportItem)
+{
+	HIDPreparsedDataPtr ptPreparsedData = (HIDPreparsedDataPtr) preparsedDataRef;
+	HIDUsageIndexEntry *ptEntry;
+	UInt32 iEntryItem;
+	UInt32 iWideItem;
+	UInt32 iReportItem;
+
+	if (!ptSearch->indexed)
+	{
+		if (ptSearch->nextReportItem >= ptSearch->endReportItem)
+			return false;
+		*piReportItem = ptSearch->nextReportItem++;
+		return true;
+	}
+/*
+ *	Merge the index entries for the usage with the wide range items,
+ *	  both of which are in report item order
+*/
+	for (;;)
+	{
+		iEntryItem = ptSearch->endReportItem;
+		if (ptSearch->nextEntry < ptPreparsedData->usageIndexCount)
+		{
+			ptEntry = &ptPreparsedData->usageIndex[ptSearch->nextEntry];
+			if ((ptEntry->usage == ptSearch->usage) && (ptEntry->reportItem < iEntryItem))
+				iEntryItem = ptEntry->reportItem;
+		}
+		iWideItem = ptSearch->endReportItem;
+		if ((ptSearch->nextWideItem < ptPreparsedData->wideItemCount)
+		 && (ptPreparsedData->wideItems[ptSearch->nextWideItem] < iWideItem))
+			iWideItem = ptPreparsedData->wideItems[ptSearch->nextWideItem];
+
+		if (iEntryItem <= iWideItem)
+		{
+			iReportItem = iEntryItem;
+			ptSearch->nextEntry++;
+		}
+		else
+		{
+			iReportItem = iWideItem;
+			ptSearch->nextWideItem++;
+		}
+		if (iReportItem >= ptSearch->endReportItem)
+			return false;
+/*
+ *		A report item can be listed more than once
+*/
+		if ((SInt32) iReportItem == ptSearch->lastReportItem)
+			continue;
+		ptSearch->lastReportItem = iReportItem;
+		*piReportItem = iReportItem;
+		return true;
+	}
+}
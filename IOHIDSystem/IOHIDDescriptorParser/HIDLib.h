@@ -53,6 +53,31 @@
 
 #define	kShouldClearMem		true
 
+/*
+ *	Layout of the arena holding a HIDPreparsedData and its arrays
+*/
+#define kHIDCacheLineSize	64
+#define kHIDItemAlignment	8
+
+#define HIDAlign(value, alignment) \
+	(((value) + ((alignment) - 1)) & ~((IOByteCount) (alignment) - 1))
+
+/*
+ *	Limits on the usage index built at parse time.  Usage ranges larger
+ *	  than kHIDUsageIndexMaxRange, or that do not fit in the index, leave
+ *	  their report item on the list that every usage search visits.
+*/
+#define kHIDUsageIndexMaxRange		64
+#define kHIDUsageIndexMaxEntries	2048
+
+/*
+ *	Usage bitmaps, one bit per usage in UInt32 words
+*/
+#define HIDUsageBitmapWords(usages)		(((usages) + 31) / 32)
+#define HIDSetUsageBit(bitmap, usage)	((bitmap)[(usage) / 32] |= (1U << ((usage) % 32)))
+#define HIDClearUsageBit(bitmap, usage)	((bitmap)[(usage) / 32] &= ~(1U << ((usage) % 32)))
+#define HIDTestUsageBit(bitmap, usage)	(((bitmap)[(usage) / 32] & (1U << ((usage) % 32))) != 0)
+
 /*------------------------------------------------------------------------------*/
 /*																				*/
 /* HID Library definitions														*/
@@ -106,6 +131,11 @@ extern OSStatus
 HIDParseDescriptor		   (HIDReportDescriptor *	reportDescriptor,
 							HIDPreparsedDataPtr 	preparsedData);
 
+extern OSStatus
+HIDParseDescriptorInOnePass(HIDReportDescriptor *	reportDescriptor,
+							UInt32					flags,
+							HIDPreparsedDataPtr *	preparsedData);
+
 extern OSStatus
 HIDProcessCollection	   (HIDReportDescriptor *	reportDescriptor,
 							HIDPreparsedDataPtr 	preparsedData);
@@ -28,5 +28,7 @@
 
 extern void *PoolAllocateResident(vm_size_t size, unsigned char clear);
 extern OSStatus PoolDeallocate(void *ptr, vm_size_t size);
+extern void *PoolAllocateAligned(vm_size_t size, vm_size_t alignment, unsigned char clear);
+extern OSStatus PoolDeallocateAligned(void *ptr, vm_size_t size);
 
 #endif /* __HID_MACTYPES__ */
@@ -115,8 +115,10 @@ OSStatus HIDNextItem(HIDReportDescriptor *ptDescriptor)
 */
 	if (iHeader==kHIDLongItemHeader)
 	{
+		if ((*piX + 2) > iLength)
+			return kHIDEndOfDescriptorErr;
 		iSize = psD[(*piX)++];
-		ptItem->tag = *piX++;
+		ptItem->tag = psD[(*piX)++];
 	}
 /*
  *	Short Item Header
@@ -49,6 +49,7 @@
 */
 
 #include "HIDLib.h"
+#include <string.h>
 
 //#include <stdlib.h>
 
@@ -81,6 +82,14 @@ OSStatus HIDCloseReportDescriptor(HIDPreparsedDataRef preparsedDataRef)
 */
 	if (ptPreparsedData->hidTypeIfValid != kHIDOSType)
 		return kHIDInvalidPreparsedDataErr;
+/*
+ *	The structure and its arrays may share one arena, which goes at once
+*/
+	if (ptPreparsedData->arenaSize != 0)
+	{
+		ptPreparsedData->hidTypeIfValid = 0;
+		return PoolDeallocateAligned (ptPreparsedData, ptPreparsedData->arenaSize);
+	}
 /*
  *	Free any memory that was allocated
 */
@@ -135,65 +144,148 @@ HIDOpenReportDescriptor	   (void *					hidReportDescriptor,
 		return kHIDNullPointerErr;
 	
 /*
- *	Initialize the return result, and allocate space for preparsed data
+ *	Initialize the return result
 */
 	*preparsedDataRef = NULL;
-	
-	ptPreparsedData = PoolAllocateResident (sizeof (HIDPreparsedData), kShouldClearMem);
-	
 /*
- *	Make sure we got the memory
+ *	Set up the descriptor structure
 */
-	if (ptPreparsedData == NULL)
-		return kHIDNotEnoughMemoryErr;
+	tDescriptor.descriptor = hidReportDescriptor;
+	tDescriptor.descriptorLength = descriptorLength;
+/*
+ *	Count the various items in the descriptor, and fill in the structures
+ *	  of a PreparsedData structure allocated to fit them, all in one walk
+ *	  of the descriptor
+*/
+	iStatus = HIDParseDescriptorInOnePass(&tDescriptor,flags,&ptPreparsedData);
+/*
+ *	Mark the PreparsedData initialized
+*/
+	if (iStatus == kHIDSuccess)
+	{
+		ptPreparsedData->hidTypeIfValid = kHIDOSType;
+		*preparsedDataRef = (HIDPreparsedDataRef) ptPreparsedData;
+	}
+
+	return iStatus;
+}
 
 /*
- *	Copy the flags field
+ *------------------------------------------------------------------------------
+ *
+ * HIDCopyPreparsedData - Copy the PreParsedData Structure
+ *
+ *	 Input:
+ *			  preparsedDataRef		- The PreParsedData Structure
+ *	 Output:
+ *			  copyRef				- An independent copy of it
+ *	 Returns:
+ *			  kHIDSuccess		   - Success
+ *			  kHIDNullPointerErr	  - Argument, Pointer was Null
+ *			  kHIDInvalidPreparsedDataErr - PreParsedData is not open
+ *			  kHIDNotEnoughMemoryErr - Out of memory
+ *
+ *------------------------------------------------------------------------------
 */
-	ptPreparsedData->flags = flags;
+OSStatus
+HIDCopyPreparsedData	   (HIDPreparsedDataRef		preparsedDataRef,
+							HIDPreparsedDataRef *	copyRef)
+{
+	HIDPreparsedDataPtr ptPreparsedData = (HIDPreparsedDataPtr) preparsedDataRef;
+	HIDPreparsedDataPtr ptCopy;
+	UInt8 *pBase;
+	UInt8 *pMem;
+
 /*
- *	Initialize the memory allocation pointer
+ *	Disallow NULL Pointers
 */
-	ptPreparsedData->rawMemPtr = NULL;
+	if ((ptPreparsedData == NULL) || (copyRef == NULL))
+		return kHIDNullPointerErr;
+	if (ptPreparsedData->hidTypeIfValid != kHIDOSType)
+		return kHIDInvalidPreparsedDataErr;
+
+	*copyRef = NULL;
 /*
- *	Set up the descriptor structure
+ *	An arena holds the structure and all of its arrays, so copy it whole
+ *	  and rebase each pointer onto the new one
 */
-	tDescriptor.descriptor = hidReportDescriptor;
-	tDescriptor.descriptorLength = descriptorLength;
+	if (ptPreparsedData->arenaSize != 0)
+	{
+		ptCopy = PoolAllocateAligned (ptPreparsedData->arenaSize, kHIDCacheLineSize, 0);
+		if (ptCopy == NULL)
+			return kHIDNotEnoughMemoryErr;
+
+		memcpy (ptCopy, ptPreparsedData, ptPreparsedData->arenaSize);
+		pBase = (UInt8 *) ptPreparsedData;
+		pMem = (UInt8 *) ptCopy;
+	}
 /*
- *	Count various items in the descriptor
- *	  allocate space within the PreparsedData structure
- *	  and initialize the counters there
+ *	Otherwise the arrays all live in one block of raw memory, so copy
+ *	  the block
 */
-	iStatus = HIDCountDescriptorItems(&tDescriptor,ptPreparsedData);
-    
-    /*
-     *	Parse the Descriptor
-     *	  filling in the structures in the PreparsedData structure
-    */
-	if (iStatus == kHIDSuccess)
-    {
-        iStatus = HIDParseDescriptor(&tDescriptor,ptPreparsedData);
-    /*
-     *	Mark the PreparsedData initialized, maybe
-    */
-        if (iStatus == kHIDSuccess && ptPreparsedData->rawMemPtr != NULL)
-        {
-            ptPreparsedData->hidTypeIfValid = kHIDOSType;
-            *preparsedDataRef = (HIDPreparsedDataRef) ptPreparsedData;
-        
-            return kHIDSuccess;
-        }
-    }
-    
-	// something failed, deallocate everything, and make sure we return an error
-    if (ptPreparsedData->rawMemPtr != NULL)
-        PoolDeallocate (ptPreparsedData->rawMemPtr, ptPreparsedData->numBytesAllocated);
-        
-    PoolDeallocate (ptPreparsedData, sizeof(HIDPreparsedData));
-    
-    if (iStatus == kHIDSuccess)
-        iStatus = kHIDNotEnoughMemoryErr;
+	else
+	{
+		ptCopy = PoolAllocateResident (sizeof (HIDPreparsedData), kShouldClearMem);
+		if (ptCopy == NULL)
+			return kHIDNotEnoughMemoryErr;
 
-	return iStatus;
+		pMem = PoolAllocateResident (ptPreparsedData->numBytesAllocated, 0);
+		if (pMem == NULL)
+		{
+			PoolDeallocate (ptCopy, sizeof(HIDPreparsedData));
+			return kHIDNotEnoughMemoryErr;
+		}
+
+		memcpy (pMem, ptPreparsedData->rawMemPtr, ptPreparsedData->numBytesAllocated);
+		*ptCopy = *ptPreparsedData;
+		pBase = ptPreparsedData->rawMemPtr;
+	}
+
+#define RebasePointer(type, field) \
+	ptCopy->field = (type *) (pMem + ((UInt8 *) ptPreparsedData->field - pBase))
+
+	RebasePointer(UInt8, rawMemPtr);
+	RebasePointer(HIDCollection, collections);
+	RebasePointer(HIDReportItem, reportItems);
+	RebasePointer(HIDReportSizes, reports);
+	RebasePointer(HIDP_UsageItem, usageItems);
+	RebasePointer(HIDStringItem, stringItems);
+	RebasePointer(HIDDesignatorItem, desigItems);
+	if (ptPreparsedData->usageIndex != NULL)
+	{
+		RebasePointer(HIDUsageIndexEntry, usageIndex);
+		RebasePointer(UInt32, wideItems);
+	}
+
+#undef RebasePointer
+
+	*copyRef = (HIDPreparsedDataRef) ptCopy;
+
+	return kHIDSuccess;
+}
+
+/*
+ *------------------------------------------------------------------------------
+ *
+ * HIDGetPreparsedDataSize - Size of the PreParsedData Structure
+ *
+ *	 Input:
+ *			  preparsedDataRef		- The PreParsedData Structure
+ *	 Returns:
+ *			  The bytes held by the structure, 0 if it is not open
+ *
+ *------------------------------------------------------------------------------
+*/
+IOByteCount
+HIDGetPreparsedDataSize	   (HIDPreparsedDataRef		preparsedDataRef)
+{
+	HIDPreparsedDataPtr ptPreparsedData = (HIDPreparsedDataPtr) preparsedDataRef;
+
+	if ((ptPreparsedData == NULL) || (ptPreparsedData->hidTypeIfValid != kHIDOSType))
+		return 0;
+
+	if (ptPreparsedData->arenaSize != 0)
+		return ptPreparsedData->arenaSize;
+
+	return sizeof(HIDPreparsedData) + ptPreparsedData->numBytesAllocated;
 }
@@ -47,38 +47,29 @@
 */
 
 #include "HIDLib.h"
+#include <string.h>
 
 //#include <stdio.h>
 /*
  *------------------------------------------------------------------------------
  *
- * HIDParseDescriptor - Fill in the PreparsedData structures
+ * HIDInitParseState - Reset the parser state before filling in the structures
  *
  *	 Input:
  *			  ptDescriptor			- Descriptor Pointer Structure
  *			  ptPreparsedData		- The PreParsedData Structure
  *	 Output:
+ *			  ptDescriptor			- Descriptor Pointer Structure
  *			  ptPreparsedData		- The PreParsedData Structure
- *	 Returns:
- *			  kHIDSuccess		   - Success
- *			  kHIDNullPointerErr	  - Argument, Pointer was Null
  *
- *	NOTE: HIDCountDescriptorItems MUST have been called to set up the
- *		  array pointers in the HIDPreparsedData structure!
+ *	NOTE: The collections and reports arrays must have room for one entry
  *
  *------------------------------------------------------------------------------
 */
-OSStatus HIDParseDescriptor(HIDReportDescriptor *ptDescriptor, HIDPreparsedDataPtr ptPreparsedData)
+static void HIDInitParseState(HIDReportDescriptor *ptDescriptor, HIDPreparsedDataPtr ptPreparsedData)
 {
-	OSStatus iStatus;
-	HIDItem *ptItem;
 	HIDCollection *ptCollection;
 	HIDReportSizes *ptReport;
-/*
- *	Disallow NULL Pointers
-*/
-	if ((ptDescriptor == NULL) || (ptPreparsedData == NULL))
-		return kHIDNullPointerErr;
 /*
  *	Initialize Counters
 */
@@ -116,7 +107,6 @@ OSStatus HIDParseDescriptor(HIDReportDescriptor *ptDescriptor, HIDPreparsedDataP
 	ptDescriptor->haveStringMax = false;
 	ptDescriptor->haveDesigMin = false;
 	ptDescriptor->haveDesigMax = false;
-	ptItem = &ptDescriptor->item;
 /*
  *	Initialize the virtual collection
 */
@@ -139,36 +129,674 @@ OSStatus HIDParseDescriptor(HIDReportDescriptor *ptDescriptor, HIDPreparsedDataP
 	ptReport->inputBitCount = 0;
 	ptReport->outputBitCount = 0;
 	ptReport->featureBitCount = 0;
+}
 
+/*
+ *------------------------------------------------------------------------------
+ *
+ * HIDProcessItem - Process one item of the Descriptor
+ *
+ *------------------------------------------------------------------------------
+*/
+static OSStatus HIDProcessItem(HIDReportDescriptor *ptDescriptor, HIDPreparsedDataPtr ptPreparsedData)
+{
+	switch (ptDescriptor->item.itemType)
+	{
+		case kHIDTypeMain:
+			return HIDProcessMainItem(ptDescriptor,ptPreparsedData);
+		case kHIDTypeGlobal:
+			return HIDProcessGlobalItem(ptDescriptor,ptPreparsedData);
+		case kHIDTypeLocal:
+			return HIDProcessLocalItem(ptDescriptor,ptPreparsedData);
+	}
+	return kHIDSuccess;
+}
+
+/*
+ *------------------------------------------------------------------------------
+ *
+ * HIDParseDescriptor - Fill in the PreparsedData structures
+ *
+ *	 Input:
+ *			  ptDescriptor			- Descriptor Pointer Structure
+ *			  ptPreparsedData		- The PreParsedData Structure
+ *	 Output:
+ *			  ptPreparsedData		- The PreParsedData Structure
+ *	 Returns:
+ *			  kHIDSuccess		   - Success
+ *			  kHIDNullPointerErr	  - Argument, Pointer was Null
+ *
+ *	NOTE: HIDCountDescriptorItems MUST have been called to set up the
+ *		  array pointers in the HIDPreparsedData structure!
+ *
+ *------------------------------------------------------------------------------
+*/
+OSStatus HIDParseDescriptor(HIDReportDescriptor *ptDescriptor, HIDPreparsedDataPtr ptPreparsedData)
+{
+	OSStatus iStatus;
+	HIDCollection *ptCollection;
+/*
+ *	Disallow NULL Pointers
+*/
+	if ((ptDescriptor == NULL) || (ptPreparsedData == NULL))
+		return kHIDNullPointerErr;
+
+	HIDInitParseState(ptDescriptor, ptPreparsedData);
 /*
  *	Parse the Descriptor
+*/
+	while ((iStatus = HIDNextItem(ptDescriptor)) == kHIDSuccess)
+	{
+		iStatus = HIDProcessItem(ptDescriptor,ptPreparsedData);
+		if (iStatus != kHIDSuccess)
+			return iStatus;
+	}
+	if (iStatus == kHIDEndOfDescriptorErr)
+		iStatus = kHIDSuccess;
+/*
+ *	Update the virtual collection
+*/
+	ptCollection = ptPreparsedData->collections;
+	ptCollection->reportItemCount = ptPreparsedData->reportItemCount;
+/*
+ *	Mark the PreparsedData initialized
+*/
+	return iStatus;
+}
+
+/*
+ *------------------------------------------------------------------------------
+ *
+ * HIDArenaAllocate - Carve an aligned block out of an arena
+ *
+ *	 Input:
+ *			  ptArena				- The arena
+ *			  size					- Size of the block
+ *			  alignment				- Alignment of the block, a power of 2
+ *	 Output:
+ *			  ptArena				- The arena
+ *	 Returns:
+ *			  The block, or NULL if the arena does not have room for it
+ *
+ *------------------------------------------------------------------------------
+*/
+struct HIDArena
+{
+	UInt8 *			base;
+	IOByteCount		size;
+	IOByteCount		used;
+};
+typedef struct HIDArena HIDArena;
+
+static void *HIDArenaAllocate(HIDArena *ptArena, IOByteCount size, IOByteCount alignment)
+{
+	IOByteCount offset = HIDAlign(ptArena->used, alignment);
+
+	if ((ptArena->base == NULL) || (offset + size > ptArena->size))
+		return NULL;
+
+	ptArena->used = offset + size;
+	return ptArena->base + offset;
+}
+
+#define HIDArenaContains(ptArena, ptr) \
+	(((UInt8 *) (ptr) >= (ptArena)->base) && ((UInt8 *) (ptr) < (ptArena)->base + (ptArena)->size))
+
+/*
+ *------------------------------------------------------------------------------
+ *
+ * HIDGrowArray - Make room for more entries in a parse array
+ *
+ *	 Input:
+ *			  ptArena				- The scratch arena
+ *			  items					- The array, NULL if not allocated yet
+ *			  capacity				- Number of entries the array holds
+ *			  needed				- Number of entries that must fit
+ *			  itemSize				- Size of one entry
+ *	 Output:
+ *			  items					- The array, moved if it was grown
+ *			  capacity				- Number of entries the array holds
+ *	 Returns:
+ *			  kHIDSuccess		   - Success
+ *			  kHIDNotEnoughMemoryErr - Out of memory
+ *
+ *	Arrays start out in the scratch arena, and move to their own memory
+ *	  once they outgrow it.
+ *
+ *------------------------------------------------------------------------------
+*/
+static OSStatus HIDGrowArray(HIDArena *ptArena, void **items, UInt32 *capacity, UInt32 needed, IOByteCount itemSize)
+{
+	UInt32 newCapacity;
+	void *newItems;
+
+	if (needed <= *capacity)
+		return kHIDSuccess;
+
+	newCapacity = (*capacity) ? *capacity : 4;
+	while (newCapacity < needed)
+		newCapacity *= 2;
+
+	newItems = PoolAllocateResident(newCapacity * itemSize, kShouldClearMem);
+	if (newItems == NULL)
+		return kHIDNotEnoughMemoryErr;
+
+	if (*items != NULL)
+	{
+		memcpy(newItems, *items, *capacity * itemSize);
+		if (!HIDArenaContains(ptArena, *items))
+			PoolDeallocate(*items, *capacity * itemSize);
+	}
+
+	*items = newItems;
+	*capacity = newCapacity;
+	return kHIDSuccess;
+}
+
+/*
+ *------------------------------------------------------------------------------
+ *
+ * HIDBuildUsageIndex - Index the report items by the usages they have
+ *
+ *	 Input:
+ *			  ptPreparsedData		- The PreParsedData Structure
+ *			  ptEntries				- The index to fill in, or NULL to count
+ *			  piWideItems			- The wide range items to fill in, or NULL
+ *	 Output:
+ *			  ptEntries				- Entries in report item order
+ *			  piWideItems			- Report items in order
+ *			  piWideItemCount		- Number of wide range items
+ *	 Returns:
+ *			  Number of index entries
+ *
+ *	Each usage, and each usage in a small range, gets an entry for its
+ *	  report item.  Report items with a range that is too large, or that no
+ *	  longer fits in the index, are put on the wide range list instead.
+ *
+ *------------------------------------------------------------------------------
+*/
+static UInt32 HIDBuildUsageIndex(HIDPreparsedDataPtr ptPreparsedData, HIDUsageIndexEntry *ptEntries,
+								 UInt32 *piWideItems, UInt32 *piWideItemCount)
+{
+	HIDReportItem *ptReportItem;
+	HIDP_UsageItem *ptUsageItem;
+	UInt32 iEntries = 0;
+	UInt32 iWideItems = 0;
+	UInt32 iReportItem;
+	UInt32 iUsage;
+	UInt32 iUsageMinimum;
+	UInt32 iUsageMaximum;
+	Boolean bWide;
+	int i;
+
+	for (iReportItem=0; iReportItem<ptPreparsedData->reportItemCount; iReportItem++)
+	{
+		ptReportItem = &ptPreparsedData->reportItems[iReportItem];
+		bWide = false;
+		for (i=0; i<ptReportItem->usageItemCount; i++)
+		{
+			ptUsageItem = &ptPreparsedData->usageItems[ptReportItem->firstUsageItem + i];
+/*
+ *			HIDHasUsage compares usages unsigned, so do the same here
+*/
+			if (ptUsageItem->isRange)
+			{
+				iUsageMinimum = (UInt32) ptUsageItem->usageMinimum;
+				iUsageMaximum = (UInt32) ptUsageItem->usageMaximum;
+				if (iUsageMaximum < iUsageMinimum)
+					continue;
+			}
+			else
+				iUsageMinimum = iUsageMaximum = ptUsageItem->usage;
+
+			if ((iUsageMaximum - iUsageMinimum >= kHIDUsageIndexMaxRange)
+			 || (iEntries + (iUsageMaximum - iUsageMinimum) >= kHIDUsageIndexMaxEntries))
+			{
+				bWide = true;
+				continue;
+			}
+			for (iUsage=iUsageMinimum; ; iUsage++)
+			{
+				if (ptEntries != NULL)
+				{
+					ptEntries[iEntries].usage = iUsage;
+					ptEntries[iEntries].reportItem = iReportItem;
+				}
+				iEntries++;
+				if (iUsage == iUsageMaximum)
+					break;
+			}
+		}
+		if (bWide)
+		{
+			if (piWideItems != NULL)
+				piWideItems[iWideItems] = iReportItem;
+			iWideItems++;
+		}
+	}
+	*piWideItemCount = iWideItems;
+	return iEntries;
+}
+
+/*
+ *------------------------------------------------------------------------------
+ *
+ * HIDSortUsageIndex - Sort the usage index by usage, then report item
+ *
+ *	 Input:
+ *			  ptEntries				- The index, in report item order
+ *			  iCount				- Number of entries
+ *			  pScratch				- Scratch memory, or NULL
+ *			  iScratchSize			- Size of the scratch memory
+ *	 Output:
+ *			  ptEntries				- The sorted index
+ *	 Returns:
+ *
+ *	HIDBuildUsageIndex emits entries in report item order, so a stable sort
+ *	  on usage alone gives usage then report item order.  Large indexes get
+ *	  a radix sort when the scratch memory can hold a copy of them, anything
+ *	  else a heap sort on the full key.  Composite devices leave the entries
+ *	  far from usage order, so neither has a quadratic worst case.
+ *
+ *------------------------------------------------------------------------------
+*/
+#define kHIDUsageIndexRadixMin	128
+
+#define HIDUsageIndexEntryLess(a, b) \
+	(((a).usage < (b).usage) || (((a).usage == (b).usage) && ((a).reportItem < (b).reportItem)))
+
+static void HIDSiftUsageIndex(HIDUsageIndexEntry *ptEntries, UInt32 iRoot, UInt32 iCount)
+{
+	HIDUsageIndexEntry tEntry = ptEntries[iRoot];
+	UInt32 iChild;
+
+	while ((iChild = 2 * iRoot + 1) < iCount)
+	{
+		if ((iChild + 1 < iCount) && HIDUsageIndexEntryLess(ptEntries[iChild], ptEntries[iChild + 1]))
+			iChild++;
+		if (!HIDUsageIndexEntryLess(tEntry, ptEntries[iChild]))
+			break;
+		ptEntries[iRoot] = ptEntries[iChild];
+		iRoot = iChild;
+	}
+	ptEntries[iRoot] = tEntry;
+}
+
+static void HIDSortUsageIndex(HIDUsageIndexEntry *ptEntries, UInt32 iCount, void *pScratch, IOByteCount iScratchSize)
+{
+	HIDUsageIndexEntry tEntry;
+	HIDUsageIndexEntry *ptFrom = ptEntries;
+	HIDUsageIndexEntry *ptTo = (HIDUsageIndexEntry *) pScratch;
+	HIDUsageIndexEntry *ptSwap;
+	UInt32 iOffsets[256];
+	UInt32 iOffset;
+	UInt32 iDigit;
+	UInt32 iShift;
+	UInt32 i;
+
+	if ((iCount < kHIDUsageIndexRadixMin) || (pScratch == NULL)
+	 || (iScratchSize < sizeof(HIDUsageIndexEntry) * iCount))
+	{
+		for (i=iCount/2; i>0; i--)
+			HIDSiftUsageIndex(ptEntries, i - 1, iCount);
+		for (i=iCount; i>1; i--)
+		{
+			tEntry = ptEntries[0];
+			ptEntries[0] = ptEntries[i - 1];
+			ptEntries[i - 1] = tEntry;
+			HIDSiftUsageIndex(ptEntries, 0, i - 1);
+		}
+		return;
+	}
+/*
+ *	Least significant byte first, skipping bytes every usage shares
+*/
+	for (iShift=0; iShift<32; iShift+=8)
+	{
+		memset(iOffsets, 0, sizeof(iOffsets));
+		for (i=0; i<iCount; i++)
+			iOffsets[(ptFrom[i].usage >> iShift) & 0xFF]++;
+		if (iOffsets[(ptFrom[0].usage >> iShift) & 0xFF] == iCount)
+			continue;
+		for (iDigit=0, iOffset=0; iDigit<256; iDigit++)
+		{
+			i = iOffsets[iDigit];
+			iOffsets[iDigit] = iOffset;
+			iOffset += i;
+		}
+		for (i=0; i<iCount; i++)
+			ptTo[iOffsets[(ptFrom[i].usage >> iShift) & 0xFF]++] = ptFrom[i];
+		ptSwap = ptFrom;
+		ptFrom = ptTo;
+		ptTo = ptSwap;
+	}
+	if (ptFrom != ptEntries)
+		memcpy(ptEntries, ptFrom, sizeof(HIDUsageIndexEntry) * iCount);
+}
+
+#define HIDEnsureCapacity(array, type, needed, capacity) \
+	(((UInt32) (needed) <= (capacity)) ? kHIDSuccess : \
+		HIDGrowArray(&tScratch, (void **) &(array), &(capacity), (needed), sizeof(type)))
+
+#define HIDReleaseArray(array, type, capacity) \
+	if (((array) != NULL) && !HIDArenaContains(&tScratch, (array))) \
+		PoolDeallocate((array), (capacity) * sizeof(type))
+
+/*
+ *------------------------------------------------------------------------------
+ *
+ * HIDParseDescriptorInOnePass - Count, allocate and fill in the PreparsedData
+ *
+ *	 Input:
+ *			  ptDescriptor			- Descriptor Pointer Structure
+ *			  flags					- Flags for the PreParsedData Structure
+ *	 Output:
+ *			  ptPreparsedData		- The new PreParsedData Structure
+ *	 Returns:
+ *			  kHIDSuccess		   - Success
+ *			  kHIDNullPointerErr	  - Argument, Pointer was Null
+ *			  kHIDNotEnoughMemoryErr - Out of memory
+ *
+ *	Does the work of HIDCountDescriptorItems followed by HIDParseDescriptor
+ *	  in a single walk of the descriptor, and with the same errors.  Items
+ *	  are parsed into arrays that grow as needed, starting out in a scratch
+ *	  arena sized from the descriptor length.  The result is then packed
+ *	  into one arena holding the PreParsedData Structure and all of its
+ *	  arrays, which HIDCloseReportDescriptor releases with a single free.
+ *
+ *------------------------------------------------------------------------------
+*/
+OSStatus HIDParseDescriptorInOnePass(HIDReportDescriptor *ptDescriptor, UInt32 flags, HIDPreparsedDataPtr *ptPreparsedDataRef)
+{
+	OSStatus iStatus;
+	OSStatus iParseStatus = kHIDSuccess;
+	IOByteCount iSpaceRequired;
+	HIDItem *ptItem;
+	HIDPreparsedData tPreparsedData;
+	HIDPreparsedDataPtr ptPreparsedData = &tPreparsedData;
+	HIDPreparsedDataPtr ptArenaData;
+	HIDArena tScratch = { NULL, 0, 0 };
+	HIDArena tArena = { NULL, 0, 0 };
+	UInt32 iUsageIndexCount;
+	UInt32 iWideItemCount;
+/*
+ *	Counters, as kept by HIDCountDescriptorItems
+*/
+	int collectionCount	 = 1;
+	int reportItemCount	 = 0;
+	int iUsages		  = 0;
+	int iUsageRanges  = 0;
+	int iStrings	  = 0;
+	int iStringRanges = 0;
+	int iDesigs		  = 0;
+	int iDesigRanges  = 0;
+	int reportCount		 = 1;
+	int globalsNesting = 0;
+	int iMaxGlobalsNesting = 0;
+	int collectionNesting = 0;
+	int iMaxCollectionNesting = 0;
+/*
+ *	Growable arrays the items are parsed into
+*/
+	HIDCollection *collections = NULL;
+	HIDReportItem *reportItems = NULL;
+	HIDReportSizes *reports = NULL;
+	HIDP_UsageItem *usageItems = NULL;
+	HIDStringItem *stringItems = NULL;
+	HIDDesignatorItem *desigItems = NULL;
+	SInt32 *collectionStack = NULL;
+	HIDGlobalItems *globalsStack = NULL;
+	UInt32 collectionsCapacity = 0;
+	UInt32 reportItemsCapacity = 0;
+	UInt32 reportsCapacity = 0;
+	UInt32 usageItemsCapacity = 0;
+	UInt32 stringItemsCapacity = 0;
+	UInt32 desigItemsCapacity = 0;
+	UInt32 collectionStackCapacity = 0;
+	UInt32 globalsStackCapacity = 0;
+/*
+ *	Disallow NULL Pointers
+*/
+	if ((ptDescriptor == NULL) || (ptPreparsedDataRef == NULL))
+		return kHIDNullPointerErr;
+	*ptPreparsedDataRef = NULL;
+	memset(ptPreparsedData, 0, sizeof(HIDPreparsedData));
+	ptPreparsedData->flags = flags;
+	ptItem = &ptDescriptor->item;
+/*
+ *	Size the arrays for a typical descriptor of this length so that they
+ *	  rarely need to grow, and carve them all out of one scratch block.
+ *	  The virtual collection and default report always exist.
+*/
+	collectionsCapacity = 2 + ptDescriptor->descriptorLength / 32;
+	reportItemsCapacity = 1 + ptDescriptor->descriptorLength / 8;
+	reportsCapacity = 4 + ptDescriptor->descriptorLength / 64;
+	usageItemsCapacity = 1 + ptDescriptor->descriptorLength / 4;
+	stringItemsCapacity = 4;
+	desigItemsCapacity = 4;
+	collectionStackCapacity = 8;
+	globalsStackCapacity = 4;
+
+	tScratch.size = HIDAlign(sizeof(HIDCollection) * collectionsCapacity, kHIDItemAlignment)
+				  + HIDAlign(sizeof(HIDReportItem) * reportItemsCapacity, kHIDItemAlignment)
+				  + HIDAlign(sizeof(HIDReportSizes) * reportsCapacity, kHIDItemAlignment)
+				  + HIDAlign(sizeof(HIDP_UsageItem) * usageItemsCapacity, kHIDItemAlignment)
+				  + HIDAlign(sizeof(HIDStringItem) * stringItemsCapacity, kHIDItemAlignment)
+				  + HIDAlign(sizeof(HIDDesignatorItem) * desigItemsCapacity, kHIDItemAlignment)
+				  + HIDAlign(sizeof(SInt32) * collectionStackCapacity, kHIDItemAlignment)
+				  + HIDAlign(sizeof(HIDGlobalItems) * globalsStackCapacity, kHIDItemAlignment);
+	tScratch.base = PoolAllocateResident(tScratch.size, kShouldClearMem);
+	if (tScratch.base == NULL)
+		return kHIDNotEnoughMemoryErr;
+
+	collections = HIDArenaAllocate(&tScratch, sizeof(HIDCollection) * collectionsCapacity, kHIDItemAlignment);
+	reportItems = HIDArenaAllocate(&tScratch, sizeof(HIDReportItem) * reportItemsCapacity, kHIDItemAlignment);
+	reports = HIDArenaAllocate(&tScratch, sizeof(HIDReportSizes) * reportsCapacity, kHIDItemAlignment);
+	usageItems = HIDArenaAllocate(&tScratch, sizeof(HIDP_UsageItem) * usageItemsCapacity, kHIDItemAlignment);
+	stringItems = HIDArenaAllocate(&tScratch, sizeof(HIDStringItem) * stringItemsCapacity, kHIDItemAlignment);
+	desigItems = HIDArenaAllocate(&tScratch, sizeof(HIDDesignatorItem) * desigItemsCapacity, kHIDItemAlignment);
+	collectionStack = HIDArenaAllocate(&tScratch, sizeof(SInt32) * collectionStackCapacity, kHIDItemAlignment);
+	globalsStack = HIDArenaAllocate(&tScratch, sizeof(HIDGlobalItems) * globalsStackCapacity, kHIDItemAlignment);
+
+	ptPreparsedData->collections = collections;
+	ptPreparsedData->reports = reports;
+	HIDInitParseState(ptDescriptor, ptPreparsedData);
+/*
+ *	Count and parse each item.  Counting makes sure the arrays have room
+ *	  for anything the item can add before it is parsed.  Once parsing
+ *	  fails keep counting, since the count errors take precedence.
 */
 	while ((iStatus = HIDNextItem(ptDescriptor)) == kHIDSuccess)
 	{
 		switch (ptItem->itemType)
 		{
 			case kHIDTypeMain:
-				iStatus = HIDProcessMainItem(ptDescriptor,ptPreparsedData);
+				switch (ptItem->tag)
+				{
+					case kHIDTagCollection:
+						collectionCount++;
+						collectionNesting++;
+						if (collectionNesting > iMaxCollectionNesting)
+							iMaxCollectionNesting = collectionNesting;
+						iStatus = HIDEnsureCapacity(collections, HIDCollection, collectionCount, collectionsCapacity);
+						if (iStatus == kHIDSuccess)
+							iStatus = HIDEnsureCapacity(collectionStack, SInt32, iMaxCollectionNesting, collectionStackCapacity);
+						break;
+					case kHIDTagEndCollection:
+						if (collectionNesting-- == 0)
+							iStatus = kHIDInvalidPreparsedDataErr;
+						break;
+					case kHIDTagInput:
+					case kHIDTagOutput:
+					case kHIDTagFeature:
+						reportItemCount++;
+						iStatus = HIDEnsureCapacity(reportItems, HIDReportItem, reportItemCount, reportItemsCapacity);
+						break;
+				}
 				break;
 			case kHIDTypeGlobal:
-				iStatus = HIDProcessGlobalItem(ptDescriptor,ptPreparsedData);
+				switch (ptItem->tag)
+				{
+					case kHIDTagReportID:
+						reportCount++;
+						iStatus = HIDEnsureCapacity(reports, HIDReportSizes, reportCount, reportsCapacity);
+						break;
+					case kHIDTagPush:
+						globalsNesting++;
+						if (globalsNesting > iMaxGlobalsNesting)
+							iMaxGlobalsNesting = globalsNesting;
+						iStatus = HIDEnsureCapacity(globalsStack, HIDGlobalItems, iMaxGlobalsNesting, globalsStackCapacity);
+						break;
+					case kHIDTagPop:
+						globalsNesting--;
+						if (globalsNesting < 0)
+							iStatus = kHIDInvalidPreparsedDataErr;
+						break;
+				}
 				break;
 			case kHIDTypeLocal:
-				iStatus = HIDProcessLocalItem(ptDescriptor,ptPreparsedData);
+				switch (ptItem->tag)
+				{
+					case kHIDTagUsage:
+						iUsages++;
+						break;
+					case kHIDTagUsageMinimum:
+					case kHIDTagUsageMaximum:
+						iUsageRanges++;
+						break;
+					case kHIDTagStringIndex:
+						iStrings++;
+						break;
+					case kHIDTagStringMinimum:
+					case kHIDTagStringMaximum:
+						iStringRanges++;
+						break;
+					case kHIDTagDesignatorIndex:
+						iDesigs++;
+						break;
+					case kHIDTagDesignatorMinimum:
+					case kHIDTagDesignatorMaximum:
+						iDesigRanges++;
+						break;
+				}
+				iStatus = HIDEnsureCapacity(usageItems, HIDP_UsageItem, iUsages + iUsageRanges, usageItemsCapacity);
+				if (iStatus == kHIDSuccess)
+					iStatus = HIDEnsureCapacity(stringItems, HIDStringItem, iStrings + iStringRanges, stringItemsCapacity);
+				if (iStatus == kHIDSuccess)
+					iStatus = HIDEnsureCapacity(desigItems, HIDDesignatorItem, iDesigs + iDesigRanges, desigItemsCapacity);
 				break;
 		}
 		if (iStatus != kHIDSuccess)
-			return iStatus;
+			goto cleanup;
+/*
+ *		The arrays may have moved, so point the structures at them again
+*/
+		if (iParseStatus == kHIDSuccess)
+		{
+			ptPreparsedData->collections = collections;
+			ptPreparsedData->reportItems = reportItems;
+			ptPreparsedData->reports = reports;
+			ptPreparsedData->usageItems = usageItems;
+			ptPreparsedData->stringItems = stringItems;
+			ptPreparsedData->desigItems = desigItems;
+			ptDescriptor->collectionStack = collectionStack;
+			ptDescriptor->globalsStack = globalsStack;
+
+			iParseStatus = HIDProcessItem(ptDescriptor,ptPreparsedData);
+		}
 	}
-	if (iStatus == kHIDEndOfDescriptorErr)
-		iStatus = kHIDSuccess;
+/*
+ *	Disallow malformed descriptors
+*/
+	if ((collectionNesting != 0)
+	 || (collectionCount == 1)
+	 || (reportItemCount == 0)
+	 || ((iUsageRanges & 1) == 1)
+	 || ((iStringRanges & 1) == 1)
+	 || ((iDesigRanges & 1) == 1))
+	{
+		iStatus = kHIDInvalidPreparsedDataErr;
+		goto cleanup;
+	}
+	if (iStatus != kHIDEndOfDescriptorErr)
+		goto cleanup;
+	iStatus = iParseStatus;
+	if (iStatus != kHIDSuccess)
+		goto cleanup;
 /*
  *	Update the virtual collection
 */
-	ptCollection = ptPreparsedData->collections;
-	ptCollection->reportItemCount = ptPreparsedData->reportItemCount;
+	collections->reportItemCount = ptPreparsedData->reportItemCount;
 /*
- *	Mark the PreparsedData initialized
+ *	Calculate the space needed for the arena.  The PreParsedData Structure
+ *	  comes first, and the collections and report items, which are walked
+ *	  for every report, start on their own cache lines.
+*/
+	iSpaceRequired = HIDAlign(sizeof(HIDPreparsedData), kHIDCacheLineSize)
+				   + HIDAlign(sizeof(HIDCollection) * ptPreparsedData->collectionCount, kHIDCacheLineSize)
+				   + HIDAlign(sizeof(HIDReportItem) * ptPreparsedData->reportItemCount, kHIDItemAlignment)
+				   + HIDAlign(sizeof(HIDReportSizes) * ptPreparsedData->reportCount, kHIDItemAlignment)
+				   + HIDAlign(sizeof(HIDP_UsageItem) * ptPreparsedData->usageItemCount, kHIDItemAlignment)
+				   + HIDAlign(sizeof(HIDStringItem) * ptPreparsedData->stringItemCount, kHIDItemAlignment)
+				   + HIDAlign(sizeof(HIDDesignatorItem) * ptPreparsedData->desigItemCount, kHIDItemAlignment);
+	iUsageIndexCount = HIDBuildUsageIndex(ptPreparsedData, NULL, NULL, &iWideItemCount);
+	iSpaceRequired += HIDAlign(sizeof(HIDUsageIndexEntry) * iUsageIndexCount, kHIDItemAlignment)
+					+ HIDAlign(sizeof(UInt32) * iWideItemCount, kHIDItemAlignment);
+	iSpaceRequired = HIDAlign(iSpaceRequired, kHIDCacheLineSize);
+
+	tArena.base = PoolAllocateAligned(iSpaceRequired, kHIDCacheLineSize, kShouldClearMem);
+	if (tArena.base == NULL)
+	{
+		iStatus = kHIDNotEnoughMemoryErr;
+		goto cleanup;
+	}
+	tArena.size = iSpaceRequired;
+/*
+ *	Pack the structures into the arena
+*/
+	ptArenaData = HIDArenaAllocate(&tArena, sizeof(HIDPreparsedData), kHIDCacheLineSize);
+	*ptArenaData = tPreparsedData;
+	ptArenaData->collections = HIDArenaAllocate(&tArena, sizeof(HIDCollection) * ptPreparsedData->collectionCount, kHIDCacheLineSize);
+	ptArenaData->rawMemPtr = (UInt8 *) ptArenaData->collections;
+	ptArenaData->reportItems = HIDArenaAllocate(&tArena, sizeof(HIDReportItem) * ptPreparsedData->reportItemCount, kHIDCacheLineSize);
+	ptArenaData->reports = HIDArenaAllocate(&tArena, sizeof(HIDReportSizes) * ptPreparsedData->reportCount, kHIDItemAlignment);
+	ptArenaData->usageItems = HIDArenaAllocate(&tArena, sizeof(HIDP_UsageItem) * ptPreparsedData->usageItemCount, kHIDItemAlignment);
+	ptArenaData->stringItems = HIDArenaAllocate(&tArena, sizeof(HIDStringItem) * ptPreparsedData->stringItemCount, kHIDItemAlignment);
+	ptArenaData->desigItems = HIDArenaAllocate(&tArena, sizeof(HIDDesignatorItem) * ptPreparsedData->desigItemCount, kHIDItemAlignment);
+	ptArenaData->numBytesAllocated = iSpaceRequired - (ptArenaData->rawMemPtr - tArena.base);
+	ptArenaData->arenaSize = iSpaceRequired;
+
+	memcpy(ptArenaData->collections, collections, sizeof(HIDCollection) * ptPreparsedData->collectionCount);
+	memcpy(ptArenaData->reportItems, reportItems, sizeof(HIDReportItem) * ptPreparsedData->reportItemCount);
+	memcpy(ptArenaData->reports, reports, sizeof(HIDReportSizes) * ptPreparsedData->reportCount);
+	memcpy(ptArenaData->usageItems, usageItems, sizeof(HIDP_UsageItem) * ptPreparsedData->usageItemCount);
+	memcpy(ptArenaData->stringItems, stringItems, sizeof(HIDStringItem) * ptPreparsedData->stringItemCount);
+	memcpy(ptArenaData->desigItems, desigItems, sizeof(HIDDesignatorItem) * ptPreparsedData->desigItemCount);
+/*
+ *	Index the report items by usage, for the usage value calls.  Every
+ *	  parse array has been copied out by now, so the scratch block is free
+ *	  for the sort to use.
 */
+	ptArenaData->usageIndex = HIDArenaAllocate(&tArena, sizeof(HIDUsageIndexEntry) * iUsageIndexCount, kHIDItemAlignment);
+	ptArenaData->wideItems = HIDArenaAllocate(&tArena, sizeof(UInt32) * iWideItemCount, kHIDItemAlignment);
+	ptArenaData->usageIndexCount = HIDBuildUsageIndex(ptArenaData, ptArenaData->usageIndex,
+													  ptArenaData->wideItems, &ptArenaData->wideItemCount);
+	HIDSortUsageIndex(ptArenaData->usageIndex, ptArenaData->usageIndexCount, tScratch.base, tScratch.size);
+
+	ptDescriptor->collectionStack = NULL;
+	ptDescriptor->globalsStack = NULL;
+	*ptPreparsedDataRef = ptArenaData;
+
+cleanup:
+	HIDReleaseArray(collections, HIDCollection, collectionsCapacity);
+	HIDReleaseArray(reportItems, HIDReportItem, reportItemsCapacity);
+	HIDReleaseArray(reports, HIDReportSizes, reportsCapacity);
+	HIDReleaseArray(usageItems, HIDP_UsageItem, usageItemsCapacity);
+	HIDReleaseArray(stringItems, HIDStringItem, stringItemsCapacity);
+	HIDReleaseArray(desigItems, HIDDesignatorItem, desigItemsCapacity);
+	HIDReleaseArray(collectionStack, SInt32, collectionStackCapacity);
+	HIDReleaseArray(globalsStack, HIDGlobalItems, globalsStackCapacity);
+	PoolDeallocate(tScratch.base, tScratch.size);
+
 	return iStatus;
 }
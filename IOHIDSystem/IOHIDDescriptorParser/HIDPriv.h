@@ -298,6 +298,13 @@ struct HIDStringItem
 typedef struct HIDStringItem HIDStringItem;
 typedef HIDStringItem HIDDesignatorItem;
 
+struct HIDUsageIndexEntry
+{
+	HIDUsage	usage;
+	UInt32		reportItem;
+};
+typedef struct HIDUsageIndexEntry HIDUsageIndexEntry;
+
 struct HIDPreparsedData
 {
 	UInt32				hidTypeIfValid;
@@ -316,10 +323,32 @@ struct HIDPreparsedData
 	UInt8 *				rawMemPtr;
 	UInt32				flags;
 	IOByteCount			numBytesAllocated;
+	IOByteCount			arenaSize;		// non-zero if this structure and its
+										// arrays share a single allocation
+	HIDUsageIndexEntry *usageIndex;		// report items by usage, sorted by
+	UInt32				usageIndexCount;// usage then report item, or NULL
+	UInt32 *			wideItems;		// report items with usage ranges
+	UInt32				wideItemCount;	// too large for the usage index
 };
 typedef struct HIDPreparsedData HIDPreparsedData;
 typedef HIDPreparsedData * HIDPreparsedDataPtr;
 
+/*
+ *	State for walking the report items of a collection that may have a usage
+*/
+struct HIDUsageSearch
+{
+	HIDUsage			usage;
+	UInt32				firstReportItem;
+	UInt32				endReportItem;
+	UInt32				nextReportItem;
+	UInt32				nextEntry;
+	UInt32				nextWideItem;
+	SInt32				lastReportItem;
+	Boolean				indexed;
+};
+typedef struct HIDUsageSearch HIDUsageSearch;
+
 extern 
 OSStatus
 HIDCheckReport			   (HIDReportType 			reportType,
@@ -357,6 +386,19 @@ HIDHasUsage				   (HIDPreparsedDataRef		preparsedDataRef,
 							UInt32 *				usageIndex,
 							UInt32 *				count);
 
+extern 
+void
+HIDBeginUsageSearch		   (HIDPreparsedDataRef		preparsedDataRef,
+							HIDCollection *			collection,
+							HIDUsage				usage,
+							HIDUsageSearch *		search);
+
+extern 
+Boolean
+HIDNextUsageSearchItem	   (HIDPreparsedDataRef		preparsedDataRef,
+							HIDUsageSearch *		search,
+							int *					reportItemIndex);
+
 extern 
 Boolean
 HIDIsButton				   (HIDReportItem *			reportItem,
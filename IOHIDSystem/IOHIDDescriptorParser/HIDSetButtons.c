@@ -86,7 +86,8 @@ OSStatus HIDSetButton  (HIDReportType 			reportType,
 	HIDCollection *ptCollection;
 	HIDReportItem *ptReportItem;
 	OSStatus iStatus;
-	int iR, iX;
+	int iX;
+	HIDUsageSearch tSearch;
 	SInt32 data;
 	int iStart;
 	int iReportItem;
@@ -112,9 +113,9 @@ OSStatus HIDSetButton  (HIDReportType 			reportType,
  *	Filter on ReportType and usagePage
 */
 	ptCollection = &ptPreparsedData->collections[collection];
-	for (iR=0; iR<ptCollection->reportItemCount; iR++)
+	HIDBeginUsageSearch(preparsedDataRef, ptCollection, usage, &tSearch);
+	while (HIDNextUsageSearchItem(preparsedDataRef, &tSearch, &iReportItem))
 	{
-		iReportItem = ptCollection->firstReportItem + iR;
 		ptReportItem = &ptPreparsedData->reportItems[iReportItem];
 		if (HIDIsButton(ptReportItem, preparsedDataRef)
 		 && HIDHasUsage(preparsedDataRef,ptReportItem,usagePage,usage,&iUsageIndex,NULL))
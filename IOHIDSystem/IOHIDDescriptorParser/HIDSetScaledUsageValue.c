@@ -90,7 +90,7 @@ OSStatus HIDSetScaledUsageValue(HIDReportType reportType,
 	HIDCollection *ptCollection;
 	HIDReportItem *ptReportItem;
 	OSStatus iStatus;
-	int iR;
+	HIDUsageSearch tSearch;
 	SInt32 data;
 	int iStart;
 	int iReportItem;
@@ -115,9 +115,9 @@ OSStatus HIDSetScaledUsageValue(HIDReportType reportType,
  *	Filter on ReportType and usagePage
 */
 	ptCollection = &ptPreparsedData->collections[iCollection];
-	for (iR=0; iR<ptCollection->reportItemCount; iR++)
+	HIDBeginUsageSearch(preparsedDataRef, ptCollection, usage, &tSearch);
+	while (HIDNextUsageSearchItem(preparsedDataRef, &tSearch, &iReportItem))
 	{
-		iReportItem = ptCollection->firstReportItem + iR;
 		ptReportItem = &ptPreparsedData->reportItems[iReportItem];
 		if ((ptReportItem->reportType == reportType)
 		 && HIDIsVariable(ptReportItem, preparsedDataRef)
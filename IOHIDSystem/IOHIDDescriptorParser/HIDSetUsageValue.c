@@ -90,7 +90,7 @@ OSStatus HIDSetUsageValue(HIDReportType reportType,
 	HIDCollection *ptCollection;
 	HIDReportItem *ptReportItem;
 	OSStatus iStatus;
-	int iR;
+	HIDUsageSearch tSearch;
 	int iStart;
 	int iReportItem;
 	UInt32 iUsageIndex;
@@ -114,9 +114,9 @@ OSStatus HIDSetUsageValue(HIDReportType reportType,
  *	Filter on ReportType and usagePage
 */
 	ptCollection = &ptPreparsedData->collections[iCollection];
-	for (iR=0; iR<ptCollection->reportItemCount; iR++)
+	HIDBeginUsageSearch(preparsedDataRef, ptCollection, usage, &tSearch);
+	while (HIDNextUsageSearchItem(preparsedDataRef, &tSearch, &iReportItem))
 	{
-		iReportItem = ptCollection->firstReportItem + iR;
 		ptReportItem = &ptPreparsedData->reportItems[iReportItem];
 		if (HIDIsVariable(ptReportItem, preparsedDataRef)
 		 && HIDHasUsage(preparsedDataRef,ptReportItem,usagePage,usage,&iUsageIndex,NULL))
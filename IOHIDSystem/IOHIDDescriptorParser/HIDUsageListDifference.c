@@ -47,6 +47,7 @@
 */
 
 #include "HIDLib.h"
+#include <string.h>
 
 /*
  *------------------------------------------------------------------------------
@@ -71,6 +72,34 @@ static Boolean IsUsageInUsageList(HIDUsage *piUsageList, UInt32 iUsageListLength
 	return false;
 }
 
+/*
+ *	Usages below this are tracked in bitmaps on the stack, which covers the
+ *	  keyboard and button pages.  Larger usages are looked up in the lists.
+*/
+#define kHIDUsageListBitmapSize		256
+
+/*
+ *------------------------------------------------------------------------------
+ *
+ * IsUsageInUsageBitmap - Is a usage in a UsageList, using its bitmap?
+ *
+ *	 Input:
+ *			  piUsageBitmap			- Bitmap of the small usages in the list
+ *			  piUsageList			- usage List
+ *			  iUsageListLength		- Max entries in usage Lists
+ *			  usage				   - The usage
+ *	 Output:
+ *	 Returns: true or false
+ *
+ *------------------------------------------------------------------------------
+*/
+static inline Boolean IsUsageInUsageBitmap(UInt32 *piUsageBitmap, HIDUsage *piUsageList, UInt32 iUsageListLength, HIDUsage usage)
+{
+	if (usage < kHIDUsageListBitmapSize)
+		return HIDTestUsageBit(piUsageBitmap, usage);
+	return IsUsageInUsageList(piUsageList, iUsageListLength, usage);
+}
+
 /*
  *------------------------------------------------------------------------------
  *
@@ -87,30 +116,57 @@ static Boolean IsUsageInUsageList(HIDUsage *piUsageList, UInt32 iUsageListLength
  *			  piMakeUL				- Make usage List
  *	 Returns:
  *
+ *	The lists are walked in the same order as always, so the makes and
+ *	  breaks come out in the order they first appear, without duplicates.
+ *
  *------------------------------------------------------------------------------
 */
 OSStatus HIDUsageListDifference(HIDUsage *piPreviousUL, HIDUsage *piCurrentUL, HIDUsage *piBreakUL, HIDUsage *piMakeUL, UInt32 iUsageListLength)
 {
+	UInt32 previousBitmap[HIDUsageBitmapWords(kHIDUsageListBitmapSize)];
+	UInt32 currentBitmap[HIDUsageBitmapWords(kHIDUsageListBitmapSize)];
+	UInt32 breakBitmap[HIDUsageBitmapWords(kHIDUsageListBitmapSize)];
+	UInt32 makeBitmap[HIDUsageBitmapWords(kHIDUsageListBitmapSize)];
 	int i;
 	HIDUsage usage;
 	int iBreakLength=0;
 	int iMakeLength=0;
+
+	memset(previousBitmap, 0, sizeof(previousBitmap));
+	memset(currentBitmap, 0, sizeof(currentBitmap));
+	memset(breakBitmap, 0, sizeof(breakBitmap));
+	memset(makeBitmap, 0, sizeof(makeBitmap));
+	for (i = 0; i < iUsageListLength; i++)
+	{
+		if (piPreviousUL[i] < kHIDUsageListBitmapSize)
+			HIDSetUsageBit(previousBitmap, piPreviousUL[i]);
+		if (piCurrentUL[i] < kHIDUsageListBitmapSize)
+			HIDSetUsageBit(currentBitmap, piCurrentUL[i]);
+	}
 	for (i = 0; i < iUsageListLength; i++)
 	{
 /*
  *		If in Current but not Previous then it's a Make
 */
 		usage = piCurrentUL[i];
-		if ((usage != 0) && (!IsUsageInUsageList(piPreviousUL,iUsageListLength,usage))
-						  && (!IsUsageInUsageList(piMakeUL,iMakeLength,usage)))
+		if ((usage != 0) && (!IsUsageInUsageBitmap(previousBitmap,piPreviousUL,iUsageListLength,usage))
+						  && (!IsUsageInUsageBitmap(makeBitmap,piMakeUL,iMakeLength,usage)))
+		{
+			if (usage < kHIDUsageListBitmapSize)
+				HIDSetUsageBit(makeBitmap, usage);
 			piMakeUL[iMakeLength++] = usage;
+		}
 /*
  *		If in Previous but not Current then it's a Break
 */
 		usage = piPreviousUL[i];
-		if ((usage != 0) && (!IsUsageInUsageList(piCurrentUL,iUsageListLength,usage))
-						  && (!IsUsageInUsageList(piBreakUL,iBreakLength,usage)))
+		if ((usage != 0) && (!IsUsageInUsageBitmap(currentBitmap,piCurrentUL,iUsageListLength,usage))
+						  && (!IsUsageInUsageBitmap(breakBitmap,piBreakUL,iBreakLength,usage)))
+		{
+			if (usage < kHIDUsageListBitmapSize)
+				HIDSetUsageBit(breakBitmap, usage);
 			piBreakUL[iBreakLength++] = usage;
+		}
 	}
 /*
  *	Clear the rest of the usage Lists
@@ -121,3 +177,45 @@ OSStatus HIDUsageListDifference(HIDUsage *piPreviousUL, HIDUsage *piCurrentUL, H
 		piBreakUL[iBreakLength++] = 0;
 	return kHIDSuccess;
 }
+
+/*
+ *------------------------------------------------------------------------------
+ *
+ * HIDUsageBitmapDifference - Return adds and drops given present and past
+ *
+ *	 Input:
+ *			  piPreviousBitmap		- Previous usage Bitmap
+ *			  piCurrentBitmap		- Current usage Bitmap
+ *			  piBreakBitmap			- Break usage Bitmap
+ *			  piMakeBitmap			- Make usage Bitmap
+ *			  iUsageBitmapSize		- Number of usages in the Bitmaps
+ *	 Output:
+ *			  piBreakBitmap			- Break usage Bitmap
+ *			  piMakeBitmap			- Make usage Bitmap
+ *	 Returns:
+ *
+ *------------------------------------------------------------------------------
+*/
+OSStatus HIDUsageBitmapDifference(UInt32 *piPreviousBitmap, UInt32 *piCurrentBitmap, UInt32 *piBreakBitmap, UInt32 *piMakeBitmap, UInt32 iUsageBitmapSize)
+{
+	UInt32 iChanged;
+	UInt32 i;
+
+	if ((piPreviousBitmap == NULL)
+	 || (piCurrentBitmap == NULL)
+	 || (piBreakBitmap == NULL)
+	 || (piMakeBitmap == NULL))
+		return kHIDNullPointerErr;
+/*
+ *	Usage zero is never a make or a break
+*/
+	for (i = 0; i < HIDUsageBitmapWords(iUsageBitmapSize); i++)
+	{
+		iChanged = piPreviousBitmap[i] ^ piCurrentBitmap[i];
+		if (i == 0)
+			iChanged &= ~1U;
+		piMakeBitmap[i] = iChanged & piCurrentBitmap[i];
+		piBreakBitmap[i] = iChanged & piPreviousBitmap[i];
+	}
+	return kHIDSuccess;
+}
@@ -41,3 +41,20 @@ __private_extern__ OSStatus PoolDeallocate (void *ptr, vm_size_t size)
 	IOFree(ptr, size);
 	return 0;
 }
+
+__private_extern__ void *PoolAllocateAligned (vm_size_t size, vm_size_t alignment, unsigned char clear)
+{
+	void *mem = IOMallocAligned(size, alignment);
+
+	if ((mem != NULL) && clear) {
+		bzero(mem, size);
+	}
+
+	return mem;
+}
+
+__private_extern__ OSStatus PoolDeallocateAligned (void *ptr, vm_size_t size)
+{
+	IOFreeAligned(ptr, size);
+	return 0;
+}
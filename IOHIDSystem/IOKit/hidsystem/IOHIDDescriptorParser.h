@@ -395,6 +395,31 @@ extern
 OSStatus
 HIDCloseReportDescriptor   (HIDPreparsedDataRef		preparsedDataRef);
 
+/*!
+  @function HIDCopyPreparsedData
+  @abstract Makes an independent copy of preparsed data returned by the HIDOpenReportDescriptor function.
+  @discussion The copy does not share any memory with the original and must be released with the HIDCloseReportDescriptor function.  This lets a client keep the parsed form of a report descriptor and hand out copies of it without parsing the descriptor again.
+  @param preparsedDataRef Preparsed data reference for the report that is returned by the HIDOpenReportDescriptor function
+  @param copyRef On return, a preparsed data reference for the copy
+  @result OSStatus Returns an error code if an error was encountered or noErr on success.
+ */
+
+extern 
+OSStatus
+HIDCopyPreparsedData	   (HIDPreparsedDataRef		preparsedDataRef,
+							HIDPreparsedDataRef *	copyRef);
+
+/*!
+  @function HIDGetPreparsedDataSize
+  @abstract Returns the number of bytes of memory held by preparsed data.
+  @param preparsedDataRef Preparsed data reference for the report that is returned by the HIDOpenReportDescriptor function
+  @result IOByteCount Returns the size of the preparsed data, or 0 if the reference is invalid.
+ */
+
+extern 
+IOByteCount
+HIDGetPreparsedDataSize	   (HIDPreparsedDataRef		preparsedDataRef);
+
 /*!
   @function HIDGetButtonCaps
   @abstract Returns the button capabilities structures for a HID device based on the given preparsed data.
@@ -497,6 +522,34 @@ HIDGetScaledUsageValue	   (HIDReportType			reportType,
 							void *					report,
 							IOByteCount				reportLength);
 
+/*!
+  @function HIDGetScaledUsageValues
+  @abstract The HIDGetScaledUsageValues function returns several scaled values from a device data report in one call.
+  @discussion The HIDGetScaledUsageValues function walks the report items of the collection once and fills in a value for each usage in usageList.  The value and status stored for each usage are the ones HIDGetScaledUsageValue would return for it.  Usages that are not found leave their value unchanged.
+  @param reportType Specifies the type of report, provided in report, from which to retrieve the scaled values.  This parameter must be one of the following: kHIDInputReport, kHIDOutputReport, or kHIDFeatureReport.
+  @param collection Optionally specifies the link collection identifier of the scaled values to be retrieved.
+  @param usageList Points to the usage pages and usages of the scaled values to retrieve.  A usage page of zero matches any page.
+  @param usageListSize Specifies the number of entries in usageList.
+  @param usageValues Points to a caller-allocated array of usageListSize entries, that on return from this routine holds the scaled values retrieved from the device report.
+  @param usageStatus Points to a caller-allocated array of usageListSize entries, that on return from this routine holds the status of each value.
+  @param preparsedDataRef Preparsed data reference for the report that is retuned by the HIDOpenReportDescriptor function
+  @param report Points to the caller-allocated buffer that contains the device report data.
+  @param reportLength Specifies the size, in bytes, of the report data provided in the report parameter.
+  @result OSStatus Returns noErr if every value was retrieved, otherwise the status of the first value that was not.
+ */
+
+extern 
+OSStatus
+HIDGetScaledUsageValues	   (HIDReportType			reportType,
+							UInt32					collection,
+							HIDUsageAndPage *		usageList,
+							UInt32					usageListSize,
+							SInt32 *				usageValues,
+							OSStatus *				usageStatus,
+							HIDPreparsedDataRef		preparsedDataRef,
+							void *					report,
+							IOByteCount				reportLength);
+
 /*!
   @function HIDGetSpecificButtonCaps
   @abstract Retrieves the capabilities for all buttons in a specific type of report that meet the search criteria.
@@ -618,6 +671,32 @@ HIDGetButtonsOnPage		   (HIDReportType			reportType,
 							void *					report,
 							IOByteCount				reportLength);
 
+/*!
+  @function HIDGetButtonsBitmap
+  @abstract Retrieves the button state information for buttons on a specified usage page as a bitmap.
+  @discussion The HIDGetButtonsBitmap function finds the same buttons as the HIDGetButtonsOnPage function, but sets the bit for each button's usage in a bitmap instead of adding the usage to a list.  Bit n of the bitmap is bit (n % 32) of word (n / 32).  Two bitmaps can be compared with the HIDUsageBitmapDifference function.
+  @param reportType Specifies the type of report, provided in the report parameter, from which to retrieve the buttons.  This parameter must be one of the following: kHIDInputReport, kHIDOutputReport or kHIDFeatureReport.
+  @param usagePage Specifies the usage page of the buttons for which to retrieve the current state.
+  @param collection Optionally specifies the link collection identifier used to retrieve only specific button states.  If this value is non-zero, only the buttons that are part of the given collection are returned.
+  @param usageBitmap On return, points to a caller-allocated buffer of (usageBitmapSize + 31) / 32 words that has a bit set for each button that is pressed and belongs to the usage page specified in the usagePage parameter.
+  @param usageBitmapSize Specifies the number of usages the buffer provided in the usageBitmap parameter can hold.  If a pressed button's usage does not fit, kHIDBufferTooSmallErr is returned.
+  @param preparsedDataRef Preparsed data reference for the report that is retuned by the HIDOpenReportDescriptor function
+  @param report Points to the caller-allocated buffer that contains the device report data
+  @param reportLength Specifies the size, in bytes, of the report data provided in the report parameter
+  @result OSStatus Returns an error code if an error was encountered or noErr on success.
+ */
+
+extern 
+OSStatus
+HIDGetButtonsBitmap		   (HIDReportType			reportType,
+							HIDUsage				usagePage,
+							UInt32					collection,
+							UInt32 *				usageBitmap,
+							UInt32					usageBitmapSize,
+							HIDPreparsedDataRef		preparsedDataRef,
+							void *					report,
+							IOByteCount				reportLength);
+
 /*!
   @function HIDGetButtons
   @abstract The HIDGetButtons function takes a report from a HID device and gets the current state of the buttons in that report.
@@ -720,6 +799,34 @@ HIDGetUsageValueArray	   (HIDReportType			reportType,
 							void *					report,
 							IOByteCount				reportLength);
 
+/*!
+  @function HIDGetUsageValues
+  @abstract The HIDGetUsageValues function returns several values from a device data report in one call.
+  @discussion The HIDGetUsageValues function walks the report items of the collection once and fills in a value for each usage in usageList.  The value and status stored for each usage are the ones HIDGetUsageValue would return for it.  Usages that are not found leave their value unchanged.
+  @param reportType Specifies the type of report, provided in report, from which to retrieve the values.  This parameter must be one of the following: kHIDInputReport, kHIDOutputReport, or kHIDFeatureReport.
+  @param collection Optionally specifies the link collection identifier of the values to be retrieved.
+  @param usageList Points to the usage pages and usages of the values to retrieve.  A usage page of zero matches any page.
+  @param usageListSize Specifies the number of entries in usageList.
+  @param usageValues Points to a caller-allocated array of usageListSize entries, that on return from this routine holds the values retrieved from the device report.
+  @param usageStatus Points to a caller-allocated array of usageListSize entries, that on return from this routine holds the status of each value.
+  @param preparsedDataRef Preparsed data reference for the report that is retuned by the HIDOpenReportDescriptor function
+  @param report Points to the caller-allocated buffer that contains the device report data.
+  @param reportLength Specifies the size, in bytes, of the report data provided in the report parameter.
+  @result OSStatus Returns noErr if every value was retrieved, otherwise the status of the first value that was not.
+ */
+
+extern 
+OSStatus
+HIDGetUsageValues		   (HIDReportType			reportType,
+							UInt32					collection,
+							HIDUsageAndPage *		usageList,
+							UInt32					usageListSize,
+							SInt32 *				usageValues,
+							OSStatus *				usageStatus,
+							HIDPreparsedDataRef		preparsedDataRef,
+							void *					report,
+							IOByteCount				reportLength);
+
 /*!
   @function HIDGetValueCaps
   @abstract The HIDGetValueCaps function retrieves the capabilities for all values for a specified top level collection.
@@ -884,6 +991,26 @@ HIDSetUsageValueArray	   (HIDReportType			reportType,
 							void *					report,
 							IOByteCount				reportLength);
 
+/*!
+  @function HIDUsageBitmapDifference
+  @abstract The HIDUsageBitmapDifference function compares and provides the differences between two bitmaps of buttons.
+  @discussion The bitmaps are laid out as returned by the HIDGetButtonsBitmap function.  As with the HIDUsageListDifference function, usage zero is never reported as a make or a break.
+  @param previousUsageBitmap Points to the older button bitmap to be used for comparison.
+  @param currentUsageBitmap Points to the newer button bitmap to be used for comparison.
+  @param breakUsageBitmap On return, points to a caller-allocated bitmap that contains the buttons set in the older bitmap but not in the newer one.
+  @param makeUsageBitmap On return, points to a caller-allocated bitmap that contains the buttons set in the newer bitmap but not in the older one.
+  @param usageBitmapSize Specifies the number of usages each of the bitmaps holds.
+  @result OSStatus Returns an error code if an error was encountered or noErr on success.
+ */
+
+extern 
+OSStatus
+HIDUsageBitmapDifference   (UInt32 *				previousUsageBitmap,
+							UInt32 *				currentUsageBitmap,
+							UInt32 *				breakUsageBitmap,
+							UInt32 *				makeUsageBitmap,
+							UInt32					usageBitmapSize);
+
 /*!
   @function HIDUsageListDifference
   @abstract The HIDUsageListDifference function compares and provides the differences between two lists of buttons.
@@ -0,0 +1,299 @@
+/*
+ * Tests for HIDCopyPreparsedData, which the descriptor cache in IOHIDDevice
+ * uses on every hit.
+ *
+ * Each corpus descriptor, and a large composite one, is opened twice: once
+ * into an arena by HIDOpenReportDescriptor, and once into separately
+ * allocated raw memory by the original two pass parser.  Each is copied,
+ * and the copy copied again.  The sources are then overwritten with a
+ * pattern and closed, so a pointer in a copy that still refers to its
+ * source reads garbage.  Build with -fsanitize=address (the ASan variant of
+ * this test) to have such reads reported directly.
+ *
+ * Every copy must then answer caps, collection node, usage value, scaled
+ * usage value and button queries on random reports exactly as a fresh
+ * parse of the same descriptor does.
+ *
+ * usage: HIDCopyPreparsedDataTest [-n reports] [-s seed]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "HIDLib.h"
+#include "HIDDescriptorCorpus.h"
+
+#define kMaxCaps            256
+#define kMaxReportLength    512
+#define kMaxRangeUsages     64
+
+static unsigned long    gFailures   = 0;
+static unsigned long    gQueries    = 0;
+static uint64_t         gRandom     = 0x2545F4914F6CDD1DULL;
+
+static uint32_t NextRandom(void)
+{
+    gRandom ^= gRandom << 13;
+    gRandom ^= gRandom >> 7;
+    gRandom ^= gRandom << 17;
+    return (uint32_t) (gRandom >> 16);
+}
+
+static void Fail(const char * what, const char * name)
+{
+    gFailures++;
+    if ( gFailures <= 10 )
+        fprintf(stderr, "FAIL %s: %s\n", name, what);
+}
+
+/*
+ * The two walks HIDOpenReportDescriptor made before the arena, which leave
+ * the arrays in one block of raw memory apart from the structure.
+ */
+static OSStatus OpenTwoPass(const uint8_t * descriptor, size_t length, HIDPreparsedDataRef * result)
+{
+    HIDPreparsedDataPtr ptPreparsedData;
+    HIDReportDescriptor tDescriptor;
+    OSStatus            iStatus;
+
+    *result = NULL;
+
+    ptPreparsedData = PoolAllocateResident(sizeof(HIDPreparsedData), kShouldClearMem);
+    if ( ptPreparsedData == NULL )
+        return kHIDNotEnoughMemoryErr;
+
+    tDescriptor.descriptor = (UInt8 *) descriptor;
+    tDescriptor.descriptorLength = length;
+
+    iStatus = HIDCountDescriptorItems(&tDescriptor, ptPreparsedData);
+    if ( iStatus == kHIDSuccess )
+        iStatus = HIDParseDescriptor(&tDescriptor, ptPreparsedData);
+
+    if ( iStatus != kHIDSuccess ) {
+        if ( ptPreparsedData->rawMemPtr != NULL )
+            PoolDeallocate(ptPreparsedData->rawMemPtr, ptPreparsedData->numBytesAllocated);
+        PoolDeallocate(ptPreparsedData, sizeof(HIDPreparsedData));
+        return iStatus;
+    }
+
+    ptPreparsedData->hidTypeIfValid = kHIDOSType;
+    *result = (HIDPreparsedDataRef) ptPreparsedData;
+    return kHIDSuccess;
+}
+
+// Overwrites everything but the fields HIDCloseReportDescriptor needs, then
+// closes the parse.
+static void ScribbleAndClose(HIDPreparsedDataRef parseData)
+{
+    HIDPreparsedDataPtr data = (HIDPreparsedDataPtr) parseData;
+
+    if ( data->arenaSize )
+        memset((UInt8 *) data + sizeof(HIDPreparsedData), 0xA5, data->arenaSize - sizeof(HIDPreparsedData));
+    else
+        memset(data->rawMemPtr, 0xA5, data->numBytesAllocated);
+
+    HIDCloseReportDescriptor(parseData);
+}
+
+static void CompareCaps(HIDPreparsedDataRef copy, HIDPreparsedDataRef fresh, const char * name)
+{
+    static HIDValueCaps         copyValueCaps[kMaxCaps], freshValueCaps[kMaxCaps];
+    static HIDButtonCaps        copyButtonCaps[kMaxCaps], freshButtonCaps[kMaxCaps];
+    static HIDCollectionNode    copyNodes[kMaxCaps], freshNodes[kMaxCaps];
+    HIDCaps                     copyCaps, freshCaps;
+    UInt32                      copyCount, freshCount;
+    OSStatus                    copyStatus, freshStatus;
+    HIDReportType               reportType;
+
+    memset(&copyCaps, 0, sizeof(copyCaps));
+    memset(&freshCaps, 0, sizeof(freshCaps));
+    if ( HIDGetCaps(copy, &copyCaps) != HIDGetCaps(fresh, &freshCaps) || memcmp(&copyCaps, &freshCaps, sizeof(copyCaps)) != 0 )
+        Fail("HIDGetCaps", name);
+
+    memset(copyNodes, 0, sizeof(copyNodes));
+    memset(freshNodes, 0, sizeof(freshNodes));
+    copyCount = freshCount = kMaxCaps;
+    copyStatus = HIDGetCollectionNodes(copyNodes, &copyCount, copy);
+    freshStatus = HIDGetCollectionNodes(freshNodes, &freshCount, fresh);
+    if ( copyStatus != freshStatus || copyCount != freshCount || memcmp(copyNodes, freshNodes, sizeof(copyNodes)) != 0 )
+        Fail("HIDGetCollectionNodes", name);
+
+    for ( reportType = kHIDInputReport; reportType <= kHIDFeatureReport; reportType++ ) {
+        memset(copyValueCaps, 0, sizeof(copyValueCaps));
+        memset(freshValueCaps, 0, sizeof(freshValueCaps));
+        copyCount = freshCount = kMaxCaps;
+        copyStatus = HIDGetValueCaps(reportType, copyValueCaps, &copyCount, copy);
+        freshStatus = HIDGetValueCaps(reportType, freshValueCaps, &freshCount, fresh);
+        if ( copyStatus != freshStatus || copyCount != freshCount || memcmp(copyValueCaps, freshValueCaps, sizeof(copyValueCaps)) != 0 )
+            Fail("HIDGetValueCaps", name);
+
+        memset(copyButtonCaps, 0, sizeof(copyButtonCaps));
+        memset(freshButtonCaps, 0, sizeof(freshButtonCaps));
+        copyCount = freshCount = kMaxCaps;
+        copyStatus = HIDGetButtonCaps(reportType, copyButtonCaps, &copyCount, copy);
+        freshStatus = HIDGetButtonCaps(reportType, freshButtonCaps, &freshCount, fresh);
+        if ( copyStatus != freshStatus || copyCount != freshCount || memcmp(copyButtonCaps, freshButtonCaps, sizeof(copyButtonCaps)) != 0 )
+            Fail("HIDGetButtonCaps", name);
+    }
+}
+
+static void CompareValues(HIDReportType reportType, HIDUsage usagePage, HIDUsage usage, UInt8 * report,
+                          IOByteCount reportLength, HIDPreparsedDataRef copy, HIDPreparsedDataRef fresh, const char * name)
+{
+    SInt32      copyValue = 0, freshValue = 0;
+    OSStatus    copyStatus, freshStatus;
+
+    copyStatus = HIDGetUsageValue(reportType, usagePage, 0, usage, &copyValue, copy, report, reportLength);
+    freshStatus = HIDGetUsageValue(reportType, usagePage, 0, usage, &freshValue, fresh, report, reportLength);
+    if ( copyStatus != freshStatus || copyValue != freshValue )
+        Fail("HIDGetUsageValue", name);
+
+    copyValue = freshValue = 0;
+    copyStatus = HIDGetScaledUsageValue(reportType, usagePage, 0, usage, &copyValue, copy, report, reportLength);
+    freshStatus = HIDGetScaledUsageValue(reportType, usagePage, 0, usage, &freshValue, fresh, report, reportLength);
+    if ( copyStatus != freshStatus || copyValue != freshValue )
+        Fail("HIDGetScaledUsageValue", name);
+
+    gQueries++;
+}
+
+static void CompareReports(HIDPreparsedDataRef copy, HIDPreparsedDataRef fresh, unsigned long reports, const char * name)
+{
+    static HIDValueCaps     valueCaps[kMaxCaps];
+    static HIDUsageAndPage  copyButtons[kMaxCaps * 8], freshButtons[kMaxCaps * 8];
+    HIDReportType           reportType;
+    UInt8                   report[kMaxReportLength];
+    UInt32                  valueCapsCount;
+    UInt32                  i;
+
+    for ( reportType = kHIDInputReport; reportType <= kHIDFeatureReport; reportType++ ) {
+        valueCapsCount = kMaxCaps;
+        if ( HIDGetValueCaps(reportType, valueCaps, &valueCapsCount, fresh) != kHIDSuccess )
+            valueCapsCount = 0;
+
+        for ( UInt32 reportID = 0; reportID < 256; reportID++ ) {
+            IOByteCount reportLength;
+
+            if ( HIDGetReportLength(reportType, (UInt8) reportID, &reportLength, fresh) != kHIDSuccess
+              || reportLength == 0 || reportLength > kMaxReportLength )
+                continue;
+
+            for ( unsigned long n = 0; n < reports; n++ ) {
+                UInt32      copyLength, freshLength;
+                OSStatus    copyStatus, freshStatus;
+
+                for ( i = 0; i < reportLength; i++ )
+                    report[i] = (UInt8) NextRandom();
+                if ( reportID )
+                    report[0] = (UInt8) reportID;
+
+                for ( i = 0; i < valueCapsCount; i++ ) {
+                    const HIDValueCaps * caps = &valueCaps[i];
+
+                    if ( caps->reportID != reportID )
+                        continue;
+
+                    if ( caps->isRange ) {
+                        for ( HIDUsage usage = caps->u.range.usageMin; usage <= caps->u.range.usageMax && usage < caps->u.range.usageMin + kMaxRangeUsages; usage++ )
+                            CompareValues(reportType, caps->usagePage, usage, report, reportLength, copy, fresh, name);
+                    } else {
+                        CompareValues(reportType, caps->usagePage, caps->u.notRange.usage, report, reportLength, copy, fresh, name);
+                    }
+                }
+
+                // A usage nobody has
+                CompareValues(reportType, 0xFF7F, 0x7F7F, report, reportLength, copy, fresh, name);
+
+                memset(copyButtons, 0, sizeof(copyButtons));
+                memset(freshButtons, 0, sizeof(freshButtons));
+                copyLength = freshLength = kMaxCaps * 8;
+                copyStatus = HIDGetButtons(reportType, 0, copyButtons, &copyLength, copy, report, reportLength);
+                freshStatus = HIDGetButtons(reportType, 0, freshButtons, &freshLength, fresh, report, reportLength);
+                if ( copyStatus != freshStatus || copyLength != freshLength || memcmp(copyButtons, freshButtons, sizeof(copyButtons)) != 0 )
+                    Fail("HIDGetButtons", name);
+            }
+        }
+    }
+}
+
+typedef OSStatus (*OpenFunction)(const uint8_t * descriptor, size_t length, HIDPreparsedDataRef * result);
+
+static OSStatus OpenArena(const uint8_t * descriptor, size_t length, HIDPreparsedDataRef * result)
+{
+    return HIDOpenReportDescriptor((void *) descriptor, length, result, 0);
+}
+
+static void TestDescriptor(const char * name, const uint8_t * descriptor, size_t length, OpenFunction open, unsigned long reports)
+{
+    HIDPreparsedDataRef fresh, source, copy, copyOfCopy;
+    IOByteCount         size;
+
+    if ( HIDOpenReportDescriptor((void *) descriptor, length, &fresh, 0) != kHIDSuccess
+      || open(descriptor, length, &source) != kHIDSuccess ) {
+        Fail("cannot open", name);
+        return;
+    }
+
+    // A copy keeps the form of its source
+    size = HIDGetPreparsedDataSize(source);
+    if ( HIDCopyPreparsedData(source, &copy) != kHIDSuccess ) {
+        Fail("HIDCopyPreparsedData", name);
+        HIDCloseReportDescriptor(source);
+        HIDCloseReportDescriptor(fresh);
+        return;
+    }
+    ScribbleAndClose(source);
+
+    if ( HIDCopyPreparsedData(copy, &copyOfCopy) != kHIDSuccess ) {
+        Fail("HIDCopyPreparsedData of a copy", name);
+    } else {
+        ScribbleAndClose(copy);
+        copy = copyOfCopy;
+    }
+
+    if ( HIDGetPreparsedDataSize(copy) != size )
+        Fail("HIDGetPreparsedDataSize", name);
+
+    CompareCaps(copy, fresh, name);
+    CompareReports(copy, fresh, reports, name);
+
+    HIDCloseReportDescriptor(copy);
+    HIDCloseReportDescriptor(fresh);
+}
+
+int main(int argc, char ** argv)
+{
+    static uint8_t  large[8192];
+    unsigned long   reports = 16;
+    size_t          largeLength;
+    size_t          i;
+    int             option;
+
+    while ( (option = getopt(argc, argv, "n:s:")) != -1 ) {
+        switch ( option ) {
+            case 'n':
+                reports = strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                gRandom = strtoull(optarg, NULL, 0) | 1;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-n reports] [-s seed]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    for ( i = 0; i < kHIDCorpusCount; i++ ) {
+        TestDescriptor(kHIDCorpus[i].name, kHIDCorpus[i].bytes, kHIDCorpus[i].length, OpenArena, reports);
+        TestDescriptor(kHIDCorpus[i].name, kHIDCorpus[i].bytes, kHIDCorpus[i].length, OpenTwoPass, reports);
+    }
+
+    largeLength = HIDCorpusBuildLarge(large, sizeof(large), 40);
+    TestDescriptor("large", large, largeLength, OpenArena, reports);
+    TestDescriptor("large", large, largeLength, OpenTwoPass, reports);
+
+    printf("%lu usage queries, %lu failures\n", gQueries, gFailures);
+
+    return gFailures ? 1 : 0;
+}
@@ -0,0 +1,129 @@
+/*
+ * Report descriptors shared by the parser host tests and benchmarks.
+ *
+ * The fixed descriptors cover the item kinds real devices use: boot
+ * keyboard and mouse, a gamepad with push/pop and units, a multi-touch
+ * digitizer, a consumer page usage range, and a vendor collection with
+ * string, designator and delimiter items.  HIDCorpusBuildLarge expands
+ * into a multi-kilobyte composite descriptor with dozens of report IDs.
+ */
+#ifndef _HID_DESCRIPTOR_CORPUS_H
+#define _HID_DESCRIPTOR_CORPUS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef struct {
+    const char *    name;
+    const uint8_t * bytes;
+    size_t          length;
+} HIDCorpusDescriptor;
+
+static const uint8_t kHIDCorpusKeyboard[] = {
+    0x05, 0x01, 0x09, 0x06, 0xA1, 0x01, 0x05, 0x07, 0x19, 0xE0, 0x29, 0xE7,
+    0x15, 0x00, 0x25, 0x01, 0x75, 0x01, 0x95, 0x08, 0x81, 0x02, 0x95, 0x01,
+    0x75, 0x08, 0x81, 0x01, 0x95, 0x05, 0x75, 0x01, 0x05, 0x08, 0x19, 0x01,
+    0x29, 0x05, 0x91, 0x02, 0x95, 0x01, 0x75, 0x03, 0x91, 0x01, 0x95, 0x06,
+    0x75, 0x08, 0x15, 0x00, 0x25, 0x65, 0x05, 0x07, 0x19, 0x00, 0x29, 0x65,
+    0x81, 0x00, 0xC0,
+};
+
+static const uint8_t kHIDCorpusMouse[] = {
+    0x05, 0x01, 0x09, 0x02, 0xA1, 0x01, 0x09, 0x01, 0xA1, 0x00, 0x05, 0x09,
+    0x19, 0x01, 0x29, 0x03, 0x15, 0x00, 0x25, 0x01, 0x95, 0x03, 0x75, 0x01,
+    0x81, 0x02, 0x95, 0x01, 0x75, 0x05, 0x81, 0x01, 0x05, 0x01, 0x09, 0x30,
+    0x09, 0x31, 0x09, 0x38, 0x15, 0x81, 0x25, 0x7F, 0x75, 0x08, 0x95, 0x03,
+    0x81, 0x06, 0xC0, 0xC0,
+};
+
+static const uint8_t kHIDCorpusGamepad[] = {
+    0x05, 0x01, 0x09, 0x05, 0xA1, 0x01, 0x85, 0x01, 0x05, 0x09, 0x19, 0x01,
+    0x29, 0x10, 0x15, 0x00, 0x25, 0x01, 0x75, 0x01, 0x95, 0x10, 0x81, 0x02,
+    0x05, 0x01, 0x09, 0x39, 0x15, 0x00, 0x25, 0x07, 0x35, 0x00, 0x46, 0x3B,
+    0x01, 0x65, 0x14, 0x75, 0x04, 0x95, 0x01, 0x81, 0x42, 0x75, 0x04, 0x95,
+    0x01, 0x81, 0x01, 0xA4, 0x09, 0x30, 0x09, 0x31, 0x09, 0x32, 0x09, 0x35,
+    0x16, 0x00, 0x80, 0x26, 0xFF, 0x7F, 0x75, 0x10, 0x95, 0x04, 0x81, 0x02,
+    0xB4, 0x06, 0x00, 0xFF, 0x09, 0x01, 0x15, 0x00, 0x26, 0xFF, 0x00, 0x75,
+    0x08, 0x95, 0x08, 0xB1, 0x02, 0xC0,
+};
+
+static const uint8_t kHIDCorpusDigitizer[] = {
+    0x05, 0x0D, 0x09, 0x04, 0xA1, 0x01, 0x85, 0x02, 0x09, 0x22, 0xA1, 0x02,
+    0x09, 0x42, 0x15, 0x00, 0x25, 0x01, 0x75, 0x01, 0x95, 0x01, 0x81, 0x02,
+    0x95, 0x07, 0x81, 0x03, 0x09, 0x51, 0x25, 0x7F, 0x75, 0x08, 0x95, 0x01,
+    0x81, 0x02, 0x05, 0x01, 0x26, 0xFF, 0x0F, 0x75, 0x10, 0x55, 0x0E, 0x65,
+    0x11, 0x09, 0x30, 0x35, 0x00, 0x46, 0xB5, 0x04, 0x81, 0x02, 0x46, 0x8A,
+    0x03, 0x09, 0x31, 0x81, 0x02, 0xC0, 0x05, 0x0D, 0x09, 0x54, 0x25, 0x7F,
+    0x95, 0x01, 0x75, 0x08, 0x81, 0x02, 0x85, 0x03, 0x09, 0x55, 0x25, 0x0A,
+    0xB1, 0x02, 0xC0,
+};
+
+static const uint8_t kHIDCorpusConsumer[] = {
+    0x05, 0x0C, 0x09, 0x01, 0xA1, 0x01, 0x85, 0x04, 0x15, 0x00, 0x26, 0xFF,
+    0x03, 0x19, 0x00, 0x2A, 0xFF, 0x03, 0x75, 0x10, 0x95, 0x02, 0x81, 0x00,
+    0x05, 0x0C, 0x15, 0x00, 0x25, 0x01, 0x75, 0x01, 0x95, 0x08, 0x09, 0xB5,
+    0x09, 0xB6, 0x09, 0xB7, 0x09, 0xCD, 0x09, 0xE2, 0x09, 0xE9, 0x09, 0xEA,
+    0x0A, 0x23, 0x02, 0x81, 0x02, 0xC0,
+};
+
+static const uint8_t kHIDCorpusVendor[] = {
+    0x06, 0x00, 0xFF, 0x09, 0x01, 0xA1, 0x01, 0x85, 0x05, 0x79, 0x01, 0x89,
+    0x02, 0x99, 0x04, 0x39, 0x03, 0x49, 0x05, 0x59, 0x06, 0x09, 0x02, 0x15,
+    0x00, 0x26, 0xFF, 0x00, 0x75, 0x08, 0x95, 0x40, 0x81, 0x02, 0x09, 0x03,
+    0x91, 0x02, 0xA9, 0x01, 0x09, 0x04, 0x09, 0x05, 0xA9, 0x00, 0xB1, 0x02,
+    0xFE, 0x02, 0x10, 0xAA, 0xBB, 0x85, 0x06, 0x0B, 0x01, 0x00, 0x00, 0xFF,
+    0x17, 0x00, 0x00, 0x00, 0x80, 0x27, 0xFF, 0xFF, 0xFF, 0x7F, 0x75, 0x20,
+    0x95, 0x02, 0x81, 0x02, 0xC0,
+};
+
+static const HIDCorpusDescriptor kHIDCorpus[] = {
+    { "keyboard",   kHIDCorpusKeyboard,     sizeof(kHIDCorpusKeyboard)  },
+    { "mouse",      kHIDCorpusMouse,        sizeof(kHIDCorpusMouse)     },
+    { "gamepad",    kHIDCorpusGamepad,      sizeof(kHIDCorpusGamepad)   },
+    { "digitizer",  kHIDCorpusDigitizer,    sizeof(kHIDCorpusDigitizer) },
+    { "consumer",   kHIDCorpusConsumer,     sizeof(kHIDCorpusConsumer)  },
+    { "vendor",     kHIDCorpusVendor,       sizeof(kHIDCorpusVendor)    },
+};
+
+#define kHIDCorpusCount     (sizeof(kHIDCorpus) / sizeof(kHIDCorpus[0]))
+
+/*
+ * Builds a composite descriptor out of `reports` application collections,
+ * each with its own report ID, button range, axes and a vendor feature.
+ * Returns the number of bytes written, or 0 if `capacity` is too small.
+ * 40 reports make about 2.6KB.
+ */
+static size_t HIDCorpusBuildLarge(uint8_t * buffer, size_t capacity, unsigned reports)
+{
+    size_t      length = 0;
+    unsigned    report;
+
+#define EMIT(...) \
+    do { \
+        const uint8_t bytes[] = { __VA_ARGS__ }; \
+        if ( length + sizeof(bytes) > capacity ) \
+            return 0; \
+        memcpy(buffer + length, bytes, sizeof(bytes)); \
+        length += sizeof(bytes); \
+    } while (0)
+
+    for ( report = 1; report <= reports; report++ ) {
+        EMIT(0x05, 0x01, 0x09, 0x04, 0xA1, 0x01, 0x85, (uint8_t) report);
+        EMIT(0x05, 0x09, 0x19, 0x01, 0x29, (uint8_t) (8 + (report % 24)),
+             0x15, 0x00, 0x25, 0x01, 0x75, 0x01, 0x95, 0x20, 0x81, 0x02);
+        EMIT(0x05, 0x01, 0x09, 0x01, 0xA1, 0x00,
+             0x09, 0x30, 0x09, 0x31, 0x09, 0x32, 0x09, 0x33,
+             0x16, 0x01, 0x80, 0x26, 0xFF, 0x7F, 0x75, 0x10, 0x95, 0x04, 0x81, 0x02,
+             0xC0);
+        EMIT(0x06, 0x00, 0xFF, 0x09, (uint8_t) report, 0x15, 0x00, 0x26, 0xFF, 0x00,
+             0x75, 0x08, 0x95, 0x04, 0xB1, 0x02);
+        EMIT(0xC0);
+    }
+
+#undef EMIT
+
+    return length;
+}
+
+#endif /* _HID_DESCRIPTOR_CORPUS_H */
@@ -0,0 +1,223 @@
+/*
+ * Tests that HIDGetUsageValues and HIDGetScaledUsageValues give each usage
+ * the value and status HIDGetUsageValue and HIDGetScaledUsageValue give it
+ * when called once per usage, and return the status of the first usage
+ * that did not get a value.
+ *
+ * The usage lists are drawn from the value and button caps of each corpus
+ * descriptor, and a large composite one, shuffled, with duplicates, page
+ * zero wildcards and usages the descriptor does not have.  They are read
+ * from every collection, on random reports that are sometimes short or
+ * carry the wrong report ID.
+ *
+ * usage: HIDGetUsageValuesTest [-n reports] [-s seed]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "HIDLib.h"
+#include "HIDDescriptorCorpus.h"
+
+#define kMaxCaps            256
+#define kMaxUsages          64
+#define kMaxReportLength    512
+#define kUnsetValue         ((SInt32) 0x5A5A5A5A)
+
+static unsigned long    gFailures   = 0;
+static unsigned long    gLists      = 0;
+static uint64_t         gRandom     = 0x2545F4914F6CDD1DULL;
+
+static uint32_t NextRandom(void)
+{
+    gRandom ^= gRandom << 13;
+    gRandom ^= gRandom >> 7;
+    gRandom ^= gRandom << 17;
+    return (uint32_t) (gRandom >> 16);
+}
+
+static void Fail(const char * what, const char * name)
+{
+    gFailures++;
+    if ( gFailures <= 10 )
+        fprintf(stderr, "FAIL %s: %s\n", name, what);
+}
+
+// Every usage the caps of reportType name, ranges included
+static UInt32 CollectUsages(HIDReportType reportType, HIDPreparsedDataRef parseData, HIDUsageAndPage * usages, UInt32 capacity)
+{
+    static HIDValueCaps     valueCaps[kMaxCaps];
+    static HIDButtonCaps    buttonCaps[kMaxCaps];
+    UInt32                  valueCount  = kMaxCaps;
+    UInt32                  buttonCount = kMaxCaps;
+    UInt32                  count       = 0;
+    UInt32                  i;
+
+    if ( HIDGetValueCaps(reportType, valueCaps, &valueCount, parseData) != kHIDSuccess )
+        valueCount = 0;
+    if ( HIDGetButtonCaps(reportType, buttonCaps, &buttonCount, parseData) != kHIDSuccess )
+        buttonCount = 0;
+
+    for ( i = 0; i < valueCount && count < capacity; i++ ) {
+        if ( !valueCaps[i].isRange ) {
+            usages[count].usagePage = valueCaps[i].usagePage;
+            usages[count++].usage = valueCaps[i].u.notRange.usage;
+            continue;
+        }
+        for ( HIDUsage usage = valueCaps[i].u.range.usageMin; usage <= valueCaps[i].u.range.usageMax && count < capacity; usage++ ) {
+            usages[count].usagePage = valueCaps[i].usagePage;
+            usages[count++].usage = usage;
+        }
+    }
+
+    for ( i = 0; i < buttonCount && count < capacity; i++ ) {
+        if ( !buttonCaps[i].isRange ) {
+            usages[count].usagePage = buttonCaps[i].usagePage;
+            usages[count++].usage = buttonCaps[i].u.notRange.usage;
+            continue;
+        }
+        for ( HIDUsage usage = buttonCaps[i].u.range.usageMin; usage <= buttonCaps[i].u.range.usageMax && count < capacity; usage++ ) {
+            usages[count].usagePage = buttonCaps[i].usagePage;
+            usages[count++].usage = usage;
+        }
+    }
+
+    return count;
+}
+
+static UInt32 BuildList(const HIDUsageAndPage * known, UInt32 knownCount, HIDUsageAndPage * list)
+{
+    UInt32 count = 1 + NextRandom() % kMaxUsages;
+
+    for ( UInt32 i = 0; i < count; i++ ) {
+        switch ( knownCount ? NextRandom() % 8 : 0 ) {
+            case 0:
+                // A usage the descriptor does not have
+                list[i].usagePage = 0xFF00 | (NextRandom() & 0x7F);
+                list[i].usage = 0x7F00 | (NextRandom() & 0xFF);
+                break;
+            case 1:
+                // Any page
+                list[i] = known[NextRandom() % knownCount];
+                list[i].usagePage = 0;
+                break;
+            default:
+                list[i] = known[NextRandom() % knownCount];
+                break;
+        }
+    }
+
+    return count;
+}
+
+static void CompareList(HIDReportType reportType, UInt32 collection, HIDUsageAndPage * list, UInt32 count,
+                        HIDPreparsedDataRef parseData, UInt8 * report, IOByteCount reportLength, Boolean scaled, const char * name)
+{
+    SInt32      values[kMaxUsages], expectedValues[kMaxUsages];
+    OSStatus    statuses[kMaxUsages], expectedStatuses[kMaxUsages];
+    OSStatus    status, expectedStatus = kHIDSuccess;
+    UInt32      i;
+
+    for ( i = 0; i < count; i++ ) {
+        values[i] = expectedValues[i] = kUnsetValue;
+        statuses[i] = kHIDSuccess - 1;
+    }
+
+    for ( i = 0; i < count; i++ ) {
+        expectedStatuses[i] = scaled ?
+                HIDGetScaledUsageValue(reportType, list[i].usagePage, collection, list[i].usage, &expectedValues[i], parseData, report, reportLength) :
+                HIDGetUsageValue(reportType, list[i].usagePage, collection, list[i].usage, &expectedValues[i], parseData, report, reportLength);
+        if ( expectedStatus == kHIDSuccess )
+            expectedStatus = expectedStatuses[i];
+    }
+
+    status = scaled ?
+            HIDGetScaledUsageValues(reportType, collection, list, count, values, statuses, parseData, report, reportLength) :
+            HIDGetUsageValues(reportType, collection, list, count, values, statuses, parseData, report, reportLength);
+
+    if ( status != expectedStatus )
+        Fail(scaled ? "HIDGetScaledUsageValues status" : "HIDGetUsageValues status", name);
+    if ( memcmp(statuses, expectedStatuses, count * sizeof(OSStatus)) != 0 )
+        Fail(scaled ? "HIDGetScaledUsageValues usage status" : "HIDGetUsageValues usage status", name);
+    if ( memcmp(values, expectedValues, count * sizeof(SInt32)) != 0 )
+        Fail(scaled ? "HIDGetScaledUsageValues value" : "HIDGetUsageValues value", name);
+
+    gLists++;
+}
+
+static void TestDescriptor(const char * name, const uint8_t * descriptor, size_t length, unsigned long reports)
+{
+    HIDUsageAndPage     known[kMaxCaps], list[kMaxUsages];
+    UInt8               report[kMaxReportLength];
+    HIDPreparsedDataRef parseData;
+    HIDCaps             caps;
+    HIDReportType       reportType;
+
+    if ( HIDOpenReportDescriptor((void *) descriptor, length, &parseData, 0) != kHIDSuccess
+      || HIDGetCaps(parseData, &caps) != kHIDSuccess ) {
+        Fail("cannot open", name);
+        return;
+    }
+
+    for ( reportType = kHIDInputReport; reportType <= kHIDFeatureReport; reportType++ ) {
+        UInt32 knownCount = CollectUsages(reportType, parseData, known, kMaxCaps);
+
+        for ( UInt32 reportID = 0; reportID < 256; reportID++ ) {
+            IOByteCount reportLength;
+
+            if ( HIDGetReportLength(reportType, (UInt8) reportID, &reportLength, parseData) != kHIDSuccess
+              || reportLength == 0 || reportLength > kMaxReportLength )
+                continue;
+
+            for ( unsigned long n = 0; n < reports; n++ ) {
+                IOByteCount length  = reportLength;
+                UInt32      count   = BuildList(known, knownCount, list);
+
+                for ( IOByteCount i = 0; i < reportLength; i++ )
+                    report[i] = (UInt8) NextRandom();
+                if ( reportID && NextRandom() % 4 )
+                    report[0] = (UInt8) reportID;
+                if ( NextRandom() % 8 == 0 )
+                    length = NextRandom() % reportLength;
+
+                for ( UInt32 collection = 0; collection < caps.numberCollectionNodes; collection++ ) {
+                    CompareList(reportType, collection, list, count, parseData, report, length, false, name);
+                    CompareList(reportType, collection, list, count, parseData, report, length, true, name);
+                }
+            }
+        }
+    }
+
+    HIDCloseReportDescriptor(parseData);
+}
+
+int main(int argc, char ** argv)
+{
+    static uint8_t  large[8192];
+    unsigned long   reports = 32;
+    size_t          i;
+    int             option;
+
+    while ( (option = getopt(argc, argv, "n:s:")) != -1 ) {
+        switch ( option ) {
+            case 'n':
+                reports = strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                gRandom = strtoull(optarg, NULL, 0) | 1;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-n reports] [-s seed]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    for ( i = 0; i < kHIDCorpusCount; i++ )
+        TestDescriptor(kHIDCorpus[i].name, kHIDCorpus[i].bytes, kHIDCorpus[i].length, reports);
+    TestDescriptor("large", large, HIDCorpusBuildLarge(large, sizeof(large), 40), reports);
+
+    printf("%lu usage lists, %lu failures\n", gLists, gFailures);
+
+    return gFailures ? 1 : 0;
+}
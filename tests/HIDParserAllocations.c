@@ -0,0 +1,116 @@
+/*
+ * Allocation counts and parse times for HIDOpenReportDescriptor.
+ *
+ * For each corpus descriptor this prints the allocator calls made by one
+ * HIDOpenReportDescriptor and one HIDCloseReportDescriptor, and the average
+ * time of an open and close pair.  The counts come from the IOMalloc shim.
+ *
+ * With -c it also checks the arena: an open makes no more than two
+ * allocations (the parse scratch block and the arena), a close makes a
+ * single free, and nothing is left allocated afterwards.
+ *
+ * The parser at any revision can be measured by building this target
+ * against that revision's IOHIDSystem/IOHIDDescriptorParser.
+ *
+ * usage: HIDParserAllocations [-c] [-n iterations]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <IOKit/IOLib.h>
+
+#include "HIDLib.h"
+#include "HIDDescriptorCorpus.h"
+
+static double Now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char ** argv)
+{
+    static uint8_t      large[8192];
+    HIDCorpusDescriptor corpus[kHIDCorpusCount + 1];
+    unsigned long       iterations  = 50000;
+    unsigned            count       = 0;
+    int                 check       = 0;
+    int                 failures    = 0;
+    unsigned            i;
+    int                 option;
+
+    while ( (option = getopt(argc, argv, "cn:")) != -1 ) {
+        switch ( option ) {
+            case 'c':
+                check = 1;
+                break;
+            case 'n':
+                iterations = strtoul(optarg, NULL, 0);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-c] [-n iterations]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    for ( i = 0; i < kHIDCorpusCount; i++ )
+        corpus[count++] = kHIDCorpus[i];
+    corpus[count].name = "large";
+    corpus[count].bytes = large;
+    corpus[count].length = HIDCorpusBuildLarge(large, sizeof(large), 40);
+    count++;
+
+    printf("%-10s %6s %12s %12s %12s %14s\n",
+           "descriptor", "bytes", "open allocs", "open frees", "close frees", "open+close ns");
+
+    for ( i = 0; i < count; i++ ) {
+        HIDPreparsedDataRef parseData;
+        UInt64              allocations = gIOHostAllocations;
+        UInt64              frees       = gIOHostFrees;
+        UInt64              openAllocations, openFrees, closeFrees;
+        unsigned long       n;
+        double              start;
+        double              elapsed;
+
+        if ( HIDOpenReportDescriptor((void *) corpus[i].bytes, corpus[i].length, &parseData, 0) != kHIDSuccess ) {
+            fprintf(stderr, "%s: parse failed\n", corpus[i].name);
+            return 1;
+        }
+        openAllocations = gIOHostAllocations - allocations;
+        openFrees = gIOHostFrees - frees;
+
+        frees = gIOHostFrees;
+        HIDCloseReportDescriptor(parseData);
+        closeFrees = gIOHostFrees - frees;
+
+        start = Now();
+        for ( n = 0; n < iterations; n++ ) {
+            HIDOpenReportDescriptor((void *) corpus[i].bytes, corpus[i].length, &parseData, 0);
+            HIDCloseReportDescriptor(parseData);
+        }
+        elapsed = Now() - start;
+
+        printf("%-10s %6zu %12llu %12llu %12llu %14.0f\n",
+               corpus[i].name, corpus[i].length, (unsigned long long) openAllocations,
+               (unsigned long long) openFrees, (unsigned long long) closeFrees,
+               elapsed / iterations * 1e9);
+
+        if ( check && ((openAllocations > 2) || (closeFrees != 1)
+          || (openAllocations != openFrees + closeFrees)) ) {
+            fprintf(stderr, "FAIL %s: unexpected allocator traffic\n", corpus[i].name);
+            failures++;
+        }
+    }
+
+    if ( check && (gIOHostAllocations != gIOHostFrees) ) {
+        fprintf(stderr, "FAIL: %llu allocations, %llu frees\n",
+                (unsigned long long) gIOHostAllocations, (unsigned long long) gIOHostFrees);
+        failures++;
+    }
+
+    return failures ? 1 : 0;
+}
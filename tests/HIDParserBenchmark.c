@@ -0,0 +1,257 @@
+/*
+ * Throughput benchmark for the report descriptor parser.
+ *
+ * Opens and closes each corpus descriptor repeatedly, once through
+ * HIDOpenReportDescriptor and once through the two pass reference
+ * (HIDCountDescriptorItems followed by HIDParseDescriptor), and prints
+ * parses per second and descriptor megabytes per second for both.
+ *
+ * Then reads every input value of the gamepad and digitizer descriptors
+ * from a filled in report, once with one HIDGetUsageValues call and once with
+ * a HIDGetUsageValue call per usage, and the same for the scaled calls,
+ * and prints the lists read per second.
+ *
+ * usage: HIDParserBenchmark [-t seconds-per-case]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "HIDLib.h"
+#include "HIDDescriptorCorpus.h"
+
+static double Now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static OSStatus OpenCloseOnePass(const uint8_t * descriptor, size_t length)
+{
+    HIDPreparsedDataRef parseData;
+    OSStatus            status;
+
+    status = HIDOpenReportDescriptor((void *) descriptor, length, &parseData, 0);
+    if ( status == kHIDSuccess )
+        HIDCloseReportDescriptor(parseData);
+
+    return status;
+}
+
+static OSStatus OpenCloseTwoPass(const uint8_t * descriptor, size_t length)
+{
+    HIDPreparsedDataPtr ptPreparsedData;
+    HIDReportDescriptor tDescriptor;
+    OSStatus            status;
+
+    ptPreparsedData = PoolAllocateResident(sizeof(HIDPreparsedData), kShouldClearMem);
+    if ( ptPreparsedData == NULL )
+        return kHIDNotEnoughMemoryErr;
+
+    tDescriptor.descriptor = (UInt8 *) descriptor;
+    tDescriptor.descriptorLength = length;
+
+    status = HIDCountDescriptorItems(&tDescriptor, ptPreparsedData);
+    if ( status == kHIDSuccess )
+        status = HIDParseDescriptor(&tDescriptor, ptPreparsedData);
+
+    if ( ptPreparsedData->rawMemPtr != NULL )
+        PoolDeallocate(ptPreparsedData->rawMemPtr, ptPreparsedData->numBytesAllocated);
+    PoolDeallocate(ptPreparsedData, sizeof(HIDPreparsedData));
+
+    return status;
+}
+
+typedef OSStatus (*OpenCloseFunction)(const uint8_t * descriptor, size_t length);
+
+static double Measure(OpenCloseFunction function, const uint8_t * descriptor, size_t length, double seconds)
+{
+    unsigned long   iterations  = 0;
+    unsigned long   batch       = 64;
+    double          start       = Now();
+    double          elapsed;
+
+    do {
+        unsigned long i;
+
+        for ( i = 0; i < batch; i++ ) {
+            if ( function(descriptor, length) != kHIDSuccess ) {
+                fprintf(stderr, "parse failed\n");
+                exit(1);
+            }
+        }
+        iterations += batch;
+        elapsed = Now() - start;
+    } while ( elapsed < seconds );
+
+    return iterations / elapsed;
+}
+
+#define kMaxValueUsages     64
+
+typedef struct ValueList {
+    HIDPreparsedDataRef parseData;
+    HIDUsageAndPage     usages[kMaxValueUsages];
+    UInt32              count;
+    UInt8               report[64];
+    IOByteCount         reportLength;
+} ValueList;
+
+// Every input value usage of one report, and a report to read them from
+static Boolean BuildValueList(const HIDCorpusDescriptor * descriptor, ValueList * list)
+{
+    HIDValueCaps    valueCaps[kMaxValueUsages];
+    UInt32          valueCount  = kMaxValueUsages;
+    UInt32          i;
+
+    memset(list, 0, sizeof(*list));
+    if ( HIDOpenReportDescriptor((void *) descriptor->bytes, descriptor->length, &list->parseData, 0) != kHIDSuccess )
+        return false;
+    if ( HIDGetValueCaps(kHIDInputReport, valueCaps, &valueCount, list->parseData) != kHIDSuccess || valueCount == 0
+      || HIDGetReportLength(kHIDInputReport, valueCaps[0].reportID, &list->reportLength, list->parseData) != kHIDSuccess
+      || list->reportLength > sizeof(list->report) ) {
+        HIDCloseReportDescriptor(list->parseData);
+        return false;
+    }
+
+    for ( i = 0; i < valueCount && list->count < kMaxValueUsages; i++ ) {
+        HIDUsage usage = valueCaps[i].isRange ? valueCaps[i].u.range.usageMin : valueCaps[i].u.notRange.usage;
+        HIDUsage last  = valueCaps[i].isRange ? valueCaps[i].u.range.usageMax : usage;
+
+        if ( valueCaps[i].reportID != valueCaps[0].reportID )
+            continue;
+        for ( ; usage <= last && list->count < kMaxValueUsages; usage++ ) {
+            list->usages[list->count].usagePage = valueCaps[i].usagePage;
+            list->usages[list->count++].usage = usage;
+        }
+    }
+
+    for ( i = 0; i < list->reportLength; i++ )
+        list->report[i] = (UInt8) (i * 0x9E + 0x37);
+    list->report[0] = valueCaps[0].reportID ? valueCaps[0].reportID : list->report[0];
+
+    return true;
+}
+
+typedef void (*ReadValuesFunction)(ValueList * list, SInt32 * values);
+
+static void ReadValuesBatched(ValueList * list, SInt32 * values)
+{
+    OSStatus statuses[kMaxValueUsages];
+
+    HIDGetUsageValues(kHIDInputReport, 0, list->usages, list->count, values, statuses,
+                      list->parseData, list->report, list->reportLength);
+}
+
+static void ReadValuesLoop(ValueList * list, SInt32 * values)
+{
+    for ( UInt32 i = 0; i < list->count; i++ )
+        HIDGetUsageValue(kHIDInputReport, list->usages[i].usagePage, 0, list->usages[i].usage,
+                         &values[i], list->parseData, list->report, list->reportLength);
+}
+
+static void ReadScaledValuesBatched(ValueList * list, SInt32 * values)
+{
+    OSStatus statuses[kMaxValueUsages];
+
+    HIDGetScaledUsageValues(kHIDInputReport, 0, list->usages, list->count, values, statuses,
+                            list->parseData, list->report, list->reportLength);
+}
+
+static void ReadScaledValuesLoop(ValueList * list, SInt32 * values)
+{
+    for ( UInt32 i = 0; i < list->count; i++ )
+        HIDGetScaledUsageValue(kHIDInputReport, list->usages[i].usagePage, 0, list->usages[i].usage,
+                               &values[i], list->parseData, list->report, list->reportLength);
+}
+
+static double MeasureValues(ReadValuesFunction function, ValueList * list, double seconds)
+{
+    static volatile SInt32  sink;
+    SInt32                  values[kMaxValueUsages];
+    unsigned long           iterations  = 0;
+    unsigned long           batch       = 256;
+    double                  start       = Now();
+    double                  elapsed;
+
+    do {
+        for ( unsigned long i = 0; i < batch; i++ ) {
+            function(list, values);
+            sink = values[0];
+        }
+        iterations += batch;
+        elapsed = Now() - start;
+    } while ( elapsed < seconds );
+
+    return iterations / elapsed;
+}
+
+int main(int argc, char ** argv)
+{
+    static uint8_t  large[8192];
+    HIDCorpusDescriptor corpus[kHIDCorpusCount + 1];
+    double          seconds = 0.5;
+    unsigned        count   = 0;
+    unsigned        i;
+    int             option;
+
+    while ( (option = getopt(argc, argv, "t:")) != -1 ) {
+        if ( option != 't' ) {
+            fprintf(stderr, "usage: %s [-t seconds-per-case]\n", argv[0]);
+            return 2;
+        }
+        seconds = strtod(optarg, NULL);
+    }
+
+    for ( i = 0; i < kHIDCorpusCount; i++ )
+        corpus[count++] = kHIDCorpus[i];
+    corpus[count].name = "large";
+    corpus[count].bytes = large;
+    corpus[count].length = HIDCorpusBuildLarge(large, sizeof(large), 40);
+    count++;
+
+    printf("%-10s %6s %14s %14s %9s %9s %7s\n",
+           "descriptor", "bytes", "one pass/s", "two pass/s", "1p MB/s", "2p MB/s", "ratio");
+
+    for ( i = 0; i < count; i++ ) {
+        double onePass = Measure(OpenCloseOnePass, corpus[i].bytes, corpus[i].length, seconds);
+        double twoPass = Measure(OpenCloseTwoPass, corpus[i].bytes, corpus[i].length, seconds);
+
+        printf("%-10s %6zu %14.0f %14.0f %9.1f %9.1f %7.2f\n",
+               corpus[i].name, corpus[i].length, onePass, twoPass,
+               onePass * corpus[i].length / 1e6, twoPass * corpus[i].length / 1e6,
+               onePass / twoPass);
+    }
+
+    printf("\n%-10s %6s %14s %14s %7s %14s %14s %7s\n",
+           "descriptor", "usages", "values/s", "loop/s", "ratio", "scaled/s", "loop/s", "ratio");
+
+    for ( i = 0; i < kHIDCorpusCount; i++ ) {
+        ValueList   list;
+        double      batched, loop, scaledBatched, scaledLoop;
+
+        if ( strcmp(kHIDCorpus[i].name, "gamepad") != 0 && strcmp(kHIDCorpus[i].name, "digitizer") != 0 )
+            continue;
+        if ( !BuildValueList(&kHIDCorpus[i], &list) ) {
+            fprintf(stderr, "%s has no input values\n", kHIDCorpus[i].name);
+            return 1;
+        }
+
+        batched         = MeasureValues(ReadValuesBatched, &list, seconds);
+        loop            = MeasureValues(ReadValuesLoop, &list, seconds);
+        scaledBatched   = MeasureValues(ReadScaledValuesBatched, &list, seconds);
+        scaledLoop      = MeasureValues(ReadScaledValuesLoop, &list, seconds);
+
+        printf("%-10s %6u %14.0f %14.0f %7.2f %14.0f %14.0f %7.2f\n",
+               kHIDCorpus[i].name, (unsigned) list.count, batched, loop, batched / loop,
+               scaledBatched, scaledLoop, scaledBatched / scaledLoop);
+
+        HIDCloseReportDescriptor(list.parseData);
+    }
+
+    return 0;
+}
@@ -0,0 +1,434 @@
+/*
+ * Differential test for the single-pass report descriptor parser.
+ *
+ * Every descriptor is parsed twice.  HIDOpenReportDescriptor goes through
+ * HIDParseDescriptorInOnePass.  The reference path is the original two
+ * pass parser: HIDCountDescriptorItems sizes one block of raw memory, then
+ * HIDParseDescriptor fills it in.  Both must return the same status and,
+ * on success, the same counts and the same contents in every array.
+ *
+ * The descriptors are the corpus in HIDDescriptorCorpus.h, any files named
+ * on the command line, and mutations of both: flipped, inserted, deleted
+ * and truncated bytes, splices of two descriptors, and random item streams.
+ *
+ * usage: HIDParserDifferentialTest [-n iterations] [-s seed] [descriptor ...]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "HIDLib.h"
+#include "HIDDescriptorCorpus.h"
+
+#define kMaxDescriptorLength    8192
+
+static unsigned long    gChecked    = 0;
+static unsigned long    gParsed     = 0;
+static unsigned long    gFailures   = 0;
+
+static uint64_t gRandom = 0x9E3779B97F4A7C15ULL;
+
+static uint32_t NextRandom(void)
+{
+    gRandom ^= gRandom << 13;
+    gRandom ^= gRandom >> 7;
+    gRandom ^= gRandom << 17;
+    return (uint32_t) (gRandom >> 16);
+}
+
+/*
+ * The reference parser: the two walks HIDOpenReportDescriptor made before
+ * HIDParseDescriptorInOnePass, into a separately allocated structure.
+ */
+static OSStatus OpenTwoPass(const uint8_t * descriptor, size_t length, HIDPreparsedDataPtr * result)
+{
+    HIDPreparsedDataPtr ptPreparsedData;
+    HIDReportDescriptor tDescriptor;
+    OSStatus            iStatus;
+
+    *result = NULL;
+
+    ptPreparsedData = PoolAllocateResident(sizeof(HIDPreparsedData), kShouldClearMem);
+    if ( ptPreparsedData == NULL )
+        return kHIDNotEnoughMemoryErr;
+
+    tDescriptor.descriptor = (UInt8 *) descriptor;
+    tDescriptor.descriptorLength = length;
+
+    iStatus = HIDCountDescriptorItems(&tDescriptor, ptPreparsedData);
+    if ( iStatus == kHIDSuccess )
+        iStatus = HIDParseDescriptor(&tDescriptor, ptPreparsedData);
+
+    if ( iStatus != kHIDSuccess ) {
+        if ( ptPreparsedData->rawMemPtr != NULL )
+            PoolDeallocate(ptPreparsedData->rawMemPtr, ptPreparsedData->numBytesAllocated);
+        PoolDeallocate(ptPreparsedData, sizeof(HIDPreparsedData));
+        return iStatus;
+    }
+
+    ptPreparsedData->hidTypeIfValid = kHIDOSType;
+    *result = ptPreparsedData;
+    return kHIDSuccess;
+}
+
+static void Fail(const char * what, const char * label, const uint8_t * descriptor, size_t length)
+{
+    size_t i;
+
+    gFailures++;
+    if ( gFailures > 10 )
+        return;
+
+    fprintf(stderr, "FAIL %s: %s mismatch, %zu byte descriptor:", label, what, length);
+    for ( i = 0; i < length; i++ )
+        fprintf(stderr, " %02X", descriptor[i]);
+    fprintf(stderr, "\n");
+}
+
+#define SameField(a, b, field)  ((a).field == (b).field)
+
+static int SameGlobals(const HIDGlobalItems * a, const HIDGlobalItems * b)
+{
+    return SameField(*a, *b, usagePage) && SameField(*a, *b, logicalMinimum)
+        && SameField(*a, *b, logicalMaximum) && SameField(*a, *b, physicalMinimum)
+        && SameField(*a, *b, physicalMaximum) && SameField(*a, *b, unitExponent)
+        && SameField(*a, *b, units) && SameField(*a, *b, reportSize)
+        && SameField(*a, *b, reportID) && SameField(*a, *b, reportCount)
+        && SameField(*a, *b, reportIndex);
+}
+
+static const char * ComparePreparsedData(HIDPreparsedDataPtr a, HIDPreparsedDataPtr b)
+{
+    UInt32 i;
+
+    if ( (a->collectionCount != b->collectionCount) || (a->reportItemCount != b->reportItemCount)
+      || (a->reportCount != b->reportCount) || (a->usageItemCount != b->usageItemCount)
+      || (a->stringItemCount != b->stringItemCount) || (a->desigItemCount != b->desigItemCount)
+      || (a->flags != b->flags) )
+        return "count";
+
+    for ( i = 0; i < a->collectionCount; i++ ) {
+        const HIDCollection * x = &a->collections[i];
+        const HIDCollection * y = &b->collections[i];
+
+        if ( !SameField(*x, *y, data) || !SameField(*x, *y, usagePage)
+          || !SameField(*x, *y, firstUsageItem) || !SameField(*x, *y, usageItemCount)
+          || !SameField(*x, *y, firstReportItem) || !SameField(*x, *y, reportItemCount)
+          || !SameField(*x, *y, parent) || !SameField(*x, *y, children)
+          || !SameField(*x, *y, firstChild) || !SameField(*x, *y, nextSibling) )
+            return "collection";
+    }
+
+    for ( i = 0; i < a->reportItemCount; i++ ) {
+        const HIDReportItem * x = &a->reportItems[i];
+        const HIDReportItem * y = &b->reportItems[i];
+
+        if ( !SameField(*x, *y, reportType) || !SameGlobals(&x->globals, &y->globals)
+          || !SameField(*x, *y, startBit) || !SameField(*x, *y, parent)
+          || !SameField(*x, *y, dataModes) || !SameField(*x, *y, firstUsageItem)
+          || !SameField(*x, *y, usageItemCount) || !SameField(*x, *y, firstStringItem)
+          || !SameField(*x, *y, stringItemCount) || !SameField(*x, *y, firstDesigItem)
+          || !SameField(*x, *y, desigItemCount) || !SameField(*x, *y, flags) )
+            return "report item";
+    }
+
+    for ( i = 0; i < a->reportCount; i++ ) {
+        const HIDReportSizes * x = &a->reports[i];
+        const HIDReportSizes * y = &b->reports[i];
+
+        if ( !SameField(*x, *y, reportID) || !SameField(*x, *y, inputBitCount)
+          || !SameField(*x, *y, outputBitCount) || !SameField(*x, *y, featureBitCount) )
+            return "report size";
+    }
+
+    for ( i = 0; i < a->usageItemCount; i++ ) {
+        const HIDP_UsageItem * x = &a->usageItems[i];
+        const HIDP_UsageItem * y = &b->usageItems[i];
+
+        if ( !SameField(*x, *y, isRange) || !SameField(*x, *y, usagePage)
+          || !SameField(*x, *y, usage) || !SameField(*x, *y, usageMinimum)
+          || !SameField(*x, *y, usageMaximum) )
+            return "usage item";
+    }
+
+    for ( i = 0; i < a->stringItemCount; i++ ) {
+        const HIDStringItem * x = &a->stringItems[i];
+        const HIDStringItem * y = &b->stringItems[i];
+
+        if ( !SameField(*x, *y, isRange) || !SameField(*x, *y, index)
+          || !SameField(*x, *y, minimum) || !SameField(*x, *y, maximum) )
+            return "string item";
+    }
+
+    for ( i = 0; i < a->desigItemCount; i++ ) {
+        const HIDDesignatorItem * x = &a->desigItems[i];
+        const HIDDesignatorItem * y = &b->desigItems[i];
+
+        if ( !SameField(*x, *y, isRange) || !SameField(*x, *y, index)
+          || !SameField(*x, *y, minimum) || !SameField(*x, *y, maximum) )
+            return "designator item";
+    }
+
+    return NULL;
+}
+
+/*
+ * The usage index has no counterpart in the two pass parse.  Check that it
+ * is sorted by usage then report item, and that each entry's report item
+ * really has that usage.
+ */
+static const char * CheckUsageIndex(HIDPreparsedDataPtr a)
+{
+    UInt32 i;
+    SInt32 j;
+
+    for ( i = 0; i < a->usageIndexCount; i++ ) {
+        const HIDUsageIndexEntry *  entry = &a->usageIndex[i];
+        const HIDReportItem *       item;
+        Boolean                     found = false;
+
+        if ( (i > 0) && ((entry[-1].usage > entry->usage)
+          || ((entry[-1].usage == entry->usage) && (entry[-1].reportItem > entry->reportItem))) )
+            return "usage index order";
+
+        if ( entry->reportItem >= a->reportItemCount )
+            return "usage index item";
+
+        item = &a->reportItems[entry->reportItem];
+        for ( j = 0; j < item->usageItemCount && !found; j++ ) {
+            const HIDP_UsageItem * usage = &a->usageItems[item->firstUsageItem + j];
+
+            if ( usage->isRange )
+                found = (entry->usage >= (UInt32) usage->usageMinimum) && (entry->usage <= (UInt32) usage->usageMaximum);
+            else
+                found = (entry->usage == usage->usage);
+        }
+        if ( !found )
+            return "usage index entry";
+    }
+
+    return NULL;
+}
+
+static void CheckDescriptor(const char * label, const uint8_t * descriptor, size_t length)
+{
+    HIDPreparsedDataRef onePass     = NULL;
+    HIDPreparsedDataPtr twoPass     = NULL;
+    OSStatus            onePassStatus;
+    OSStatus            twoPassStatus;
+    const char *        mismatch;
+    uint8_t             empty       = 0;
+
+    // HIDOpenReportDescriptor rejects a NULL descriptor before parsing.
+    if ( descriptor == NULL )
+        descriptor = &empty;
+
+    onePassStatus = HIDOpenReportDescriptor((void *) descriptor, length, &onePass, 0);
+    twoPassStatus = OpenTwoPass(descriptor, length, &twoPass);
+
+    gChecked++;
+
+    if ( onePassStatus != twoPassStatus ) {
+        char what[64];
+
+        snprintf(what, sizeof(what), "status (%d vs %d)", (int) onePassStatus, (int) twoPassStatus);
+        Fail(what, label, descriptor, length);
+    }
+    else if ( onePassStatus == kHIDSuccess ) {
+        gParsed++;
+        if ( (mismatch = ComparePreparsedData((HIDPreparsedDataPtr) onePass, twoPass)) != NULL )
+            Fail(mismatch, label, descriptor, length);
+        else if ( (mismatch = CheckUsageIndex((HIDPreparsedDataPtr) onePass)) != NULL )
+            Fail(mismatch, label, descriptor, length);
+    }
+
+    if ( onePass )
+        HIDCloseReportDescriptor(onePass);
+    if ( twoPass )
+        HIDCloseReportDescriptor(twoPass);
+}
+
+static size_t Mutate(uint8_t * buffer, size_t length, const uint8_t * other, size_t otherLength)
+{
+    unsigned    edits   = 1 + NextRandom() % 4;
+    size_t      offset;
+
+    while ( edits-- ) {
+        offset = length ? NextRandom() % length : 0;
+
+        switch ( NextRandom() % 5 ) {
+            case 0:     // flip a bit
+                if ( length )
+                    buffer[offset] ^= (uint8_t) (1 << (NextRandom() % 8));
+                break;
+            case 1:     // replace a byte
+                if ( length )
+                    buffer[offset] = (uint8_t) NextRandom();
+                break;
+            case 2:     // insert a byte
+                if ( length < kMaxDescriptorLength ) {
+                    memmove(buffer + offset + 1, buffer + offset, length - offset);
+                    buffer[offset] = (uint8_t) NextRandom();
+                    length++;
+                }
+                break;
+            case 3:     // delete a byte
+                if ( length ) {
+                    memmove(buffer + offset, buffer + offset + 1, length - offset - 1);
+                    length--;
+                }
+                break;
+            case 4:     // splice in the tail of another descriptor
+                if ( otherLength ) {
+                    size_t from = NextRandom() % otherLength;
+                    size_t count = otherLength - from;
+
+                    if ( offset + count > kMaxDescriptorLength )
+                        count = kMaxDescriptorLength - offset;
+                    memcpy(buffer + offset, other + from, count);
+                    length = offset + count;
+                }
+                break;
+        }
+    }
+
+    // Truncate now and then, the parser must stop at the end of the buffer.
+    if ( length && (NextRandom() % 8) == 0 )
+        length = NextRandom() % length;
+
+    return length;
+}
+
+/*
+ * A random stream of short items, biased towards the tags the parser acts
+ * on, with the occasional long item and balanced-ish collections.
+ */
+static size_t RandomItems(uint8_t * buffer, size_t capacity)
+{
+    static const uint8_t prefixes[] = {
+        0x04, 0x14, 0x24, 0x34, 0x44, 0x54, 0x64, 0x74, 0x84, 0x94, 0xA4, 0xB4,   // global
+        0x08, 0x18, 0x28, 0x38, 0x48, 0x58, 0x78, 0x88, 0x98, 0xA8,               // local
+        0x80, 0x90, 0xB0, 0xA0, 0xC0,                                               // main
+    };
+    size_t      length  = 0;
+    unsigned    items   = 1 + NextRandom() % 64;
+    unsigned    depth   = 0;
+
+    while ( items-- && length + 6 <= capacity ) {
+        uint8_t     prefix;
+        unsigned    size;
+
+        if ( (NextRandom() % 32) == 0 ) {
+            buffer[length++] = 0xFE;
+            buffer[length++] = 2;
+            buffer[length++] = (uint8_t) NextRandom();
+            buffer[length++] = (uint8_t) NextRandom();
+            buffer[length++] = (uint8_t) NextRandom();
+            continue;
+        }
+
+        prefix = prefixes[NextRandom() % sizeof(prefixes)];
+        if ( prefix == 0xA0 )
+            depth++;
+        else if ( prefix == 0xC0 && depth )
+            depth--;
+
+        size = (prefix == 0xC0) ? 0 : NextRandom() % 4;
+        buffer[length++] = prefix | size;
+        if ( size == 3 )
+            size = 4;
+        while ( size-- )
+            buffer[length++] = (uint8_t) (NextRandom() % 4 ? NextRandom() % 16 : NextRandom());
+    }
+
+    while ( depth-- && length < capacity )
+        buffer[length++] = 0xC0;
+
+    return length;
+}
+
+static size_t ReadFile(const char * path, uint8_t * buffer, size_t capacity)
+{
+    FILE *  file    = fopen(path, "rb");
+    size_t  length;
+
+    if ( !file ) {
+        perror(path);
+        exit(2);
+    }
+    length = fread(buffer, 1, capacity, file);
+    fclose(file);
+    return length;
+}
+
+int main(int argc, char ** argv)
+{
+    static uint8_t  files[16][kMaxDescriptorLength];
+    static uint8_t  large[kMaxDescriptorLength];
+    static uint8_t  buffer[2 * kMaxDescriptorLength];
+    HIDCorpusDescriptor corpus[kHIDCorpusCount + 1 + 16];
+    unsigned long   iterations  = 100000;
+    unsigned        count       = 0;
+    unsigned long   i;
+    int             option;
+
+    while ( (option = getopt(argc, argv, "n:s:")) != -1 ) {
+        switch ( option ) {
+            case 'n':
+                iterations = strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                gRandom = strtoull(optarg, NULL, 0) | 1;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-n iterations] [-s seed] [descriptor ...]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    for ( i = 0; i < kHIDCorpusCount; i++ )
+        corpus[count++] = kHIDCorpus[i];
+
+    corpus[count].name = "large";
+    corpus[count].bytes = large;
+    corpus[count].length = HIDCorpusBuildLarge(large, sizeof(large), 40);
+    count++;
+
+    for ( ; optind < argc && count < sizeof(corpus) / sizeof(corpus[0]); optind++ ) {
+        uint8_t * file = files[count - kHIDCorpusCount - 1];
+
+        corpus[count].name = argv[optind];
+        corpus[count].bytes = file;
+        corpus[count].length = ReadFile(argv[optind], file, kMaxDescriptorLength);
+        count++;
+    }
+
+    // The corpus itself, and every prefix of it.
+    for ( i = 0; i < count; i++ ) {
+        size_t length;
+
+        for ( length = 0; length <= corpus[i].length; length++ )
+            CheckDescriptor(corpus[i].name, corpus[i].bytes, length);
+    }
+
+    for ( i = 0; i < iterations; i++ ) {
+        const HIDCorpusDescriptor * base    = &corpus[NextRandom() % count];
+        const HIDCorpusDescriptor * other   = &corpus[NextRandom() % count];
+        size_t                      length;
+
+        if ( (i % 8) == 7 ) {
+            length = RandomItems(buffer, kMaxDescriptorLength);
+            CheckDescriptor("random", buffer, length);
+            continue;
+        }
+
+        memcpy(buffer, base->bytes, base->length);
+        length = Mutate(buffer, base->length, other->bytes, other->length);
+        CheckDescriptor(base->name, buffer, length);
+    }
+
+    printf("%lu descriptors checked, %lu parsed, %lu mismatches\n", gChecked, gParsed, gFailures);
+
+    return gFailures ? 1 : 0;
+}
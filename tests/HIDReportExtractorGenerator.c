@@ -0,0 +1,193 @@
+/*
+ * Build step for HIDReportExtractorTest.
+ *
+ * Runs PrintHIDDescriptorExtractors from tools/IOHIDReportDescriptorParser.c
+ * over each corpus descriptor, a large composite one, and two descriptors
+ * of wide fields that do not start on a byte, writing <name>.h for each
+ * into the output directory.  It then reads back every field typedef the
+ * headers declare and writes HIDExtractorTable.h, which includes them all
+ * and lists each descriptor's bytes and fields, so the test can check
+ * every generated extractor against HIDGetUsageValue.  Each field list
+ * ends with an entry whose extract is NULL.
+ *
+ * usage: HIDReportExtractorGenerator output-directory
+ */
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "IOHIDReportDescriptorParser.h"
+#include "HIDDescriptorCorpus.h"
+
+// Fields of 25 to 32 bits starting 1, 4, 5 and 7 bits into a byte, after
+// a report ID
+static const uint8_t kUnaligned[] = {
+    0x05, 0x01, 0x09, 0x02, 0xA1, 0x01, 0x85, 0x01,
+    0x75, 0x04, 0x95, 0x01, 0x81, 0x01,                         // 4 bits of padding
+    0x15, 0x00, 0x27, 0xFF, 0xFF, 0xFF, 0x7F, 0x75, 0x20,       // 32 bits at 12
+    0x09, 0x30, 0x81, 0x02,
+    0x75, 0x03, 0x81, 0x01,                                     // 3 bits of padding
+    0x17, 0x00, 0x00, 0x00, 0xF0, 0x27, 0xFF, 0xFF, 0xFF, 0x0F, // signed 29 bits at 47
+    0x75, 0x1D, 0x09, 0x31, 0x81, 0x02,
+    0x15, 0x00, 0x27, 0xFF, 0xFF, 0xFF, 0x3F, 0x75, 0x1E,       // 30 bits at 76
+    0x09, 0x32, 0x81, 0x02,
+    0x27, 0xFF, 0xFF, 0xFF, 0x7F, 0x75, 0x1F,                   // 31 bits at 106
+    0x09, 0x33, 0x81, 0x02,
+    0x17, 0x00, 0x00, 0x00, 0x80, 0x75, 0x20,                   // signed 32 bits at 137
+    0x09, 0x34, 0x81, 0x02,
+    0x15, 0x00, 0x27, 0xFF, 0xFF, 0xFF, 0x01, 0x75, 0x19,       // 25 bits at 169
+    0x09, 0x35, 0x81, 0x02,
+    0x75, 0x06, 0x81, 0x01,                                     // 6 bits of padding
+    0xC0,
+};
+
+// Two 32 bit fields 5 bits into a byte, without report IDs
+static const uint8_t kWide[] = {
+    0x05, 0x01, 0x09, 0x04, 0xA1, 0x01,
+    0x75, 0x05, 0x95, 0x01, 0x81, 0x01,                         // 5 bits of padding
+    0x15, 0x00, 0x27, 0xFF, 0xFF, 0xFF, 0x7F, 0x75, 0x20,       // 32 bits at 5 and 37
+    0x95, 0x02, 0x09, 0x30, 0x09, 0x31, 0x81, 0x02,
+    0x75, 0x03, 0x95, 0x01, 0x81, 0x01,                         // 3 bits of padding
+    0xC0,
+};
+
+// Writes the extractors for one descriptor to directory/name.h
+static int Generate(const char * directory, const char * name, const uint8_t * bytes, size_t length)
+{
+    char    path[1024];
+    int     saved, fd;
+
+    snprintf(path, sizeof(path), "%s/%s.h", directory, name);
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if ( fd < 0 ) {
+        perror(path);
+        return -1;
+    }
+
+    fflush(stdout);
+    saved = dup(STDOUT_FILENO);
+    dup2(fd, STDOUT_FILENO);
+    close(fd);
+
+    PrintHIDDescriptorExtractors(bytes, (uint32_t) length, name);
+
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+
+    return 0;
+}
+
+// Lists the descriptor bytes and every field typedef of directory/name.h
+static int WriteTableEntry(FILE * table, const char * directory, const char * name, const uint8_t * bytes, size_t length)
+{
+    char        path[1024];
+    char        line[1024];
+    char        report[64]  = "";
+    unsigned    reportID    = 0;
+    FILE *      header;
+    size_t      i;
+
+    fprintf(table, "#include \"%s.h\"\n\n", name);
+    fprintf(table, "static const uint8_t kDescriptor_%s[] = {", name);
+    for ( i = 0; i < length; i++ )
+        fprintf(table, "%s0x%02X,", (i % 12) ? " " : "\n    ", bytes[i]);
+    fprintf(table, "\n};\n\n");
+    fprintf(table, "static const ExtractorTableField kFields_%s[] = {\n", name);
+
+    snprintf(path, sizeof(path), "%s/%s.h", directory, name);
+    header = fopen(path, "r");
+    if ( !header ) {
+        perror(path);
+        return -1;
+    }
+
+    while ( fgets(line, sizeof(line), header) ) {
+        const char *    usageName;
+        const char *    reportName;
+        unsigned        usagePage, usage;
+        int             nameLength;
+        char            suffix;
+
+        if ( strncmp(line, "struct ", 7) == 0 && (reportName = strstr(line, "Report")) && sscanf(reportName, "Report%u", &reportID) == 1 ) {
+            snprintf(report, sizeof(report), "%.*s", (int) strcspn(line + 7, "\n"), line + 7);
+            fprintf(table, "    // %s\n", report);
+            continue;
+        }
+
+        if ( strncmp(line, "    typedef Field<", 18) != 0 || !(usageName = strstr(line, "Usage_")) )
+            continue;
+        if ( sscanf(usageName, "Usage_%x_%x%c", &usagePage, &usage, &suffix) != 3 )
+            continue;
+
+        nameLength = (int) strcspn(usageName, ";");
+        fprintf(table, "    { %s, %u, 0x%04X, 0x%04X, %s, %s::%s::%.*s::startBit, %s::%s::%.*s::size, %s::%s::%.*s::extract, %s::%s::length },\n",
+                (strncmp(report, "Input", 5) == 0) ? "kHIDInputReport" : (strncmp(report, "Output", 6) == 0) ? "kHIDOutputReport" : "kHIDFeatureReport",
+                reportID, usagePage, usage, (suffix == '_') ? "true" : "false",
+                name, report, nameLength, usageName,
+                name, report, nameLength, usageName,
+                name, report, nameLength, usageName,
+                name, report);
+    }
+
+    fclose(header);
+    fprintf(table, "    { kHIDInputReport, 0, 0, 0, false, 0, 0, NULL, 0 }\n");
+    fprintf(table, "};\n\n");
+
+    return 0;
+}
+
+int main(int argc, char ** argv)
+{
+    static uint8_t      large[8192];
+    HIDCorpusDescriptor descriptors[kHIDCorpusCount + 3];
+    char                path[1024];
+    FILE *              table;
+    size_t              count = 0;
+    size_t              i;
+
+    if ( argc != 2 ) {
+        fprintf(stderr, "usage: %s output-directory\n", argv[0]);
+        return 2;
+    }
+
+    for ( i = 0; i < kHIDCorpusCount; i++ )
+        descriptors[count++] = kHIDCorpus[i];
+    descriptors[count].name = "large";
+    descriptors[count].bytes = large;
+    descriptors[count++].length = HIDCorpusBuildLarge(large, sizeof(large), 40);
+    descriptors[count].name = "unaligned";
+    descriptors[count].bytes = kUnaligned;
+    descriptors[count++].length = sizeof(kUnaligned);
+    descriptors[count].name = "wide";
+    descriptors[count].bytes = kWide;
+    descriptors[count++].length = sizeof(kWide);
+
+    for ( i = 0; i < count; i++ ) {
+        if ( Generate(argv[1], descriptors[i].name, descriptors[i].bytes, descriptors[i].length) != 0 )
+            return 1;
+    }
+
+    snprintf(path, sizeof(path), "%s/HIDExtractorTable.h", argv[1]);
+    table = fopen(path, "w");
+    if ( !table ) {
+        perror(path);
+        return 1;
+    }
+
+    fprintf(table, "// Generated by HIDReportExtractorGenerator\n\n");
+    for ( i = 0; i < count; i++ ) {
+        if ( WriteTableEntry(table, argv[1], descriptors[i].name, descriptors[i].bytes, descriptors[i].length) != 0 )
+            return 1;
+    }
+
+    fprintf(table, "static const ExtractorTableDescriptor kExtractorDescriptors[] = {\n");
+    for ( i = 0; i < count; i++ )
+        fprintf(table, "    { \"%s\", kDescriptor_%s, sizeof(kDescriptor_%s), kFields_%s },\n",
+                descriptors[i].name, descriptors[i].name, descriptors[i].name, descriptors[i].name);
+    fprintf(table, "};\n");
+
+    return fclose(table) ? 1 : 0;
+}
@@ -0,0 +1,192 @@
+/*
+ * Tests the report extractors PrintHIDDescriptorExtractors generates.
+ *
+ * HIDReportExtractorGenerator writes a header for each corpus descriptor,
+ * a large composite one, and two descriptors of 25 to 32 bit fields that
+ * do not start on a byte.  Every field those headers declare is read from
+ * random, all zero and all one reports, and must give the value
+ * HIDGetUsageValue gives for its usage.  The parser reads 1 bit fields as
+ * buttons, so setting one of those must instead add its usage to the
+ * buttons HIDGetButtonsOnPage lists.  Fields that repeat a usage in the same report are
+ * skipped, as the parser only finds the first.
+ *
+ * usage: HIDReportExtractorTest [-n reports] [-s seed]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <IOKit/hidsystem/IOHIDDescriptorParser.h>
+
+struct ExtractorTableField {
+    HIDReportType   reportType;
+    uint8_t         reportID;
+    HIDUsage        usagePage;
+    HIDUsage        usage;
+    bool            duplicate;
+    uint32_t        startBit;
+    uint32_t        size;
+    int32_t         (*extract)(const uint8_t * report);
+    size_t          length;
+};
+
+struct ExtractorTableDescriptor {
+    const char *                name;
+    const uint8_t *             bytes;
+    size_t                      length;
+    const ExtractorTableField * fields;
+};
+
+#include "HIDExtractorTable.h"
+
+#define kMaxReportLength    512
+#define kMaxButtons         1024
+
+static unsigned long    gFailures   = 0;
+static unsigned long    gChecked    = 0;
+static uint64_t         gRandom     = 0x2545F4914F6CDD1DULL;
+
+static uint32_t NextRandom(void)
+{
+    gRandom ^= gRandom << 13;
+    gRandom ^= gRandom >> 7;
+    gRandom ^= gRandom << 17;
+    return (uint32_t) (gRandom >> 16);
+}
+
+static void Fail(const char * what, const char * name, const ExtractorTableField * field)
+{
+    gFailures++;
+    if ( gFailures <= 10 )
+        fprintf(stderr, "FAIL %s: %s for usage %04X:%04X, %u bits at %u\n",
+                name, what, (unsigned) field->usagePage, (unsigned) field->usage, field->size, field->startBit);
+}
+
+// Times HIDGetButtonsOnPage lists the field's usage, or -1
+static int CountButton(const ExtractorTableField * field, HIDPreparsedDataRef parseData, uint8_t * report)
+{
+    static HIDUsage buttons[kMaxButtons];
+    UInt32          buttonCount = kMaxButtons;
+    OSStatus        status;
+    int             count       = 0;
+
+    status = HIDGetButtonsOnPage(field->reportType, field->usagePage, 0, buttons, &buttonCount,
+                                 parseData, report, field->length);
+    if ( status == kHIDUsageNotFoundErr )
+        return 0;   // no button on the page is pressed
+    if ( status != kHIDSuccess )
+        return -1;
+
+    for ( UInt32 i = 0; i < buttonCount; i++ )
+        count += (buttons[i] == field->usage);
+
+    return count;
+}
+
+static void TestField(const ExtractorTableDescriptor * descriptor, const ExtractorTableField * field,
+                      HIDPreparsedDataRef parseData, unsigned long reports)
+{
+    uint8_t report[kMaxReportLength];
+
+    if ( field->length > kMaxReportLength ) {
+        Fail("report too long", descriptor->name, field);
+        return;
+    }
+
+    for ( unsigned long n = 0; n < reports + 2; n++ ) {
+        for ( size_t i = 0; i < field->length; i++ )
+            report[i] = (n == 0) ? 0x00 : (n == 1) ? 0xFF : (uint8_t) NextRandom();
+        if ( field->reportID )
+            report[0] = field->reportID;
+
+        if ( field->size == 1 ) {
+            // Array buttons on the same page can list the usage too, so
+            // setting the field's bit must add exactly one
+            int pressed, released;
+
+            report[field->startBit / 8] |= 1 << (field->startBit % 8);
+            pressed = CountButton(field, parseData, report);
+            if ( field->extract(report) == 0 )
+                Fail("extract missed a set bit", descriptor->name, field);
+
+            report[field->startBit / 8] &= ~(1 << (field->startBit % 8));
+            released = CountButton(field, parseData, report);
+            if ( field->extract(report) != 0 )
+                Fail("extract found a clear bit", descriptor->name, field);
+
+            if ( pressed < 0 || released < 0 ) {
+                Fail("the parser cannot read the field", descriptor->name, field);
+                return;
+            }
+            if ( pressed != released + 1 ) {
+                Fail("extract disagrees with the parser", descriptor->name, field);
+                return;
+            }
+        } else {
+            SInt32 value = 0;
+
+            if ( HIDGetUsageValue(field->reportType, field->usagePage, 0, field->usage, &value,
+                                  parseData, report, field->length) != kHIDSuccess ) {
+                Fail("the parser cannot read the field", descriptor->name, field);
+                return;
+            }
+            if ( field->extract(report) != value ) {
+                Fail("extract disagrees with the parser", descriptor->name, field);
+                return;
+            }
+        }
+
+        gChecked++;
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    static const uint8_t    kWideField[] = { 0x10, 0x32, 0x54, 0x76, 0x08 };
+    unsigned long           reports = 256;
+    int                     option;
+
+    while ( (option = getopt(argc, argv, "n:s:")) != -1 ) {
+        switch ( option ) {
+            case 'n':
+                reports = strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                gRandom = strtoull(optarg, NULL, 0) | 1;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-n reports] [-s seed]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    // The top bits of a 32 bit field that starts inside a byte come from a
+    // fifth byte
+    if ( unaligned::Field<4, 32, false>::extract(kWideField) != (int32_t) 0x87654321 ) {
+        fprintf(stderr, "FAIL Field<4, 32, false> gave %08X\n", (unsigned) unaligned::Field<4, 32, false>::extract(kWideField));
+        gFailures++;
+    }
+
+    for ( size_t i = 0; i < sizeof(kExtractorDescriptors) / sizeof(kExtractorDescriptors[0]); i++ ) {
+        const ExtractorTableDescriptor *    descriptor = &kExtractorDescriptors[i];
+        HIDPreparsedDataRef                 parseData;
+
+        if ( HIDOpenReportDescriptor((void *) descriptor->bytes, descriptor->length, &parseData, 0) != kHIDSuccess ) {
+            fprintf(stderr, "FAIL %s: cannot open\n", descriptor->name);
+            gFailures++;
+            continue;
+        }
+
+        for ( const ExtractorTableField * field = descriptor->fields; field->extract; field++ ) {
+            if ( !field->duplicate )
+                TestField(descriptor, field, parseData, reports);
+        }
+
+        HIDCloseReportDescriptor(parseData);
+    }
+
+    printf("%lu values checked, %lu failures\n", gChecked, gFailures);
+
+    return gFailures ? 1 : 0;
+}
@@ -0,0 +1,293 @@
+/*
+ * Correctness tests for the bitmap button calls and HIDUsageListDifference.
+ *
+ * - HIDUsageListDifference is compared against the original list-scanning
+ *   implementation on random lists, including zero, duplicate and large
+ *   usages.  The make and break lists must match exactly, order included.
+ * - HIDGetButtonsBitmap is compared against HIDGetButtonsOnPage on random
+ *   reports for the corpus descriptors: same status, and the bitmap holds
+ *   exactly the listed usages.
+ * - HIDUsageBitmapDifference on two such bitmaps must give the same make
+ *   and break sets as HIDUsageListDifference on the two lists.
+ *
+ * usage: HIDUsageBitmapTest [-n iterations] [-s seed]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "HIDLib.h"
+#include "HIDDescriptorCorpus.h"
+
+#define kMaxListLength      96
+#define kBitmapUsages       0x10000     // every usage an array field can hold
+#define kBitmapWords        HIDUsageBitmapWords(kBitmapUsages)
+
+static unsigned long    gFailures   = 0;
+static uint64_t         gRandom     = 0x2545F4914F6CDD1DULL;
+
+static uint32_t NextRandom(void)
+{
+    gRandom ^= gRandom << 13;
+    gRandom ^= gRandom >> 7;
+    gRandom ^= gRandom << 17;
+    return (uint32_t) (gRandom >> 16);
+}
+
+static void Fail(const char * what, unsigned long iteration)
+{
+    gFailures++;
+    if ( gFailures <= 10 )
+        fprintf(stderr, "FAIL iteration %lu: %s\n", iteration, what);
+}
+
+/*
+ * HIDUsageListDifference as it was before the bitmaps.
+ */
+static Boolean ReferenceIsUsageInUsageList(HIDUsage *piUsageList, UInt32 iUsageListLength, HIDUsage usage)
+{
+    unsigned int i;
+    for (i = 0; i < iUsageListLength; i++)
+        if (piUsageList[i] == usage)
+            return true;
+    return false;
+}
+
+static void ReferenceUsageListDifference(HIDUsage *piPreviousUL, HIDUsage *piCurrentUL, HIDUsage *piBreakUL, HIDUsage *piMakeUL, UInt32 iUsageListLength)
+{
+    UInt32 i;
+    HIDUsage usage;
+    UInt32 iBreakLength=0;
+    UInt32 iMakeLength=0;
+    for (i = 0; i < iUsageListLength; i++)
+    {
+        usage = piCurrentUL[i];
+        if ((usage != 0) && (!ReferenceIsUsageInUsageList(piPreviousUL,iUsageListLength,usage))
+                          && (!ReferenceIsUsageInUsageList(piMakeUL,iMakeLength,usage)))
+            piMakeUL[iMakeLength++] = usage;
+        usage = piPreviousUL[i];
+        if ((usage != 0) && (!ReferenceIsUsageInUsageList(piCurrentUL,iUsageListLength,usage))
+                          && (!ReferenceIsUsageInUsageList(piBreakUL,iBreakLength,usage)))
+            piBreakUL[iBreakLength++] = usage;
+    }
+    while (iMakeLength < iUsageListLength)
+        piMakeUL[iMakeLength++] = 0;
+    while (iBreakLength < iUsageListLength)
+        piBreakUL[iBreakLength++] = 0;
+}
+
+static HIDUsage RandomUsage(const HIDUsage * list, UInt32 length)
+{
+    switch ( NextRandom() % 8 ) {
+        case 0:
+            return 0;
+        case 1:     // a duplicate of an earlier entry
+            return length ? list[NextRandom() % length] : 0;
+        case 2:     // past the first 256
+            return 256 + NextRandom() % 0x10000;
+        case 3:
+            return NextRandom();
+        default:    // a small range, so the lists overlap
+            return NextRandom() % 48;
+    }
+}
+
+static void TestUsageListDifference(unsigned long iterations)
+{
+    HIDUsage        previous[kMaxListLength];
+    HIDUsage        current[kMaxListLength];
+    HIDUsage        breaks[kMaxListLength], makes[kMaxListLength];
+    HIDUsage        referenceBreaks[kMaxListLength], referenceMakes[kMaxListLength];
+    unsigned long   iteration;
+    UInt32          length;
+    UInt32          i;
+
+    for ( iteration = 0; iteration < iterations; iteration++ ) {
+        length = NextRandom() % (kMaxListLength + 1);
+
+        for ( i = 0; i < length; i++ ) {
+            previous[i] = RandomUsage(previous, i);
+            current[i] = (NextRandom() % 2) ? RandomUsage(previous, length) : RandomUsage(current, i);
+        }
+
+        // Garbage in the outputs must not leak into the result.
+        memset(makes, 0xA5, sizeof(makes));
+        memset(breaks, 0x5A, sizeof(breaks));
+        memset(referenceMakes, 0, sizeof(referenceMakes));
+        memset(referenceBreaks, 0, sizeof(referenceBreaks));
+
+        if ( HIDUsageListDifference(previous, current, breaks, makes, length) != kHIDSuccess ) {
+            Fail("HIDUsageListDifference status", iteration);
+            continue;
+        }
+        ReferenceUsageListDifference(previous, current, referenceBreaks, referenceMakes, length);
+
+        if ( memcmp(makes, referenceMakes, length * sizeof(HIDUsage)) != 0 )
+            Fail("HIDUsageListDifference make list", iteration);
+        if ( memcmp(breaks, referenceBreaks, length * sizeof(HIDUsage)) != 0 )
+            Fail("HIDUsageListDifference break list", iteration);
+    }
+}
+
+typedef struct {
+    const HIDCorpusDescriptor * descriptor;
+    HIDReportType               reportType;
+    UInt8                       reportID;
+    HIDUsage                    usagePage;
+} ButtonCase;
+
+static OSStatus GetButtons(const ButtonCase * test, HIDPreparsedDataRef parseData, UInt8 * report,
+                           IOByteCount reportLength, HIDUsage * list, UInt32 * listLength, UInt32 * bitmap,
+                           OSStatus * bitmapStatus)
+{
+    UInt32 capacity = *listLength;
+
+    *bitmapStatus = HIDGetButtonsBitmap(test->reportType, test->usagePage, 0, bitmap, kBitmapUsages,
+                                        parseData, report, reportLength);
+
+    memset(list, 0, capacity * sizeof(HIDUsage));
+    return HIDGetButtonsOnPage(test->reportType, test->usagePage, 0, list, listLength,
+                               parseData, report, reportLength);
+}
+
+static int BitmapMatchesList(const UInt32 * bitmap, const HIDUsage * list, UInt32 length)
+{
+    UInt32 expected[kBitmapWords];
+    UInt32 i;
+
+    memset(expected, 0, sizeof(expected));
+    for ( i = 0; i < length; i++ ) {
+        if ( list[i] >= kBitmapUsages )
+            return 0;
+        HIDSetUsageBit(expected, list[i]);
+    }
+
+    return memcmp(expected, bitmap, sizeof(expected)) == 0;
+}
+
+static void TestButtons(const ButtonCase * test, unsigned long iterations)
+{
+    HIDPreparsedDataRef parseData;
+    IOByteCount         reportLength;
+    UInt8               reports[2][64];
+    HIDUsage            lists[2][kMaxListLength];
+    HIDUsage            makes[kMaxListLength], breaks[kMaxListLength];
+    UInt32              bitmaps[2][kBitmapWords];
+    UInt32              makeBitmap[kBitmapWords], breakBitmap[kBitmapWords];
+    UInt32              listLength[2];
+    UInt32              maxLength;
+    unsigned long       iteration;
+    unsigned            which;
+    UInt32              i;
+
+    if ( HIDOpenReportDescriptor((void *) test->descriptor->bytes, test->descriptor->length, &parseData, 0) != kHIDSuccess
+      || HIDGetReportLength(test->reportType, test->reportID, &reportLength, parseData) != kHIDSuccess
+      || reportLength > sizeof(reports[0]) ) {
+        fprintf(stderr, "FAIL %s: cannot set up\n", test->descriptor->name);
+        gFailures++;
+        return;
+    }
+
+    maxLength = HIDMaxUsageListLength(test->reportType, test->usagePage, parseData);
+    if ( maxLength > kMaxListLength )
+        maxLength = kMaxListLength;
+
+    for ( iteration = 0; iteration < iterations; iteration++ ) {
+        OSStatus listStatus[2];
+        OSStatus bitmapStatus[2];
+
+        for ( which = 0; which < 2; which++ ) {
+            UInt8 * report = reports[which];
+
+            for ( i = 0; i < reportLength; i++ ) {
+                // Mostly small values so that arrays hold real, repeated and zero usages.
+                report[i] = (UInt8) ((NextRandom() % 4) ? NextRandom() % 8 : NextRandom());
+            }
+            if ( test->reportID )
+                report[0] = test->reportID;
+
+            listLength[which] = maxLength;
+            listStatus[which] = GetButtons(test, parseData, report, reportLength, lists[which],
+                                           &listLength[which], bitmaps[which], &bitmapStatus[which]);
+
+            if ( listStatus[which] != bitmapStatus[which] )
+                Fail("HIDGetButtonsBitmap status", iteration);
+            else if ( (listStatus[which] == kHIDSuccess)
+                   && !BitmapMatchesList(bitmaps[which], lists[which], listLength[which]) )
+                Fail("HIDGetButtonsBitmap bits", iteration);
+        }
+
+        if ( (listStatus[0] != kHIDSuccess) || (listStatus[1] != kHIDSuccess) )
+            continue;
+
+        // Both lists are padded with zeros, which the difference skips.
+        HIDUsageListDifference(lists[0], lists[1], breaks, makes, maxLength);
+        HIDUsageBitmapDifference(bitmaps[0], bitmaps[1], breakBitmap, makeBitmap, kBitmapUsages);
+
+        for ( i = 0; i < maxLength && makes[i]; i++ ) {}
+        if ( !BitmapMatchesList(makeBitmap, makes, i) )
+            Fail("HIDUsageBitmapDifference make set", iteration);
+
+        for ( i = 0; i < maxLength && breaks[i]; i++ ) {}
+        if ( !BitmapMatchesList(breakBitmap, breaks, i) )
+            Fail("HIDUsageBitmapDifference break set", iteration);
+    }
+
+    HIDCloseReportDescriptor(parseData);
+}
+
+static void TestBitmapDifferenceSkipsZero(void)
+{
+    UInt32 previous[kBitmapWords], current[kBitmapWords];
+    UInt32 makes[kBitmapWords], breaks[kBitmapWords];
+
+    memset(previous, 0, sizeof(previous));
+    memset(current, 0, sizeof(current));
+    HIDSetUsageBit(current, 0);
+    HIDSetUsageBit(current, 4);
+    HIDSetUsageBit(previous, 5);
+
+    HIDUsageBitmapDifference(previous, current, breaks, makes, kBitmapUsages);
+
+    if ( HIDTestUsageBit(makes, 0) || !HIDTestUsageBit(makes, 4) || !HIDTestUsageBit(breaks, 5)
+      || HIDTestUsageBit(breaks, 4) || HIDTestUsageBit(makes, 5) )
+        Fail("HIDUsageBitmapDifference usage zero", 0);
+}
+
+int main(int argc, char ** argv)
+{
+    const ButtonCase cases[] = {
+        { &kHIDCorpus[0], kHIDInputReport,   0, kHIDPage_KeyboardOrKeypad },
+        { &kHIDCorpus[0], kHIDOutputReport,  0, kHIDPage_LEDs },
+        { &kHIDCorpus[1], kHIDInputReport,   0, kHIDPage_Button },
+        { &kHIDCorpus[2], kHIDInputReport,   1, kHIDPage_Button },
+        { &kHIDCorpus[4], kHIDInputReport,   4, kHIDPage_Consumer },
+    };
+    unsigned long   iterations  = 200000;
+    unsigned        i;
+    int             option;
+
+    while ( (option = getopt(argc, argv, "n:s:")) != -1 ) {
+        switch ( option ) {
+            case 'n':
+                iterations = strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                gRandom = strtoull(optarg, NULL, 0) | 1;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-n iterations] [-s seed]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    TestBitmapDifferenceSkipsZero();
+    TestUsageListDifference(iterations);
+    for ( i = 0; i < sizeof(cases) / sizeof(cases[0]); i++ )
+        TestButtons(&cases[i], iterations / 10);
+
+    printf("%lu failures\n", gFailures);
+
+    return gFailures ? 1 : 0;
+}
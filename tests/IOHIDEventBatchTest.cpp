@@ -0,0 +1,297 @@
+/*
+ * Tests for IOHIDEvent::batchEvent and appendBatchSample.
+ *
+ * - A batch takes exactly maxSamples samples of its type, and rejects
+ *   samples of another type or size, and samples once it is full.
+ * - Events that are not batches reject samples.
+ * - Vendor defined samples carry their payload, and only payloads of the
+ *   length the batch was created for fit.
+ * - Each sample is serialized with its time stamp and event data, and the
+ *   batch's getLength follows every append.
+ * - A batch survives a withBytes round trip unchanged.
+ * - A batch appended to a parent grows the parent's length as samples
+ *   are added.
+ *
+ * usage: IOHIDEventBatchTest [-n iterations] [-s seed]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <IOKit/IOLib.h>
+#include "IOHIDEvent.h"
+#include "IOHIDEventData.h"
+
+#define kMaxPayload     32
+
+static unsigned long    gFailures   = 0;
+static UInt64           gRandom     = 0x2545F4914F6CDD1DULL;
+
+static UInt32 NextRandom(void)
+{
+    gRandom ^= gRandom << 13;
+    gRandom ^= gRandom >> 7;
+    gRandom ^= gRandom << 17;
+    return (UInt32) (gRandom >> 16);
+}
+
+static void Fail(const char * what, unsigned long iteration)
+{
+    gFailures++;
+    if ( gFailures <= 10 )
+        fprintf(stderr, "FAIL iteration %lu: %s\n", iteration, what);
+}
+
+static AbsoluteTime RandomTimeStamp(void)
+{
+    UInt64          value = ((UInt64) NextRandom() << 32) | NextRandom();
+    AbsoluteTime    timeStamp;
+
+    memcpy(&timeStamp, &value, sizeof(timeStamp));
+    return timeStamp;
+}
+
+static IOHIDEvent * CreateSample(IOHIDEventType type, UInt32 payloadLength)
+{
+    UInt8 payload[kMaxPayload];
+
+    for ( unsigned i = 0; i < sizeof(payload); i++ )
+        payload[i] = (UInt8) NextRandom();
+
+    switch ( type ) {
+        case kIOHIDEventTypeAccelerometer:
+            return IOHIDEvent::accelerometerEvent(RandomTimeStamp(), NextRandom(), NextRandom(), NextRandom(), 0, 0, NextRandom());
+        case kIOHIDEventTypeTemperature:
+            return IOHIDEvent::temperatureEvent(RandomTimeStamp(), NextRandom());
+        default:
+            return IOHIDEvent::vendorDefinedEvent(RandomTimeStamp(), 0xff00, NextRandom() & 0xffff, 0, payload, payloadLength);
+    }
+}
+
+// Serializes event, checking that getLength agrees with readBytes.  The
+// caller frees the result.
+static UInt8 * Serialize(IOHIDEvent * event, IOByteCount * length, unsigned long iteration)
+{
+    UInt8 * bytes;
+
+    *length = event->getLength();
+    bytes   = (UInt8 *) malloc(*length);
+    if ( event->readBytes(bytes, *length) + sizeof(IOHIDSystemQueueElement) != *length )
+        Fail("getLength disagrees with readBytes", iteration);
+
+    return bytes;
+}
+
+// Checks that the serialized batch holds exactly the given samples.
+static void CheckBatch(IOHIDEvent * batchEvent, IOHIDEvent ** samples, UInt32 count, unsigned long iteration)
+{
+    IOByteCount                     length;
+    UInt8 *                         bytes   = Serialize(batchEvent, &length, iteration);
+    IOHIDSystemQueueElement *       element = (IOHIDSystemQueueElement *) bytes;
+    IOHIDVendorDefinedEventData *   event   = (IOHIDVendorDefinedEventData *) element->payload;
+    IOHIDEventBatchData *           batch   = (IOHIDEventBatchData *) event->data;
+
+    if ( element->eventCount != 1 || event->type != kIOHIDEventTypeVendorDefined || event->version != kIOHIDEventBatchVersion ) {
+        Fail("batch header", iteration);
+        free(bytes);
+        return;
+    }
+
+    if ( batch->sampleCount != count ||
+         event->length != sizeof(IOHIDEventBatchData) + count * batch->sampleStride ||
+         event->size != sizeof(IOHIDVendorDefinedEventData) + event->length ||
+         length != sizeof(IOHIDSystemQueueElement) + event->size )
+        Fail("batch sizes", iteration);
+
+    for ( UInt32 i = 0; i < count && i < batch->sampleCount; i++ ) {
+        IOHIDEventBatchSample * entry       = IOHIDEventBatchGetSample(batch, i);
+        AbsoluteTime            timeStamp   = samples[i]->getTimeStamp();
+        IOByteCount             sampleLength;
+        UInt8 *                 sampleBytes = Serialize(samples[i], &sampleLength, iteration);
+        IOHIDEventData *        sampleData  = (IOHIDEventData *) ((IOHIDSystemQueueElement *) sampleBytes)->payload;
+
+        if ( memcmp(&entry->timeStamp, &timeStamp, sizeof(entry->timeStamp)) != 0 )
+            Fail("sample time stamp", iteration);
+        if ( entry->type != batch->sampleType || sampleData->size + sizeof(uint64_t) != batch->sampleStride ||
+             memcmp(IOHIDEventBatchGetSampleData(entry), sampleData, sampleData->size) != 0 )
+            Fail("sample data", iteration);
+
+        free(sampleBytes);
+    }
+
+    free(bytes);
+}
+
+static void TestRejectedSamples(void)
+{
+    IOHIDEvent *    keyboard    = IOHIDEvent::keyboardEvent(RandomTimeStamp(), 7, 4, true);
+    IOHIDEvent *    vendor      = CreateSample(kIOHIDEventTypeVendorDefined, 8);
+    IOHIDEvent *    sample      = CreateSample(kIOHIDEventTypeAccelerometer, 0);
+    IOHIDEvent *    batch;
+
+    // Only batches take samples.
+    if ( keyboard->appendBatchSample(sample) || vendor->appendBatchSample(sample) )
+        Fail("event that is not a batch took a sample", 0);
+
+    // Types without a layout, and empty batches, can't be batched.
+    if ( (batch = IOHIDEvent::batchEvent(RandomTimeStamp(), 0xff00, 1, kIOHIDEventTypeCount, 4)) ) {
+        Fail("batch of a type without a layout", 0);
+        batch->release();
+    }
+    if ( (batch = IOHIDEvent::batchEvent(RandomTimeStamp(), 0xff00, 1, kIOHIDEventTypeAccelerometer, 0)) ) {
+        Fail("batch without samples", 0);
+        batch->release();
+    }
+    if ( (batch = IOHIDEvent::batchEvent(RandomTimeStamp(), 0xff00, 1, kIOHIDEventTypeVendorDefined, 0x10000, 0x10000)) ) {
+        Fail("batch larger than the event size limit", 0);
+        batch->release();
+    }
+
+    // A batch does not take a batch.
+    batch = IOHIDEvent::batchEvent(RandomTimeStamp(), 0xff00, 1, kIOHIDEventTypeVendorDefined, 4, 8);
+    if ( !batch || !batch->appendBatchSample(vendor) ) {
+        Fail("vendor batch", 0);
+    } else {
+        IOHIDEvent * inner = IOHIDEvent::batchEvent(RandomTimeStamp(), 0xff00, 1, kIOHIDEventTypeAccelerometer, 1);
+
+        if ( batch->appendBatchSample(inner) || batch->appendBatchSample(batch) || batch->appendBatchSample(NULL) )
+            Fail("batch took a batch", 0);
+        inner->release();
+    }
+
+    if ( batch )
+        batch->release();
+    sample->release();
+    vendor->release();
+    keyboard->release();
+}
+
+static void TestBatch(unsigned long iteration)
+{
+    static const IOHIDEventType kTypes[] = { kIOHIDEventTypeAccelerometer, kIOHIDEventTypeTemperature, kIOHIDEventTypeVendorDefined };
+    IOHIDEventType  type            = kTypes[NextRandom() % 3];
+    UInt32          maxSamples      = 1 + NextRandom() % 16;
+    UInt32          payloadLength   = ( type == kIOHIDEventTypeVendorDefined ) ? NextRandom() % kMaxPayload : 0;
+    UInt32          dataLength      = 0;
+    IOHIDEvent *    samples[16];
+    IOHIDEvent *    parent          = NULL;
+    IOHIDEvent *    batch;
+    IOHIDEvent *    other;
+    IOHIDEvent *    copy;
+    IOByteCount     parentLength    = 0;
+    IOByteCount     length, copyLength;
+    UInt8 *         bytes;
+    UInt8 *         copyBytes;
+    UInt32          count;
+
+    // Sized from the sample, as dispatchBatchedEvent does; vendor payloads
+    // are padded to at least 4 bytes.
+    if ( type == kIOHIDEventTypeVendorDefined ) {
+        other       = CreateSample(type, payloadLength);
+        dataLength  = (UInt32) other->getIntegerValue(kIOHIDEventFieldVendorDefinedDataLength);
+        other->release();
+    }
+
+    batch = IOHIDEvent::batchEvent(RandomTimeStamp(), 0xff00, 3, type, maxSamples, dataLength);
+    if ( !batch ) {
+        Fail("batchEvent", iteration);
+        return;
+    }
+
+    // Half the batches are appended to a parent before they fill up.
+    if ( NextRandom() % 2 ) {
+        parent = IOHIDEvent::keyboardEvent(RandomTimeStamp(), 7, 4, true);
+        parent->appendChild(batch);
+        parentLength = parent->getLength();
+    }
+
+    CheckBatch(batch, samples, 0, iteration);
+
+    for ( count = 0; count < maxSamples; count++ ) {
+        IOByteCount before = batch->getLength();
+
+        samples[count] = CreateSample(type, payloadLength);
+
+        // A sample of another type, or another payload length, never fits.
+        other = ( type == kIOHIDEventTypeVendorDefined ) ?
+                CreateSample(type, ( dataLength >= 16 ) ? dataLength - 4 - NextRandom() % 4 : dataLength + 4 + NextRandom() % 4) :
+                CreateSample(( type == kIOHIDEventTypeTemperature ) ? kIOHIDEventTypeAccelerometer : kIOHIDEventTypeTemperature, 0);
+        if ( batch->appendBatchSample(other) )
+            Fail("batch took a mismatched sample", iteration);
+        other->release();
+
+        if ( !batch->appendBatchSample(samples[count]) ) {
+            Fail("batch rejected a sample", iteration);
+            samples[count]->release();
+            break;
+        }
+
+        if ( batch->getLength() - before != sizeof(uint64_t) + samples[count]->getLength() - sizeof(IOHIDSystemQueueElement) )
+            Fail("batch length did not grow by one sample", iteration);
+    }
+
+    // Full
+    other = CreateSample(type, payloadLength);
+    if ( batch->appendBatchSample(other) )
+        Fail("full batch took a sample", iteration);
+    other->release();
+
+    CheckBatch(batch, samples, count, iteration);
+
+    if ( parent ) {
+        IOByteCount grown = batch->getLength() - (sizeof(IOHIDSystemQueueElement) + sizeof(IOHIDVendorDefinedEventData) + sizeof(IOHIDEventBatchData));
+
+        if ( parent->getLength() != parentLength + grown )
+            Fail("parent length did not follow the batch", iteration);
+
+        free(Serialize(parent, &length, iteration));
+    }
+
+    // withBytes round trip
+    bytes = Serialize(parent ? parent : batch, &length, iteration);
+    if ( !(copy = IOHIDEvent::withBytes(bytes, length)) ) {
+        Fail("withBytes", iteration);
+    } else {
+        copyBytes = Serialize(copy, &copyLength, iteration);
+        if ( copyLength != length || memcmp(bytes, copyBytes, length) != 0 )
+            Fail("round trip changed the bytes", iteration);
+        free(copyBytes);
+        copy->release();
+    }
+    free(bytes);
+
+    for ( UInt32 i = 0; i < count; i++ )
+        samples[i]->release();
+    if ( parent )
+        parent->release();
+    batch->release();
+}
+
+int main(int argc, char ** argv)
+{
+    unsigned long   iterations  = 20000;
+    int             option;
+
+    while ( (option = getopt(argc, argv, "n:s:")) != -1 ) {
+        switch ( option ) {
+            case 'n':
+                iterations = strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                gRandom = strtoull(optarg, NULL, 0) | 1;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-n iterations] [-s seed]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    TestRejectedSamples();
+
+    for ( unsigned long i = 0; i < iterations; i++ )
+        TestBatch(i);
+
+    printf("%lu failures\n", gFailures);
+
+    return gFailures ? 1 : 0;
+}
@@ -0,0 +1,286 @@
+/*
+ * Round trip and robustness tests for IOHIDEvent::withBytes and
+ * IOHIDEventView.
+ *
+ * - Random event trees are serialized with readBytes, rebuilt with
+ *   withBytes and serialized again.  The two serializations must be
+ *   identical, and an IOHIDEventView over the bytes must see the same
+ *   events.
+ * - Events of every type whose layout has no known size, and events
+ *   smaller than the common header, must be rejected.
+ * - Serialized trees with random bytes changed, and truncated ones, are
+ *   handed to withBytes and IOHIDEventView.  Whatever they accept must be
+ *   internally consistent.  Build with -fsanitize=address to also catch
+ *   out of bounds accesses.
+ *
+ * usage: IOHIDEventBytesTest [-n iterations] [-s seed]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <IOKit/IOLib.h>
+#include "IOHIDEvent.h"
+#include "IOHIDEventData.h"
+
+static unsigned long    gFailures   = 0;
+static UInt64           gRandom     = 0x2545F4914F6CDD1DULL;
+
+static UInt32 NextRandom(void)
+{
+    gRandom ^= gRandom << 13;
+    gRandom ^= gRandom >> 7;
+    gRandom ^= gRandom << 17;
+    return (UInt32) (gRandom >> 16);
+}
+
+static void Fail(const char * what, unsigned long iteration)
+{
+    gFailures++;
+    if ( gFailures <= 10 )
+        fprintf(stderr, "FAIL iteration %lu: %s\n", iteration, what);
+}
+
+static IOHIDEvent * CreateEvent(void)
+{
+    AbsoluteTime    timeStamp = mach_absolute_time();
+    UInt8           data[48];
+
+    for ( unsigned i = 0; i < sizeof(data); i++ )
+        data[i] = (UInt8) NextRandom();
+
+    switch ( NextRandom() % 6 ) {
+        case 0:
+            return IOHIDEvent::keyboardEvent(timeStamp, 7, NextRandom() & 0xff, NextRandom() & 1);
+        case 1:
+            return IOHIDEvent::translationEvent(timeStamp, NextRandom(), NextRandom(), NextRandom());
+        case 2:
+            return IOHIDEvent::vendorDefinedEvent(timeStamp, 0xff00, NextRandom() & 0xffff, 0, data, 1 + NextRandom() % sizeof(data));
+        case 3:
+            return IOHIDEvent::temperatureEvent(timeStamp, NextRandom());
+        case 4:
+            return IOHIDEvent::multiAxisPointerEvent(timeStamp, NextRandom(), NextRandom(), NextRandom(), 0, 0, 0, NextRandom() & 7);
+        default:
+            return IOHIDEvent::digitizerEvent(timeStamp, NextRandom() & 0xf, kIOHIDDigitizerTransducerTypeFinger, true, 0, NextRandom(), NextRandom());
+    }
+}
+
+static void AddChildren(IOHIDEvent * event, unsigned depth)
+{
+    unsigned count = ( depth < 4 ) ? NextRandom() % 4 : 0;
+
+    for ( unsigned i = 0; i < count; i++ ) {
+        IOHIDEvent * child = CreateEvent();
+
+        AddChildren(child, depth + 1);
+        event->appendChild(child);
+        child->release();
+    }
+}
+
+static UInt8 * Serialize(IOHIDEvent * event, IOByteCount * length)
+{
+    UInt8 * bytes;
+
+    *length = event->getLength();
+    bytes   = (UInt8 *) malloc(*length);
+    if ( event->readBytes(bytes, *length) + sizeof(IOHIDSystemQueueElement) != *length ) {
+        free(bytes);
+        return NULL;
+    }
+
+    return bytes;
+}
+
+static void TestRoundTrip(unsigned long iteration)
+{
+    IOHIDEvent *    event   = CreateEvent();
+    IOHIDEvent *    copy;
+    UInt8 *         bytes;
+    UInt8 *         copyBytes;
+    IOByteCount     length, copyLength;
+    IOHIDEventView  view;
+
+    AddChildren(event, 0);
+    event->setSenderID(((UInt64) NextRandom() << 32) | NextRandom());
+
+    if ( !(bytes = Serialize(event, &length)) ) {
+        Fail("serialize", iteration);
+        event->release();
+        return;
+    }
+
+    if ( !(copy = IOHIDEvent::withBytes(bytes, length)) ) {
+        Fail("withBytes", iteration);
+    } else {
+        if ( !(copyBytes = Serialize(copy, &copyLength)) )
+            Fail("serialize copy", iteration);
+        else if ( copyLength != length || memcmp(bytes, copyBytes, length) != 0 )
+            Fail("round trip changed the bytes", iteration);
+
+        free(copyBytes);
+        copy->release();
+    }
+
+    if ( !view.initWithBytes(bytes, length) ) {
+        Fail("view", iteration);
+    } else {
+        const IOHIDSystemQueueElement * element = (const IOHIDSystemQueueElement *) bytes;
+        const IOHIDEventData *          eventData;
+        IOByteCount                     offset  = 0;
+        UInt32                          count   = 0;
+
+        if ( view.getEventCount() != element->eventCount || view.getSenderID() != element->senderID )
+            Fail("view header", iteration);
+
+        while ( (eventData = view.getNextEvent(&offset)) ) {
+            if ( (const UInt8 *) eventData != &element->payload[offset - eventData->size] )
+                Fail("view event order", iteration);
+            count++;
+        }
+
+        if ( count != element->eventCount || offset != length - sizeof(IOHIDSystemQueueElement) )
+            Fail("view events", iteration);
+    }
+
+    free(bytes);
+    event->release();
+}
+
+// A single event of the given type and size, with no type data.  size is
+// at most 128.
+static bool AcceptsEvent(IOHIDEventType type, UInt32 size)
+{
+    UInt8                       bytes[sizeof(IOHIDSystemQueueElement) + 128 + sizeof(IOHIDEventData)];
+    IOHIDSystemQueueElement *   element = (IOHIDSystemQueueElement *) bytes;
+    IOHIDEventData *            data    = (IOHIDEventData *) element->payload;
+    IOHIDEvent *                event;
+    IOHIDEventView              view;
+    bool                        viewAccepts;
+
+    memset(bytes, 0, sizeof(bytes));
+    element->eventCount = 1;
+    data->type          = type;
+    data->size          = size;
+
+    // The buffer always has room for the common header past the event.
+    viewAccepts = view.initWithBytes(bytes, sizeof(bytes));
+    event       = IOHIDEvent::withBytes(bytes, sizeof(bytes));
+
+    if ( (event != NULL) != viewAccepts )
+        Fail("withBytes and the view disagree", 0);
+
+    if ( event )
+        event->release();
+
+    return viewAccepts;
+}
+
+static void TestRejectedEvents(void)
+{
+    for ( UInt32 type = 0; type < kIOHIDEventTypeCount; type++ ) {
+        size_t typeSize = 0;
+
+        IOHIDEventGetSize(type, typeSize);
+
+        if ( !typeSize ) {
+            if ( AcceptsEvent(type, 4) )
+                Fail("event of a type without a layout accepted", type);
+            if ( AcceptsEvent(type, 8) )
+                Fail("event of a type without a layout accepted", type);
+            if ( AcceptsEvent(type, sizeof(IOHIDEventData)) )
+                Fail("event of a type without a layout accepted", type);
+            continue;
+        }
+
+        if ( AcceptsEvent(type, 8) )
+            Fail("event smaller than the header accepted", type);
+        if ( AcceptsEvent(type, typeSize - 1) )
+            Fail("event smaller than its type accepted", type);
+        if ( !AcceptsEvent(type, typeSize) )
+            Fail("event of its type's size rejected", type);
+    }
+}
+
+static void TestDamagedBytes(unsigned long iteration)
+{
+    IOHIDEvent *    event   = CreateEvent();
+    IOHIDEvent *    copy;
+    UInt8 *         bytes;
+    UInt8 *         copyBytes;
+    IOByteCount     length, copyLength;
+    IOHIDEventView  view;
+
+    AddChildren(event, 0);
+
+    if ( !(bytes = Serialize(event, &length)) ) {
+        event->release();
+        return;
+    }
+
+    // Damage the sizes, types and depths as often as the contents.
+    for ( unsigned i = 1 + NextRandom() % 4; i; i-- ) {
+        IOByteCount offset = NextRandom() % length;
+
+        if ( NextRandom() % 2 )
+            bytes[offset] = (UInt8) NextRandom();
+        else
+            bytes[offset] ^= 1 << (NextRandom() % 8);
+    }
+    if ( NextRandom() % 4 == 0 )
+        length = NextRandom() % length;
+
+    // Copy into an exactly sized buffer so overruns can be caught.
+    UInt8 * exact = (UInt8 *) malloc(length ? length : 1);
+    memcpy(exact, bytes, length);
+    free(bytes);
+
+    view.initWithBytes(exact, length);
+
+    if ( (copy = IOHIDEvent::withBytes(exact, length)) ) {
+        if ( (copyBytes = Serialize(copy, &copyLength)) ) {
+            IOHIDSystemQueueElement * element = (IOHIDSystemQueueElement *) copyBytes;
+
+            if ( !view.initWithBytes(copyBytes, copyLength) || view.getEventCount() != element->eventCount )
+                Fail("rebuilt event does not serialize consistently", iteration);
+            free(copyBytes);
+        } else {
+            Fail("rebuilt event does not serialize", iteration);
+        }
+        copy->release();
+    }
+
+    free(exact);
+    event->release();
+}
+
+int main(int argc, char ** argv)
+{
+    unsigned long   iterations  = 20000;
+    int             option;
+
+    while ( (option = getopt(argc, argv, "n:s:")) != -1 ) {
+        switch ( option ) {
+            case 'n':
+                iterations = strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                gRandom = strtoull(optarg, NULL, 0) | 1;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-n iterations] [-s seed]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    TestRejectedEvents();
+
+    for ( unsigned long i = 0; i < iterations; i++ ) {
+        TestRoundTrip(i);
+        TestDamagedBytes(i);
+    }
+
+    printf("%lu failures\n", gFailures);
+
+    return gFailures ? 1 : 0;
+}
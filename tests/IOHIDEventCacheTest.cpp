@@ -0,0 +1,219 @@
+/*
+ * Stress test for the IOHIDEvent object and payload caches.
+ *
+ * Several threads create, retype, nest and release events of every cached
+ * size class and of uncached sizes at the same time.  Each event is filled
+ * with values unique to its thread and checked before release, so a block
+ * handed to two owners shows up as a mismatch.  The IOFree shim aborts if a
+ * block is freed with a size other than the one it was allocated with,
+ * which catches payloads filed in the wrong size class.
+ *
+ * After main returns, the cache teardown runs as a static destructor, and
+ * a final check requires every allocation to have been freed.
+ *
+ * usage: IOHIDEventCacheTest [-n iterations-per-thread] [-t threads]
+ */
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <IOKit/IOLib.h>
+#include "IOHIDEvent.h"
+#include "IOHIDEventData.h"
+#include "IOHIDUsageTables.h"
+
+static unsigned long    gIterations = 100000;
+static unsigned long    gFailures   = 0;
+
+static void Fail(const char * what, unsigned thread)
+{
+    if ( __atomic_add_fetch(&gFailures, 1, __ATOMIC_RELAXED) <= 10 )
+        fprintf(stderr, "FAIL thread %u: %s\n", thread, what);
+}
+
+struct Worker {
+    unsigned    index;
+    UInt64      random;
+};
+
+static UInt32 NextRandom(Worker * worker)
+{
+    worker->random ^= worker->random << 13;
+    worker->random ^= worker->random >> 7;
+    worker->random ^= worker->random << 17;
+    return (UInt32) (worker->random >> 16);
+}
+
+struct Check {
+    IOHIDEventField field;
+    bool            fixed;
+    SInt32          tag;
+};
+
+static bool Verify(IOHIDEvent * event, const Check * check)
+{
+    if ( check->fixed )
+        return event->getFixedValue(check->field) == check->tag;
+
+    return event->getIntegerValue(check->field) == check->tag;
+}
+
+// Creates an event whose fields all carry tag, and fills in the field used
+// to check it.  Usages are 16 bits, so tags are too.
+static IOHIDEvent * CreateEvent(Worker * worker, SInt32 tag, Check * check)
+{
+    AbsoluteTime    timeStamp   = mach_absolute_time();
+    UInt8           data[96];
+
+    check->tag      = tag;
+    check->fixed    = true;
+
+    switch ( NextRandom(worker) % 6 ) {
+        case 0:
+            check->field = kIOHIDEventFieldKeyboardUsage;
+            check->fixed = false;
+            return IOHIDEvent::keyboardEvent(timeStamp, kHIDPage_KeyboardOrKeypad, tag, true);
+        case 1:
+            check->field = kIOHIDEventFieldTranslationX;
+            return IOHIDEvent::translationEvent(timeStamp, tag, tag, tag);
+        case 2:
+            check->field = kIOHIDEventFieldDigitizerIndex;
+            check->fixed = false;
+            return IOHIDEvent::digitizerEvent(timeStamp, tag, kIOHIDDigitizerTransducerTypeFinger, true, 0, tag, tag);
+        case 3:
+            check->field = kIOHIDEventFieldTemperatureLevel;
+            return IOHIDEvent::temperatureEvent(timeStamp, tag);
+        case 4:
+            // Uncached payload sizes
+            memset(data, tag, sizeof(data));
+            check->field = kIOHIDEventFieldVendorDefinedUsage;
+            check->fixed = false;
+            return IOHIDEvent::vendorDefinedEvent(timeStamp, 0xff00, tag, 0, data, 1 + NextRandom(worker) % sizeof(data));
+        default:
+            check->field = kIOHIDEventFieldMultiAxisPointerX;
+            return IOHIDEvent::multiAxisPointerEvent(timeStamp, tag, tag, tag, tag, tag, tag, 0);
+    }
+}
+
+static void * Run(void * context)
+{
+    Worker *        worker = (Worker *) context;
+    IOHIDEvent *    held[8] = { 0 };
+    Check           heldCheck[8];
+
+    for ( unsigned long i = 0; i < gIterations; i++ ) {
+        unsigned        slot    = NextRandom(worker) % 8;
+        SInt32          tag     = (SInt32) ((worker->index << 12) | (i & 0xfff));
+        Check           check;
+        IOHIDEvent *    event;
+
+        if ( held[slot] ) {
+            if ( !Verify(held[slot], &heldCheck[slot]) )
+                Fail("event changed while held", worker->index);
+            held[slot]->release();
+            held[slot] = 0;
+        }
+
+        if ( !(event = CreateEvent(worker, tag, &check)) ) {
+            Fail("event creation", worker->index);
+            continue;
+        }
+
+        switch ( NextRandom(worker) % 4 ) {
+            case 0: {
+                // Retype in place.  A smaller type keeps the larger payload,
+                // which must still go back to its own size class.
+                event->setType(kIOHIDEventTypeKeyboard);
+                event->setIntegerValue(kIOHIDEventFieldKeyboardUsage, tag);
+                check.field = kIOHIDEventFieldKeyboardUsage;
+                check.fixed = false;
+                break;
+            }
+            case 1: {
+                Check           childCheck;
+                IOHIDEvent *    child = CreateEvent(worker, tag, &childCheck);
+
+                if ( child ) {
+                    event->appendChild(child);
+                    child->release();
+                }
+                break;
+            }
+            default:
+                break;
+        }
+
+        if ( !Verify(event, &check) )
+            Fail("event value", worker->index);
+
+        held[slot]      = event;
+        heldCheck[slot] = check;
+    }
+
+    for ( unsigned slot = 0; slot < 8; slot++ ) {
+        if ( held[slot] )
+            held[slot]->release();
+    }
+
+    return NULL;
+}
+
+// Runs after the static destructors, including the cache teardown.
+__attribute__((destructor)) static void CheckLeaks(void)
+{
+    if ( gIOHostAllocations != gIOHostFrees ) {
+        fprintf(stderr, "FAIL: %llu allocations, %llu frees after teardown\n",
+                (unsigned long long) gIOHostAllocations, (unsigned long long) gIOHostFrees);
+        _exit(1);
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    unsigned    threadCount = 8;
+    pthread_t   threads[15];
+    Worker      workers[15];
+    UInt64      hits        = 0;
+    IOByteCount size;
+    UInt64      cacheHits, cacheMisses;
+    int         option;
+
+    while ( (option = getopt(argc, argv, "n:t:")) != -1 ) {
+        switch ( option ) {
+            case 'n':
+                gIterations = strtoul(optarg, NULL, 0);
+                break;
+            case 't':
+                threadCount = strtoul(optarg, NULL, 0);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-n iterations-per-thread] [-t threads]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    if ( threadCount == 0 || threadCount > 15 )
+        threadCount = 8;
+
+    for ( unsigned i = 0; i < threadCount; i++ ) {
+        workers[i].index    = i + 1;
+        workers[i].random   = 0x9E3779B97F4A7C15ULL * (i + 1);
+        pthread_create(&threads[i], NULL, Run, &workers[i]);
+    }
+    for ( unsigned i = 0; i < threadCount; i++ )
+        pthread_join(threads[i], NULL);
+
+    for ( UInt32 index = 0; IOHIDEvent::getCacheStatistics(index, &size, &cacheHits, &cacheMisses); index++ ) {
+        printf("cache %2u: %4lu bytes, %10llu hits, %8llu misses\n", index, (unsigned long) size,
+               (unsigned long long) cacheHits, (unsigned long long) cacheMisses);
+        hits += cacheHits;
+    }
+
+    if ( hits == 0 )
+        Fail("no cache hits", 0);
+
+    printf("%lu failures\n", gFailures);
+
+    return gFailures ? 1 : 0;
+}
@@ -0,0 +1,341 @@
+/*
+ * Checks the cached length and event count of IOHIDEvent trees.
+ *
+ * A pool of events is put through random appends, including appends that
+ * must be rejected (a child that already has a parent, the event itself,
+ * one of its ancestors), retypes that change payload sizes anywhere in a
+ * tree, and releases.  After every step, each event in the pool is
+ * serialized with readBytes, and its getLength, the header's event count
+ * and the depth of each serialized event must agree with the bytes.
+ *
+ * Digitizer collections of 1 to 20 fingers are checked for the number of
+ * allocations appendChild makes, and for serializing to the same bytes as
+ * the parent followed by each finger on its own.  The time to serialize a
+ * 10 finger collection is printed.
+ *
+ * usage: IOHIDEventTreeTest [-n steps] [-s seed]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <IOKit/IOLib.h>
+#include "IOHIDEvent.h"
+#include "IOHIDEventData.h"
+
+#define kPoolSize   12
+
+static unsigned long    gFailures   = 0;
+static UInt64           gRandom     = 0x2545F4914F6CDD1DULL;
+
+static UInt32 NextRandom(void)
+{
+    gRandom ^= gRandom << 13;
+    gRandom ^= gRandom >> 7;
+    gRandom ^= gRandom << 17;
+    return (UInt32) (gRandom >> 16);
+}
+
+static void Fail(const char * what, unsigned long step)
+{
+    gFailures++;
+    if ( gFailures <= 10 )
+        fprintf(stderr, "FAIL step %lu: %s\n", step, what);
+}
+
+static IOHIDEvent * CreateEvent(void)
+{
+    AbsoluteTime    timeStamp = mach_absolute_time();
+    UInt8           data[40];
+
+    switch ( NextRandom() % 4 ) {
+        case 0:
+            return IOHIDEvent::keyboardEvent(timeStamp, 7, 4, true);
+        case 1:
+            return IOHIDEvent::translationEvent(timeStamp, 1, 2, 3);
+        case 2:
+            memset(data, 0x5a, sizeof(data));
+            return IOHIDEvent::vendorDefinedEvent(timeStamp, 0xff00, 1, 0, data, 1 + NextRandom() % sizeof(data));
+        default:
+            return IOHIDEvent::digitizerEvent(timeStamp, 1, kIOHIDDigitizerTransducerTypeFinger, true, 0, 0, 0);
+    }
+}
+
+// Serializes event and checks the result against its cached length and
+// event count.  Returns the serialized length.
+static IOByteCount CheckEvent(IOHIDEvent * event, unsigned long step)
+{
+    IOByteCount                 length  = event->getLength();
+    UInt8 *                     bytes   = (UInt8 *) malloc(length + 64);
+    IOHIDSystemQueueElement *   element = (IOHIDSystemQueueElement *) bytes;
+    IOByteCount                 payload;
+    IOByteCount                 offset;
+    UInt32                      count   = 0;
+    int                         depth   = -1;
+
+    memset(bytes, 0xee, length + 64);
+
+    payload = event->readBytes(bytes, length);
+    if ( payload + sizeof(IOHIDSystemQueueElement) != length )
+        Fail("getLength disagrees with readBytes", step);
+
+    for ( offset = 0; offset < payload; count++ ) {
+        IOHIDEventData * data = (IOHIDEventData *) &element->payload[offset];
+
+        if ( data->size < sizeof(IOHIDEventData) ) {
+            Fail("bad serialized event", step);
+            break;
+        }
+        if ( (count == 0 && data->depth != 0) || (count && data->depth > depth + 1) )
+            Fail("bad serialized depth", step);
+
+        depth   = data->depth;
+        offset += data->size;
+    }
+
+    if ( offset != payload )
+        Fail("serialized sizes overrun the payload", step);
+    if ( count != element->eventCount )
+        Fail("header event count disagrees with the payload", step);
+
+    // Nothing is written past the end.
+    for ( IOByteCount i = length; i < length + 64; i++ ) {
+        if ( bytes[i] != 0xee ) {
+            Fail("readBytes wrote past getLength", step);
+            break;
+        }
+    }
+
+    free(bytes);
+
+    return payload;
+}
+
+static void TestRejectedAppends(void)
+{
+    IOHIDEvent *    a       = CreateEvent();
+    IOHIDEvent *    b       = CreateEvent();
+    IOHIDEvent *    child   = CreateEvent();
+    IOByteCount     length, childLength;
+
+    a->appendChild(child);
+
+    // A second parent
+    length = b->getLength();
+    b->appendChild(child);
+    if ( b->getLength() != length )
+        Fail("child appended to a second parent", 0);
+
+    // Itself, and its parent
+    length = a->getLength();
+    childLength = child->getLength();
+    a->appendChild(a);
+    child->appendChild(a);
+    if ( a->getLength() != length || child->getLength() != childLength )
+        Fail("event appended to itself or its child", 0);
+
+    CheckEvent(a, 0);
+    CheckEvent(child, 0);
+
+    // Once the parent is gone, the child can be appended again.
+    a->release();
+    length = b->getLength();
+    b->appendChild(child);
+    if ( b->getLength() != length + child->getLength() - sizeof(IOHIDSystemQueueElement) )
+        Fail("orphaned child not appended", 0);
+
+    CheckEvent(b, 0);
+
+    child->release();
+    b->release();
+}
+
+static double Now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static UInt8 * Serialize(IOHIDEvent * event, IOByteCount * length)
+{
+    UInt8 * bytes;
+
+    *length = event->getLength();
+    bytes   = (UInt8 *) malloc(*length);
+    event->readBytes(bytes, *length);
+
+    return bytes;
+}
+
+// Children are kept inline up to kIOHIDEventInlineChildCount, and spill to
+// an array that doubles as it fills.
+static UInt64 ExpectedChildAllocations(UInt32 fingers)
+{
+    UInt64 allocations = 0;
+
+    for ( UInt32 capacity = kIOHIDEventInlineChildCount; capacity < fingers; capacity *= 2 )
+        allocations++;
+
+    return allocations;
+}
+
+static void TestFingerCollection(UInt32 fingers)
+{
+    AbsoluteTime                timeStamp   = mach_absolute_time();
+    IOHIDEvent *                parent      = IOHIDEvent::digitizerEvent(timeStamp, 0, kIOHIDDigitizerTransducerTypeHand, true, 0, 0, 0);
+    IOHIDEvent *                children[32];
+    UInt8 *                     expected;
+    UInt8 *                     actual;
+    UInt8 *                     bytes;
+    IOByteCount                 expectedLength, actualLength, length;
+    IOHIDSystemQueueElement *   element;
+    IOHIDEventData *            data;
+    UInt64                      allocations, frees;
+
+    for ( UInt32 i = 0; i < fingers; i++ )
+        children[i] = IOHIDEvent::digitizerEvent(timeStamp, i, kIOHIDDigitizerTransducerTypeFinger, true, 0, i << 16, i << 17);
+
+    // The parent on its own, then each finger on its own at depth 1
+    bytes = Serialize(parent, &length);
+    expected = (UInt8 *) malloc(length * (fingers + 1));
+    memcpy(expected, bytes, length);
+    expectedLength = length;
+    free(bytes);
+
+    element = (IOHIDSystemQueueElement *) expected;
+    element->eventCount = fingers + 1;
+    ((IOHIDEventData *) element->payload)->options |= kIOHIDEventOptionIsCollection;
+
+    for ( UInt32 i = 0; i < fingers; i++ ) {
+        bytes = Serialize(children[i], &length);
+        data = (IOHIDEventData *) &expected[expectedLength];
+        memcpy(data, ((IOHIDSystemQueueElement *) bytes)->payload, length - sizeof(IOHIDSystemQueueElement));
+        data->depth = 1;
+        expectedLength += length - sizeof(IOHIDSystemQueueElement);
+        free(bytes);
+    }
+
+    frees       = gIOHostFrees;
+    allocations = gIOHostAllocations;
+    for ( UInt32 i = 0; i < fingers; i++ )
+        parent->appendChild(children[i]);
+    allocations = gIOHostAllocations - allocations;
+
+    if ( allocations != ExpectedChildAllocations(fingers) ) {
+        gFailures++;
+        fprintf(stderr, "FAIL %u fingers: %llu allocations for the children, expected %llu\n",
+                fingers, (unsigned long long) allocations, (unsigned long long) ExpectedChildAllocations(fingers));
+    }
+
+    actual = Serialize(parent, &actualLength);
+    if ( actualLength != expectedLength || memcmp(actual, expected, expectedLength) != 0 ) {
+        gFailures++;
+        fprintf(stderr, "FAIL %u fingers: serialized collection differs\n", fingers);
+    }
+
+    if ( fingers == 10 ) {
+        unsigned long   count   = 0;
+        double          start   = Now();
+        double          elapsed;
+
+        do {
+            for ( unsigned i = 0; i < 1000; i++ )
+                parent->readBytes(actual, actualLength);
+            count += 1000;
+            elapsed = Now() - start;
+        } while ( elapsed < 0.05 );
+
+        printf("%u finger collection: %llu allocations for the children, %.1f ns to serialize\n",
+               fingers, (unsigned long long) allocations, elapsed / count * 1e9);
+    }
+
+    free(actual);
+    free(expected);
+
+    for ( UInt32 i = 0; i < fingers; i++ )
+        children[i]->release();
+
+    // The children go with the parent, and so do their arrays, including
+    // the ones freed as they grew.
+    parent->release();
+    if ( gIOHostFrees - frees < ExpectedChildAllocations(fingers) ) {
+        gFailures++;
+        fprintf(stderr, "FAIL %u fingers: child array not freed\n", fingers);
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    IOHIDEvent *    pool[kPoolSize];
+    unsigned long   steps   = 200000;
+    int             option;
+
+    while ( (option = getopt(argc, argv, "n:s:")) != -1 ) {
+        switch ( option ) {
+            case 'n':
+                steps = strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                gRandom = strtoull(optarg, NULL, 0) | 1;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-n steps] [-s seed]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    TestRejectedAppends();
+
+    for ( UInt32 fingers = 1; fingers <= 20; fingers++ )
+        TestFingerCollection(fingers);
+
+    for ( unsigned i = 0; i < kPoolSize; i++ )
+        pool[i] = CreateEvent();
+
+    for ( unsigned long step = 1; step <= steps; step++ ) {
+        IOHIDEvent * event = pool[NextRandom() % kPoolSize];
+
+        switch ( NextRandom() % 8 ) {
+            case 0:
+            case 1:
+            case 2:
+                // Often rejected once the trees grow
+                event->appendChild(pool[NextRandom() % kPoolSize]);
+                break;
+            case 3: {
+                IOHIDEvent * child = CreateEvent();
+
+                event->appendChild(child);
+                child->release();
+                break;
+            }
+            case 4:
+                // Changes the payload size and drops the children
+                event->setType((NextRandom() % 2) ? kIOHIDEventTypeDigitizer : kIOHIDEventTypeKeyboard);
+                break;
+            default: {
+                // Replace a pool entry; it may live on inside another tree.
+                unsigned slot = NextRandom() % kPoolSize;
+
+                if ( NextRandom() % 4 == 0 ) {
+                    pool[slot]->release();
+                    pool[slot] = CreateEvent();
+                }
+                break;
+            }
+        }
+
+        for ( unsigned i = 0; i < kPoolSize; i++ )
+            CheckEvent(pool[i], step);
+    }
+
+    for ( unsigned i = 0; i < kPoolSize; i++ )
+        pool[i]->release();
+
+    printf("%lu failures\n", gFailures);
+
+    return gFailures ? 1 : 0;
+}
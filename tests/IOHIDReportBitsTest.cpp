@@ -0,0 +1,266 @@
+/*
+ * Checks readReportBits, writeReportBits and clearReportBits against the
+ * original routines, which moved one byte (or less) at a time.
+ *
+ * Every field width from 1 to kMaxBits and every start bit from 0 to 63
+ * is tried with several random reports, with and without sign extension.
+ * Reads must produce the same words and the same valueChanged flag, both
+ * when the destination already holds the value and when it doesn't.
+ * Writes must leave the same report bytes behind.
+ *
+ * The target is built twice, once with __LITTLE_ENDIAN__ so the byte copy
+ * paths are covered, and once without so the word paths see wide aligned
+ * fields as well.
+ *
+ * usage: IOHIDReportBitsTest [-n rounds] [-s seed]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "IOHIDReportBits.h"
+
+#define kMaxBits        160
+#define kMaxStartBit    64
+#define kReportBytes    ((kMaxStartBit + kMaxBits) / 8 + 8)
+#define kValueWords     ((kMaxBits + 31) / 32)
+
+static unsigned long    gFailures   = 0;
+static UInt64           gRandom     = 0x9E3779B97F4A7C15ULL;
+
+static UInt32 NextRandom(void)
+{
+    gRandom ^= gRandom << 13;
+    gRandom ^= gRandom >> 7;
+    gRandom ^= gRandom << 17;
+    return (UInt32) (gRandom >> 16);
+}
+
+static void Fail(const char * what, UInt32 bits, UInt32 startBit, bool signExtend)
+{
+    gFailures++;
+    if ( gFailures <= 10 )
+        fprintf(stderr, "FAIL %s: %u bits at %u%s\n", what, bits, startBit, signExtend ? ", sign extended" : "");
+}
+
+//---------------------------------------------------------------------------
+// The original routines.
+
+#define UpdateWordOffsetAndShift(bits, offset, shift)  \
+    do { offset = bits >> 5; shift = bits & 0x1f; } while (0)
+
+static void referenceReadReportBits( const UInt8 * src,
+                           UInt32 *      dst,
+                           UInt32        bitsToCopy,
+                           UInt32        srcStartBit = 0,
+                           bool          shouldSignExtend = false,
+                           bool *        valueChanged = 0)
+{
+    UInt32 srcOffset;
+    UInt32 srcShift;
+    UInt32 dstShift      = 0;
+    UInt32 dstStartBit   = 0;
+    UInt32 dstOffset     = 0;
+    UInt32 lastDstOffset = 0;
+    UInt32 word          = 0;
+    UInt8  bitsProcessed;
+    UInt32 totalBitsProcessed = 0;
+
+    while ( bitsToCopy )
+    {
+        UInt32 tmp;
+
+        UpdateByteOffsetAndShift( srcStartBit, srcOffset, srcShift );
+
+        bitsProcessed = min( bitsToCopy,
+                             min( 8 - srcShift, 32 - dstShift ) );
+
+        tmp = (src[srcOffset] >> srcShift) & BIT_MASK(bitsProcessed);
+
+        word |= ( tmp << dstShift );
+
+        dstStartBit += bitsProcessed;
+        srcStartBit += bitsProcessed;
+        bitsToCopy  -= bitsProcessed;
+        totalBitsProcessed += bitsProcessed;
+
+        UpdateWordOffsetAndShift( dstStartBit, dstOffset, dstShift );
+
+        if ( ( dstOffset != lastDstOffset ) || ( bitsToCopy == 0 ) )
+        {
+            if ((lastDstOffset == 0) && (shouldSignExtend))
+            {
+                if ((totalBitsProcessed < 32) &&
+                    (word & (1U << (totalBitsProcessed - 1))))
+                    word |= ~(BIT_MASK(totalBitsProcessed));
+            }
+
+            if ( dst[lastDstOffset] != word )
+            {
+                dst[lastDstOffset] = word;
+                if (valueChanged) *valueChanged = true;
+            }
+            word = 0;
+            lastDstOffset = dstOffset;
+        }
+    }
+}
+
+static void referenceWriteReportBits( const UInt32 * src,
+                           UInt8 *        dst,
+                           UInt32         bitsToCopy,
+                           UInt32         dstStartBit = 0)
+{
+    UInt32 dstOffset;
+    UInt32 dstShift;
+    UInt32 srcShift    = 0;
+    UInt32 srcStartBit = 0;
+    UInt32 srcOffset   = 0;
+    UInt8  bitsProcessed;
+    UInt32 tmp;
+
+    while ( bitsToCopy )
+    {
+        UpdateByteOffsetAndShift( dstStartBit, dstOffset, dstShift );
+
+        bitsProcessed = min( bitsToCopy,
+                             min( 8 - dstShift, 32 - srcShift ) );
+
+        tmp = (src[srcOffset] >> srcShift) & BIT_MASK(bitsProcessed);
+
+        dst[dstOffset] |= ( tmp << dstShift );
+
+        dstStartBit += bitsProcessed;
+        srcStartBit += bitsProcessed;
+        bitsToCopy  -= bitsProcessed;
+
+        UpdateWordOffsetAndShift( srcStartBit, srcOffset, srcShift );
+    }
+}
+
+static void referenceClearReportBits( UInt8 * dst, UInt32 bitsToClear, UInt32 dstStartBit )
+{
+    for ( UInt32 bit = dstStartBit; bit < dstStartBit + bitsToClear; bit++ )
+        dst[bit >> 3] &= ~(1 << (bit & 0x07));
+}
+
+//---------------------------------------------------------------------------
+
+static void RandomBytes(void * buffer, size_t length)
+{
+    UInt8 * bytes = (UInt8 *) buffer;
+
+    for ( size_t i = 0; i < length; i++ )
+        bytes[i] = (UInt8) NextRandom();
+}
+
+static void CheckRead(const UInt8 * report, UInt32 bits, UInt32 startBit, bool signExtend)
+{
+    UInt32  words = (bits + 31) / 32;
+    UInt32  expected[kValueWords];
+    UInt32  actual[kValueWords];
+    bool    expectedChanged;
+    bool    actualChanged;
+
+    // Into a stale value.
+    RandomBytes(expected, sizeof(expected));
+    memcpy(actual, expected, sizeof(actual));
+    expectedChanged = actualChanged = false;
+
+    referenceReadReportBits(report, expected, bits, startBit, signExtend, &expectedChanged);
+    readReportBits(report, actual, bits, startBit, signExtend, &actualChanged);
+
+    if ( memcmp(expected, actual, words * sizeof(UInt32)) != 0 )
+        Fail("readReportBits value", bits, startBit, signExtend);
+    if ( expectedChanged != actualChanged )
+        Fail("readReportBits valueChanged", bits, startBit, signExtend);
+
+    // Again, into the value just read.
+    expectedChanged = actualChanged = false;
+
+    referenceReadReportBits(report, expected, bits, startBit, signExtend, &expectedChanged);
+    readReportBits(report, actual, bits, startBit, signExtend, &actualChanged);
+
+    if ( expectedChanged || actualChanged )
+        Fail("readReportBits unchanged value", bits, startBit, signExtend);
+
+    // And with one bit of the field flipped.
+    UInt32 flip = NextRandom() % bits;
+    UInt8  flipped[kReportBytes];
+
+    memcpy(flipped, report, sizeof(flipped));
+    flipped[(startBit + flip) >> 3] ^= 1 << ((startBit + flip) & 0x07);
+
+    readReportBits(flipped, actual, bits, startBit, signExtend, &actualChanged);
+    if ( !actualChanged )
+        Fail("readReportBits changed value", bits, startBit, signExtend);
+}
+
+static void CheckWrite(UInt32 bits, UInt32 startBit)
+{
+    UInt32  value[kValueWords];
+    UInt8   expected[kReportBytes];
+    UInt8   actual[kReportBytes];
+
+    // Bits of the value past the field must not reach the report.
+    RandomBytes(value, sizeof(value));
+    RandomBytes(expected, sizeof(expected));
+    memcpy(actual, expected, sizeof(actual));
+
+    referenceClearReportBits(expected, bits, startBit);
+    clearReportBits(actual, bits, startBit);
+
+    if ( memcmp(expected, actual, sizeof(actual)) != 0 )
+        Fail("clearReportBits", bits, startBit, false);
+
+    referenceWriteReportBits(value, expected, bits, startBit);
+    writeReportBits(value, actual, bits, startBit);
+
+    if ( memcmp(expected, actual, sizeof(actual)) != 0 )
+        Fail("writeReportBits", bits, startBit, false);
+}
+
+int main(int argc, char ** argv)
+{
+    unsigned long   rounds  = 4;
+    int             option;
+
+    while ( (option = getopt(argc, argv, "n:s:")) != -1 ) {
+        switch ( option ) {
+            case 'n':
+                rounds = strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                gRandom = strtoull(optarg, NULL, 0) | 1;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-n rounds] [-s seed]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    for ( unsigned long round = 0; round < rounds; round++ ) {
+        for ( UInt32 bits = 1; bits <= kMaxBits; bits++ ) {
+            for ( UInt32 startBit = 0; startBit < kMaxStartBit; startBit++ ) {
+                UInt8 report[kReportBytes];
+
+                RandomBytes(report, sizeof(report));
+
+                CheckRead(report, bits, startBit, false);
+                CheckRead(report, bits, startBit, true);
+                CheckWrite(bits, startBit);
+            }
+        }
+    }
+
+    printf("%s: %lu failures\n",
+#if defined(__LITTLE_ENDIAN__)
+           "little endian",
+#else
+           "word paths only",
+#endif
+           gFailures);
+
+    return gFailures ? 1 : 0;
+}
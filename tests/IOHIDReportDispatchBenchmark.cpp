@@ -0,0 +1,212 @@
+/*
+ * Per-report dispatch cost as the number of report IDs grows.
+ *
+ * IOHIDDevice itself can't be built for the host, so this models the
+ * report handler table: one chain of elements per slot, linked through
+ * their next handler pointer, and a processReport that rejects elements
+ * of other report IDs and reads the field of the ones that match with
+ * readReportBits.  Each device has the given number of report IDs with
+ * the same number of elements in each report, and the elements are
+ * allocated in a random order so that walking a chain misses the cache
+ * the way scattered IOHIDElementPrivate objects do.
+ *
+ * Two tables are compared:
+ *   hashed  - the old 8 slot table, report ID & 7
+ *   direct  - one slot per 8 bit report ID
+ *
+ * For each report ID count this prints nanoseconds per report and the
+ * number of elements visited per report for both tables.
+ *
+ * usage: IOHIDReportDispatchBenchmark [-e elements-per-report] [-t seconds-per-case]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "IOHIDReportBits.h"
+
+#define kReportBytes    64
+
+struct Element {
+    UInt8       reportID;
+    UInt32      reportStartBit;
+    UInt32      reportBits;
+    UInt32      value;
+    Element *   nextReportHandler;
+    UInt8       padding[96];    // roughly the size of the real object
+};
+
+struct Table {
+    UInt32      slots;
+    Element **  head;
+};
+
+static UInt64 gRandom = 0x2545F4914F6CDD1DULL;
+
+static UInt32 NextRandom(void)
+{
+    gRandom ^= gRandom << 13;
+    gRandom ^= gRandom >> 7;
+    gRandom ^= gRandom << 17;
+    return (UInt32) (gRandom >> 16);
+}
+
+static double Now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static inline bool ProcessReport(Element * element, UInt8 reportID, const UInt8 * report, Element ** next)
+{
+    bool changed = false;
+
+    *next = element->nextReportHandler;
+
+    if ( element->reportID != reportID )
+        return false;
+
+    readReportBits(report, &element->value, element->reportBits, element->reportStartBit, false, &changed);
+
+    return changed;
+}
+
+static UInt32 HandleReport(const Table * table, UInt8 reportID, const UInt8 * report, UInt32 * visited)
+{
+    Element *   element = table->head[reportID & (table->slots - 1)];
+    Element *   next;
+    UInt32      changed = 0;
+
+    while ( element ) {
+        changed += ProcessReport(element, reportID, report, &next);
+        (*visited)++;
+        element = next;
+    }
+
+    return changed;
+}
+
+static void BuildTable(Table * table, UInt32 slots, Element ** elements, UInt32 count)
+{
+    table->slots = slots;
+    table->head = (Element **) calloc(slots, sizeof(Element *));
+
+    // Registered in element order, pushed on the front of the chain as
+    // IOHIDDevice does.
+    for ( UInt32 i = 0; i < count; i++ ) {
+        Element ** head = &table->head[elements[i]->reportID & (slots - 1)];
+
+        elements[i]->nextReportHandler = *head;
+        *head = elements[i];
+    }
+}
+
+static double Measure(const Table * table, UInt32 reportIDs, const UInt8 * reports, double seconds, double * visitedPerReport)
+{
+    unsigned long   count   = 0;
+    UInt32          visited = 0;
+    UInt32          changed = 0;
+    double          start   = Now();
+    double          elapsed;
+
+    do {
+        for ( UInt32 i = 0; i < 1024; i++ ) {
+            const UInt8 * report = &reports[(i % 64) * kReportBytes];
+
+            changed += HandleReport(table, (UInt8) (1 + report[0] % reportIDs), report, &visited);
+        }
+        count += 1024;
+        elapsed = Now() - start;
+    } while ( elapsed < seconds );
+
+    *visitedPerReport = (double) visited / count;
+
+    // Keep the work from being thrown away.
+    if ( changed == 0xFFFFFFFF )
+        printf(" ");
+
+    return elapsed / count * 1e9;
+}
+
+int main(int argc, char ** argv)
+{
+    static const UInt32 kReportIDCounts[] = { 1, 2, 4, 8, 16, 32, 48, 64 };
+    UInt32          elementsPerReport   = 8;
+    double          seconds             = 0.2;
+    UInt8           reports[64 * kReportBytes];
+    int             option;
+
+    while ( (option = getopt(argc, argv, "e:t:")) != -1 ) {
+        switch ( option ) {
+            case 'e':
+                elementsPerReport = strtoul(optarg, NULL, 0);
+                break;
+            case 't':
+                seconds = strtod(optarg, NULL);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-e elements-per-report] [-t seconds-per-case]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    if ( elementsPerReport == 0 || elementsPerReport > (kReportBytes - 1) ) {
+        fprintf(stderr, "elements per report must be 1 to %d\n", kReportBytes - 1);
+        return 2;
+    }
+
+    for ( UInt32 i = 0; i < sizeof(reports); i++ )
+        reports[i] = (UInt8) NextRandom();
+
+    printf("%d elements per report\n", elementsPerReport);
+    printf("%10s %12s %12s %14s %14s %7s\n",
+           "report IDs", "hashed ns", "direct ns", "hashed visits", "direct visits", "ratio");
+
+    for ( UInt32 c = 0; c < sizeof(kReportIDCounts) / sizeof(kReportIDCounts[0]); c++ ) {
+        UInt32      reportIDs   = kReportIDCounts[c];
+        UInt32      count       = reportIDs * elementsPerReport;
+        Element **  elements    = (Element **) calloc(count, sizeof(Element *));
+        Table       hashed, direct;
+        double      hashedVisits, directVisits;
+
+        for ( UInt32 i = 0; i < count; i++ ) {
+            elements[i] = (Element *) calloc(1, sizeof(Element));
+            elements[i]->reportID = (UInt8) (1 + i / elementsPerReport);
+            elements[i]->reportStartBit = 8 + (i % elementsPerReport) * 8;
+            elements[i]->reportBits = 8;
+        }
+
+        // Shuffle the allocations so that chain order isn't memory order.
+        for ( UInt32 i = count - 1; i > 0; i-- ) {
+            UInt32 j = NextRandom() % (i + 1);
+            UInt8  reportID = elements[i]->reportID;
+            UInt32 startBit = elements[i]->reportStartBit;
+
+            elements[i]->reportID = elements[j]->reportID;
+            elements[i]->reportStartBit = elements[j]->reportStartBit;
+            elements[j]->reportID = reportID;
+            elements[j]->reportStartBit = startBit;
+        }
+
+        BuildTable(&hashed, 8, elements, count);
+        double hashedNs = Measure(&hashed, reportIDs, reports, seconds, &hashedVisits);
+
+        BuildTable(&direct, 256, elements, count);
+        double directNs = Measure(&direct, reportIDs, reports, seconds, &directVisits);
+
+        printf("%10u %12.1f %12.1f %14.1f %14.1f %7.2f\n",
+               reportIDs, hashedNs, directNs, hashedVisits, directVisits, hashedNs / directNs);
+
+        free(hashed.head);
+        free(direct.head);
+        for ( UInt32 i = 0; i < count; i++ )
+            free(elements[i]);
+        free(elements);
+    }
+
+    return 0;
+}
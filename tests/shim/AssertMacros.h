@@ -0,0 +1,22 @@
+/*
+ * Host build shim for the <AssertMacros.h> macros the HID sources use.
+ */
+#ifndef _HOST_SHIM_ASSERTMACROS_H
+#define _HOST_SHIM_ASSERTMACROS_H
+
+#define require(assertion, label) \
+    do { if ( __builtin_expect(!(assertion), 0) ) goto label; } while ( 0 )
+
+#define require_action(assertion, label, action) \
+    do { if ( __builtin_expect(!(assertion), 0) ) { { action; } goto label; } } while ( 0 )
+
+#define require_noerr(errorCode, label) \
+    require((errorCode) == 0, label)
+
+#define require_noerr_action(errorCode, label, action) \
+    require_action((errorCode) == 0, label, action)
+
+#define check(assertion)        do { (void) (assertion); } while ( 0 )
+#define verify(assertion)       do { (void) (assertion); } while ( 0 )
+
+#endif /* _HOST_SHIM_ASSERTMACROS_H */
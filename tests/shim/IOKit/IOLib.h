@@ -0,0 +1,45 @@
+/*
+ * Host build shim for the kernel allocator, lock, clock and libkern calls
+ * the HID sources make.
+ *
+ * Every allocation and free is counted in gIOHostAllocations and
+ * gIOHostFrees so the tests and benchmarks can report allocator traffic.
+ * IOFree aborts if it is not given the size the block was allocated with.
+ */
+#ifndef _HOST_SHIM_IOLIB_H
+#define _HOST_SHIM_IOLIB_H
+
+#include <IOKit/IOTypes.h>
+#include <IOKit/IOLocks.h>
+#include <libkern/OSAtomic.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern UInt64 gIOHostAllocations;
+extern UInt64 gIOHostFrees;
+
+void *  IOMalloc(vm_size_t size);
+void    IOFree(void * address, vm_size_t size);
+void *  IOMallocAligned(vm_size_t size, vm_size_t alignment);
+void    IOFreeAligned(void * address, vm_size_t size);
+
+#define IOLog   printf
+
+// kern/clock.h, in nanoseconds
+UInt64  mach_absolute_time(void);
+void    absolutetime_to_nanoseconds(UInt64 abstime, UInt64 * result);
+void    nanoseconds_to_absolutetime(UInt64 nanoseconds, UInt64 * result);
+
+// libkern/libkern.h
+static inline unsigned int min(unsigned int a, unsigned int b) { return (a < b ? a : b); }
+static inline unsigned int max(unsigned int a, unsigned int b) { return (a > b ? a : b); }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _HOST_SHIM_IOLIB_H */
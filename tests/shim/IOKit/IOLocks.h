@@ -0,0 +1,24 @@
+/*
+ * Host build shim for the IOSimpleLock calls the HID sources make.
+ */
+#ifndef _HOST_SHIM_IOLOCKS_H
+#define _HOST_SHIM_IOLOCKS_H
+
+#include <IOKit/IOTypes.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct IOSimpleLock IOSimpleLock;
+
+IOSimpleLock *  IOSimpleLockAlloc(void);
+void            IOSimpleLockFree(IOSimpleLock * lock);
+void            IOSimpleLockLock(IOSimpleLock * lock);
+void            IOSimpleLockUnlock(IOSimpleLock * lock);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _HOST_SHIM_IOLOCKS_H */
@@ -0,0 +1,55 @@
+/*
+ * Host build shim for the subset of <IOKit/IOTypes.h> the HID sources use.
+ */
+#ifndef _HOST_SHIM_IOTYPES_H
+#define _HOST_SHIM_IOTYPES_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <strings.h>
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) \
+    && !defined(__LITTLE_ENDIAN__) && !defined(HOST_SHIM_NO_LITTLE_ENDIAN)
+#define __LITTLE_ENDIAN__   1
+#endif
+
+typedef uint8_t         UInt8;
+typedef uint16_t        UInt16;
+typedef uint32_t        UInt32;
+typedef uint64_t        UInt64;
+typedef int8_t          SInt8;
+typedef int16_t         SInt16;
+typedef int32_t         SInt32;
+typedef int64_t         SInt64;
+typedef unsigned char   Boolean;
+typedef SInt32          OSStatus;
+typedef UInt32          IOOptionBits;
+typedef SInt32          IOFixed;
+typedef int             IOReturn;
+typedef uintptr_t       vm_size_t;
+typedef uintptr_t       vm_address_t;
+typedef vm_size_t       IOByteCount;
+typedef UInt64          AbsoluteTime;
+typedef int             boolean_t;
+typedef unsigned int    natural_t;
+
+#define AbsoluteTime_to_scalar(x)   (*(uint64_t *)(x))
+#define CMP_ABSOLUTETIME(t1, t2) \
+    (AbsoluteTime_to_scalar(t1) > AbsoluteTime_to_scalar(t2) ? 1 : \
+     (AbsoluteTime_to_scalar(t1) < AbsoluteTime_to_scalar(t2) ? -1 : 0))
+#define ADD_ABSOLUTETIME(t1, t2)    (AbsoluteTime_to_scalar(t1) += AbsoluteTime_to_scalar(t2))
+#define SUB_ABSOLUTETIME(t1, t2)    (AbsoluteTime_to_scalar(t1) -= AbsoluteTime_to_scalar(t2))
+
+#ifndef __unused
+#define __unused            __attribute__((unused))
+#endif
+
+#ifndef __private_extern__
+#define __private_extern__  __attribute__((visibility("hidden")))
+#endif
+
+#define kIOReturnSuccess    0
+
+#endif /* _HOST_SHIM_IOTYPES_H */
@@ -0,0 +1 @@
+#include "../../../../IOHIDFamily/IOHIDEvent.h"
@@ -0,0 +1 @@
+#include "../../../../IOHIDFamily/IOHIDEventTypes.h"
@@ -0,0 +1,4 @@
+/*
+ * Host build shim: the usage tables live in IOHIDFamily.
+ */
+#include "../../../../IOHIDFamily/IOHIDUsageTables.h"
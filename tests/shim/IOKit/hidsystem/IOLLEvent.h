@@ -0,0 +1,4 @@
+/*
+ * Host build shim: the HID sources built for the host use nothing from
+ * <IOKit/hidsystem/IOLLEvent.h>, whose dependencies are not available.
+ */
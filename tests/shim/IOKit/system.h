@@ -0,0 +1,4 @@
+/*
+ * Host build shim for <IOKit/system.h>.
+ */
+#include <IOKit/IOTypes.h>
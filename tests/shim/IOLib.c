@@ -0,0 +1,115 @@
+/*
+ * Host build shim for the kernel allocator, locks and clock.
+ */
+#include <IOKit/IOLib.h>
+#include <pthread.h>
+#include <time.h>
+
+UInt64 gIOHostAllocations   = 0;
+UInt64 gIOHostFrees         = 0;
+
+// Each IOMalloc block starts with its size so that IOFree can check the
+// size it is handed, as kalloc zones effectively do.
+#define kIOHostHeaderSize   16
+
+void * IOMalloc(vm_size_t size)
+{
+    UInt8 * block = (UInt8 *) malloc(size + kIOHostHeaderSize);
+
+    if ( !block )
+        return NULL;
+
+    __atomic_add_fetch(&gIOHostAllocations, 1, __ATOMIC_RELAXED);
+    *(vm_size_t *) block = size;
+
+    return block + kIOHostHeaderSize;
+}
+
+void IOFree(void * address, vm_size_t size)
+{
+    UInt8 * block;
+
+    if ( !address )
+        return;
+
+    block = (UInt8 *) address - kIOHostHeaderSize;
+    if ( *(vm_size_t *) block != size ) {
+        fprintf(stderr, "IOFree: %p allocated with size %lu, freed with size %lu\n",
+                address, (unsigned long) *(vm_size_t *) block, (unsigned long) size);
+        abort();
+    }
+
+    __atomic_add_fetch(&gIOHostFrees, 1, __ATOMIC_RELAXED);
+    free(block);
+}
+
+void * IOMallocAligned(vm_size_t size, vm_size_t alignment)
+{
+    void * mem = NULL;
+
+    if ( alignment < sizeof(void *) )
+        alignment = sizeof(void *);
+
+    __atomic_add_fetch(&gIOHostAllocations, 1, __ATOMIC_RELAXED);
+    if ( posix_memalign(&mem, alignment, size ? size : 1) != 0 )
+        return NULL;
+
+    return mem;
+}
+
+void IOFreeAligned(void * address, vm_size_t size)
+{
+    (void) size;
+    if ( address ) {
+        __atomic_add_fetch(&gIOHostFrees, 1, __ATOMIC_RELAXED);
+        free(address);
+    }
+}
+
+struct IOSimpleLock {
+    pthread_mutex_t mutex;
+};
+
+IOSimpleLock * IOSimpleLockAlloc(void)
+{
+    IOSimpleLock * lock = (IOSimpleLock *) IOMalloc(sizeof(IOSimpleLock));
+
+    if ( lock )
+        pthread_mutex_init(&lock->mutex, NULL);
+
+    return lock;
+}
+
+void IOSimpleLockFree(IOSimpleLock * lock)
+{
+    pthread_mutex_destroy(&lock->mutex);
+    IOFree(lock, sizeof(IOSimpleLock));
+}
+
+void IOSimpleLockLock(IOSimpleLock * lock)
+{
+    pthread_mutex_lock(&lock->mutex);
+}
+
+void IOSimpleLockUnlock(IOSimpleLock * lock)
+{
+    pthread_mutex_unlock(&lock->mutex);
+}
+
+UInt64 mach_absolute_time(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (UInt64) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void absolutetime_to_nanoseconds(UInt64 abstime, UInt64 * result)
+{
+    *result = abstime;
+}
+
+void nanoseconds_to_absolutetime(UInt64 nanoseconds, UInt64 * result)
+{
+    *result = nanoseconds;
+}
@@ -0,0 +1,36 @@
+/*
+ * Host build shim for OSObject.
+ */
+#include <libkern/c++/OSObject.h>
+#include <IOKit/IOLib.h>
+
+void OSObject::retain() const
+{
+    OSIncrementAtomic(&retainCount);
+}
+
+void OSObject::release() const
+{
+    if ( OSDecrementAtomic(&retainCount) == 1 )
+        const_cast<OSObject *>(this)->free();
+}
+
+void OSObject::free()
+{
+    delete this;
+}
+
+void * OSObject::operator new(size_t size)
+{
+    void * mem = IOMalloc(size);
+
+    if ( mem )
+        bzero(mem, size);
+
+    return mem;
+}
+
+void OSObject::operator delete(void * mem, size_t size)
+{
+    IOFree(mem, size);
+}
@@ -0,0 +1,14 @@
+/*
+ * Host build shim: the host is neither an embedded nor an iOS target.
+ */
+#ifndef _HOST_SHIM_TARGETCONDITIONALS_H
+#define _HOST_SHIM_TARGETCONDITIONALS_H
+
+#ifndef TARGET_OS_EMBEDDED
+#define TARGET_OS_EMBEDDED  0
+#endif
+#ifndef TARGET_OS_IPHONE
+#define TARGET_OS_IPHONE    0
+#endif
+
+#endif /* _HOST_SHIM_TARGETCONDITIONALS_H */
@@ -0,0 +1,6 @@
+/*
+ * Host build shim: the host has no Ironside event types.
+ */
+#ifndef IRONSIDE_AVAILABLE
+#define IRONSIDE_AVAILABLE  0
+#endif
@@ -0,0 +1,25 @@
+/*
+ * Host build shim for <libkern/OSAtomic.h>.
+ */
+#ifndef _HOST_SHIM_OSATOMIC_H
+#define _HOST_SHIM_OSATOMIC_H
+
+#include <IOKit/IOTypes.h>
+
+static inline Boolean OSCompareAndSwapPtr(void * oldValue, void * newValue, void * volatile * address)
+{
+    return __atomic_compare_exchange_n(address, &oldValue, newValue, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+#define OSCompareAndSwapPtr(a, b, c) (OSCompareAndSwapPtr(a, b, (void * volatile *) (c)))
+
+static inline SInt32 OSIncrementAtomic(volatile SInt32 * address)
+{
+    return __atomic_fetch_add(address, 1, __ATOMIC_SEQ_CST);
+}
+
+static inline SInt32 OSDecrementAtomic(volatile SInt32 * address)
+{
+    return __atomic_fetch_sub(address, 1, __ATOMIC_SEQ_CST);
+}
+
+#endif /* _HOST_SHIM_OSATOMIC_H */
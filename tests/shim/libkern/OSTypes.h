@@ -0,0 +1,4 @@
+/*
+ * Host build shim for <libkern/OSTypes.h>.
+ */
+#include <IOKit/IOTypes.h>
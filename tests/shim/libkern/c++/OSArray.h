@@ -0,0 +1,5 @@
+/*
+ * Host build shim for <libkern/c++/OSArray.h>.  Nothing built for the host
+ * uses OSArray yet.
+ */
+#include <libkern/c++/OSObject.h>
@@ -0,0 +1,61 @@
+/*
+ * Host build shim for OSObject.
+ *
+ * Objects are reference counted and freed through free() as in libkern,
+ * but there is no metaclass registry: the structor macros only declare and
+ * define the constructor and destructor.
+ */
+#ifndef _HOST_SHIM_OSOBJECT_H
+#define _HOST_SHIM_OSOBJECT_H
+
+#include <IOKit/IOTypes.h>
+#include <libkern/OSAtomic.h>
+
+#define OSDeclareCommonStructors(className)             \
+    protected:                                          \
+        virtual ~className();
+
+#define OSDeclareDefaultStructors(className)            \
+    OSDeclareCommonStructors(className)                 \
+    public:                                             \
+        className();                                    \
+    protected:
+
+#define OSDeclareAbstractStructors(className)           \
+    OSDeclareCommonStructors(className)                 \
+    private:                                            \
+        className();                                    \
+    protected:
+
+#define OSDefineMetaClassAndStructors(className, superclassName)    \
+    className::className() : superclassName() {}                    \
+    className::~className() {}
+
+#define OSDefineMetaClassAndAbstractStructors(className, superclassName) \
+    OSDefineMetaClassAndStructors(className, superclassName)
+
+#define OSMetaClassDeclareReservedUnused(className, index)
+#define OSMetaClassDefineReservedUnused(className, index)
+
+class OSObject
+{
+    mutable volatile SInt32 retainCount;
+
+protected:
+    virtual ~OSObject() {}
+    virtual void free();
+
+public:
+    OSObject() : retainCount(1) {}
+
+    virtual bool init() { return true; }
+
+    virtual void retain() const;
+    virtual void release() const;
+    virtual int getRetainCount() const { return retainCount; }
+
+    static void * operator new(size_t size);
+    static void operator delete(void * mem, size_t size);
+};
+
+#endif /* _HOST_SHIM_OSOBJECT_H */
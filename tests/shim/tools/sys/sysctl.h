@@ -0,0 +1,4 @@
+/*
+ * Host build shim: IOHIDReportDescriptorParser.c includes sys/sysctl.h but
+ * uses nothing from it, and newer C libraries no longer ship it.
+ */
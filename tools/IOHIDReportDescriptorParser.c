@@ -9,6 +9,7 @@
 #include <string.h>
 #include <limits.h>
 #include <stdarg.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -683,3 +684,410 @@ void PrintHIDDescriptor(const uint8_t *reportDesc, uint32_t length)
         printf("%s%s\n",buf, bufvalue);
     }
 }
+
+//------------------------------------------------------------------------------
+// Report extractor generation
+//------------------------------------------------------------------------------
+
+enum
+{
+    kExtractorReportTypeInput       = 0,
+    kExtractorReportTypeOutput      = 1,
+    kExtractorReportTypeFeature     = 2,
+    kExtractorReportTypeCount       = 3
+};
+
+enum
+{
+    kExtractorMaxReportIDs          = 256,
+    kExtractorMaxGlobalsNesting     = 16
+};
+
+typedef struct _ExtractorUsage {
+    uint32_t    usagePage;
+    uint32_t    usageMin;
+    uint32_t    usageMax;
+} ExtractorUsage;
+
+typedef struct _ExtractorGlobals {
+    uint32_t    usagePage;
+    int32_t     logicalMin;
+    int32_t     logicalMax;
+    uint32_t    reportSize;
+    uint32_t    reportCount;
+    uint32_t    reportID;
+} ExtractorGlobals;
+
+typedef struct _ExtractorField {
+    uint32_t    reportType;
+    uint32_t    reportID;
+    uint32_t    startBit;
+    uint32_t    size;
+    uint32_t    usagePage;
+    uint32_t    usage;
+    int32_t     logicalMin;
+    int32_t     logicalMax;
+    bool        isSigned;
+    bool        isReversed;
+} ExtractorField;
+
+static const char * ExtractorReportTypeNames[kExtractorReportTypeCount] = { "Input", "Output", "Feature" };
+
+static ExtractorUsage ExtractorUsageFromIndex(const ExtractorUsage * usages, uint32_t usageCount, uint32_t index)
+{
+    ExtractorUsage  result = usages[usageCount-1];
+    uint32_t        i;
+    
+    // Same mapping as HIDUsageAndPageFromIndex: ranges are expanded in order,
+    // and any remaining report count takes the last usage
+    result.usageMin = result.usageMax;
+    for ( i=0; i<usageCount; i++ ) {
+        uint32_t count = usages[i].usageMax - usages[i].usageMin + 1;
+        
+        if ( index < count ) {
+            result.usagePage = usages[i].usagePage;
+            result.usageMin = result.usageMax = usages[i].usageMin + index;
+            break;
+        }
+        index -= count;
+    }
+    
+    return result;
+}
+
+static void PrintExtractorFieldName(const ExtractorField * fields, uint32_t fieldIndex)
+{
+    const ExtractorField *  field       = &fields[fieldIndex];
+    uint32_t                duplicates  = 0;
+    uint32_t                i;
+    
+    // the first field for a usage keeps the plain name, later ones in the
+    // same report get a suffix
+    for ( i=0; i<fieldIndex; i++ ) {
+        if ( fields[i].reportType == field->reportType && fields[i].reportID == field->reportID &&
+             fields[i].usagePage == field->usagePage && fields[i].usage == field->usage )
+            duplicates++;
+    }
+    
+    printf("Usage_%04X_%04X", field->usagePage, field->usage);
+    if ( duplicates )
+        printf("_%u", duplicates);
+}
+
+void PrintHIDDescriptorExtractors(const uint8_t *reportDesc, uint32_t length, const char * name)
+{
+    const uint8_t *         start           = reportDesc;
+    const uint8_t *         end             = reportDesc + length;
+    ExtractorGlobals        globals         = { 0 };
+    ExtractorGlobals        globalsStack[kExtractorMaxGlobalsNesting];
+    uint32_t                globalsNesting  = 0;
+    ExtractorUsage *        usages          = NULL;
+    uint32_t                usageCount      = 0;
+    uint32_t                usageCapacity   = 0;
+    bool                    haveUsageMin    = false;
+    bool                    haveUsageMax    = false;
+    ExtractorUsage          usageRange      = { 0 };
+    ExtractorUsage          usageItem;
+    ExtractorField *        fields          = NULL;
+    uint32_t                fieldCount      = 0;
+    uint32_t                fieldCapacity   = 0;
+    uint32_t                bitCount[kExtractorReportTypeCount][kExtractorMaxReportIDs];
+    bool                    reportSeen[kExtractorMaxReportIDs];
+    bool                    hasReportIDs    = false;
+    uint32_t                reportType, reportID, index;
+    
+    memset(bitCount, 0, sizeof(bitCount));
+    memset(reportSeen, 0, sizeof(reportSeen));
+    reportSeen[0] = true;
+    
+    // Walk the descriptor, tracking the bit position of every field in the
+    // same way as the kernel descriptor parser
+    while (reportDesc < end)
+    {
+        uint8_t     size, type, tag;
+        uint32_t    value   = 0;
+        int32_t     svalue  = 0;
+        int         i;
+        
+        size = UnpackReportSize(*reportDesc);
+        if (size == 3) size = 4;
+        type = UnpackReportType(*reportDesc);
+        tag = UnpackReportTag(*reportDesc);
+        reportDesc++;
+        
+        if (tag == kReport_TagLongItem) {
+            if ( reportDesc + 2 > end )
+                break;
+            size = reportDesc[0];
+            reportDesc += 2 + size;
+            continue;
+        }
+        
+        if ( reportDesc + size > end )
+            break;
+        for (i = 0; i < size; i++)
+            value += reportDesc[i] << (i * 8);
+        reportDesc += size;
+        
+        switch (size) {
+            case 1: svalue = (int8_t) value; break;
+            case 2: svalue = (int16_t) value; break;
+            case 4: svalue = (int32_t) value; break;
+        }
+        
+        switch (type) {
+            case kReport_TypeMain:
+                switch (tag) {
+                    case kReport_TagInput:
+                    case kReport_TagOutput:
+                    case kReport_TagFeature:
+                        reportType = (tag == kReport_TagInput) ? kExtractorReportTypeInput :
+                                     (tag == kReport_TagOutput) ? kExtractorReportTypeOutput : kExtractorReportTypeFeature;
+                        
+                        // Variable items with usages, as HIDIsVariable sees them
+                        if ( (value & kIO_Array_or_Variable) && usageCount && globals.reportSize && globals.reportSize <= 32 ) {
+                            int32_t logicalMin  = globals.logicalMin;
+                            int32_t logicalMax  = globals.logicalMax;
+                            int32_t realMax     = (int32_t)((1u << ((globals.reportSize >= 32) ? 31 : globals.reportSize)) - 1);
+                            bool    isReversed  = false;
+                            
+                            if ( logicalMin > realMax )
+                                logicalMin = 0;
+                            if ( logicalMax > realMax )
+                                logicalMax = realMax;
+                            if ( logicalMin > logicalMax ) {
+                                int32_t temp = logicalMax;
+                                logicalMax = logicalMin;
+                                logicalMin = temp;
+                                isReversed = true;
+                            }
+                            
+                            for ( index=0; index<globals.reportCount; index++ ) {
+                                ExtractorUsage  usage = ExtractorUsageFromIndex(usages, usageCount, index);
+                                ExtractorField *field;
+                                
+                                if ( fieldCount == fieldCapacity ) {
+                                    ExtractorField * newFields;
+                                    
+                                    fieldCapacity = fieldCapacity ? fieldCapacity * 2 : 64;
+                                    newFields = realloc(fields, fieldCapacity * sizeof(ExtractorField));
+                                    if ( !newFields ) {
+                                        free(usages);
+                                        free(fields);
+                                        return;
+                                    }
+                                    fields = newFields;
+                                }
+                                field = &fields[fieldCount++];
+                                field->reportType   = reportType;
+                                field->reportID     = globals.reportID;
+                                field->startBit     = bitCount[reportType][globals.reportID] + (index * globals.reportSize);
+                                field->size         = globals.reportSize;
+                                field->usagePage    = usage.usagePage;
+                                field->usage        = usage.usageMin;
+                                field->logicalMin   = logicalMin;
+                                field->logicalMax   = logicalMax;
+                                field->isSigned     = (logicalMin < 0) || (logicalMax < 0);
+                                field->isReversed   = isReversed;
+                            }
+                        }
+                        
+                        bitCount[reportType][globals.reportID] += globals.reportSize * globals.reportCount;
+                        usageCount = 0;
+                        haveUsageMin = haveUsageMax = false;
+                        break;
+                        
+                    case kReport_TagCollection:
+                    case kReport_TagEndCollection:
+                        usageCount = 0;
+                        haveUsageMin = haveUsageMax = false;
+                        break;
+                }
+                break;
+                
+            case kReport_TypeGlobal:
+                switch (tag) {
+                    case kReport_TagUsagePage:      globals.usagePage = value; break;
+                    case kReport_TagLogicalMin:     globals.logicalMin = svalue; break;
+                    case kReport_TagLogicalMax:     globals.logicalMax = svalue; break;
+                    case kReport_TagReportSize:     globals.reportSize = value; break;
+                    case kReport_TagReportCount:    globals.reportCount = value; break;
+                    case kReport_TagReportID:
+                        globals.reportID = value & 0xFF;
+                        if ( !reportSeen[globals.reportID] ) {
+                            // reports with an ID start after the ID byte
+                            reportSeen[globals.reportID] = true;
+                            for ( index=0; index<kExtractorReportTypeCount; index++ )
+                                bitCount[index][globals.reportID] = 8;
+                            hasReportIDs = true;
+                        }
+                        break;
+                    case kReport_TagPush:
+                        if ( globalsNesting < kExtractorMaxGlobalsNesting )
+                            globalsStack[globalsNesting++] = globals;
+                        break;
+                    case kReport_TagPop:
+                        if ( globalsNesting )
+                            globals = globalsStack[--globalsNesting];
+                        break;
+                }
+                break;
+                
+            case kReport_TypeLocal:
+                switch (tag) {
+                    case kReport_TagUsage:
+                        usageItem.usagePage = (size == 4) ? (value >> 16) : globals.usagePage;
+                        usageItem.usageMin = usageItem.usageMax = (size == 4) ? (value & 0xFFFF) : value;
+                        break;
+                    case kReport_TagUsageMin:
+                        usageRange.usagePage = (size == 4) ? (value >> 16) : globals.usagePage;
+                        usageRange.usageMin = (size == 4) ? (value & 0xFFFF) : value;
+                        haveUsageMin = true;
+                        break;
+                    case kReport_TagUsageMax:
+                        usageRange.usageMax = (size == 4) ? (value & 0xFFFF) : value;
+                        haveUsageMax = true;
+                        break;
+                    default:
+                        continue;
+                }
+                
+                // add the usage, or the range once both of its ends have been seen
+                if ( tag != kReport_TagUsage ) {
+                    if ( !haveUsageMin || !haveUsageMax )
+                        break;
+                    haveUsageMin = haveUsageMax = false;
+                    if ( usageRange.usageMax < usageRange.usageMin )
+                        break;
+                    usageItem = usageRange;
+                }
+                if ( usageCount == usageCapacity ) {
+                    ExtractorUsage * newUsages;
+                    
+                    usageCapacity = usageCapacity ? usageCapacity * 2 : 16;
+                    newUsages = realloc(usages, usageCapacity * sizeof(ExtractorUsage));
+                    if ( !newUsages ) {
+                        free(usages);
+                        free(fields);
+                        return;
+                    }
+                    usages = newUsages;
+                }
+                usages[usageCount++] = usageItem;
+                break;
+        }
+    }
+    
+    printf("//\n");
+    printf("//  %s.h\n", name);
+    printf("//\n");
+    printf("//  Generated by IOHIDReportDescriptorParser from a %u byte report descriptor.\n", (uint32_t)(end - start));
+    printf("//  Each report struct decodes its variable fields with offsets and sizes\n");
+    printf("//  fixed at compile time.  A field's value is its raw bits, sign extended\n");
+    printf("//  when the logical range is negative and mirrored when it is reversed.\n");
+    printf("//  These are not always the values HIDGetUsageValue returns; they can\n");
+    printf("//  differ for 1 bit button fields and for usages inside usage ranges.\n");
+    printf("//\n\n");
+    printf("#ifndef %s_h\n", name);
+    printf("#define %s_h\n\n", name);
+    printf("#include <stddef.h>\n");
+    printf("#include <stdint.h>\n\n");
+    printf("namespace %s {\n\n", name);
+    
+    printf("template <uint32_t StartBit, uint32_t Size, bool Signed, bool Reversed = false, int32_t LogicalMin = 0, int32_t LogicalMax = 0>\n");
+    printf("struct Field\n");
+    printf("{\n");
+    printf("    static constexpr uint32_t startBit  = StartBit;\n");
+    printf("    static constexpr uint32_t size      = Size;\n");
+    printf("    static constexpr uint32_t firstByte = StartBit / 8;\n");
+    printf("    static constexpr uint32_t lastBit   = StartBit + Size - 1;\n");
+    printf("    static constexpr uint32_t lastByte  = lastBit / 8;\n\n");
+    printf("    static inline int32_t extract(const uint8_t * report)\n");
+    printf("    {\n");
+    printf("        // up to 7 leading bits and 32 field bits span 5 bytes\n");
+    printf("        uint64_t bytes = 0;\n");
+    printf("        uint32_t data;\n\n");
+    printf("        for ( uint32_t index = lastByte + 1; index-- > firstByte; )\n");
+    printf("            bytes = (bytes << 8) | (report[index] & ((index == lastByte) ? ((1u << ((lastBit %% 8) + 1)) - 1) : 0xFFu));\n");
+    printf("        data = (uint32_t)(bytes >> (StartBit %% 8));\n\n");
+    printf("        if ( Signed ) {\n");
+    printf("            const uint32_t signBit    = 1u << (Size - 1);\n");
+    printf("            const uint32_t extendMask = (signBit << 1) - 1;\n");
+    printf("            data = (data & signBit) ? (data | ~extendMask) : (data & extendMask);\n");
+    printf("        }\n\n");
+    printf("        if ( Reversed )\n");
+    printf("            return (LogicalMin - (int32_t)data) + LogicalMax;\n\n");
+    printf("        return (int32_t)data;\n");
+    printf("    }\n");
+    printf("};\n\n");
+    
+    for ( reportType=0; reportType<kExtractorReportTypeCount; reportType++ ) {
+        for ( reportID=0; reportID<kExtractorMaxReportIDs; reportID++ ) {
+            if ( !bitCount[reportType][reportID] )
+                continue;
+            
+            for ( index=0; index<fieldCount; index++ ) {
+                if ( fields[index].reportType == reportType && fields[index].reportID == reportID )
+                    break;
+            }
+            if ( index == fieldCount )
+                continue;
+            
+            printf("struct %sReport%u\n", ExtractorReportTypeNames[reportType], reportID);
+            printf("{\n");
+            printf("    static constexpr uint8_t  reportID = %u;\n", reportID);
+            printf("    static constexpr size_t   length   = %u;\n\n", (bitCount[reportType][reportID] + 7) / 8);
+            
+            for ( index=0; index<fieldCount; index++ ) {
+                const ExtractorField * field = &fields[index];
+                
+                if ( field->reportType != reportType || field->reportID != reportID )
+                    continue;
+                
+                printf("    typedef Field<%u, %u, %s", field->startBit, field->size, field->isSigned ? "true" : "false");
+                if ( field->isReversed )
+                    printf(", true, %d, %d", field->logicalMin, field->logicalMax);
+                printf("> ");
+                PrintExtractorFieldName(fields, index);
+                printf(";\n");
+            }
+            
+            printf("\n    struct Values\n");
+            printf("    {\n");
+            for ( index=0; index<fieldCount; index++ ) {
+                if ( fields[index].reportType != reportType || fields[index].reportID != reportID )
+                    continue;
+                printf("        int32_t ");
+                PrintExtractorFieldName(fields, index);
+                printf(";\n");
+            }
+            printf("    };\n\n");
+            
+            printf("    static inline bool decode(const uint8_t * report, size_t reportLength, Values * values)\n");
+            printf("    {\n");
+            if ( hasReportIDs )
+                printf("        if ( reportLength < length || report[0] != reportID )\n");
+            else
+                printf("        if ( reportLength < length )\n");
+            printf("            return false;\n\n");
+            for ( index=0; index<fieldCount; index++ ) {
+                if ( fields[index].reportType != reportType || fields[index].reportID != reportID )
+                    continue;
+                printf("        values->");
+                PrintExtractorFieldName(fields, index);
+                printf(" = ");
+                PrintExtractorFieldName(fields, index);
+                printf("::extract(report);\n");
+            }
+            printf("        return true;\n");
+            printf("    }\n");
+            printf("};\n\n");
+        }
+    }
+    
+    printf("} // namespace %s\n\n", name);
+    printf("#endif /* %s_h */\n", name);
+    
+    free(usages);
+    free(fields);
+}
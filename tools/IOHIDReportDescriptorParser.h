@@ -14,4 +14,7 @@
 
 extern void PrintHIDDescriptor(const uint8_t *reportDesc, uint32_t length);
 
+// Prints a C++ header that decodes each report of the descriptor without parsing it
+extern void PrintHIDDescriptorExtractors(const uint8_t *reportDesc, uint32_t length, const char * name);
+
 #endif /* IOHIDFamily_IOHIDReportParser_h */
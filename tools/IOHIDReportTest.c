@@ -8,6 +8,7 @@ static bool             gValue              = FALSE;
 static bool             gSend               = FALSE;
 static bool             gSendTransaction    = FALSE;
 static bool             gPrintDescriptor    = FALSE;
+static bool             gGenerateExtractors = FALSE;
 
 static CFMutableDictionaryRef   gOutputElements = NULL;
 
@@ -159,6 +160,15 @@ static void __deviceCallback(void * context, IOReturn result, void * sender, IOH
             }
         }
         
+        if ( gGenerateExtractors ) {
+            CFDataRef descriptor = NULL;
+            
+            descriptor = IOHIDDeviceGetProperty(device, CFSTR(kIOHIDReportDescriptorKey));
+            if ( descriptor ) {
+                PrintHIDDescriptorExtractors(CFDataGetBytePtr(descriptor), CFDataGetLength(descriptor), "HIDDevice");
+            }
+        }
+        
         if ( gPollInterval != 0.0 ) {
             CFRunLoopTimerContext   context = {.info=device};
             CFRunLoopTimerRef       timer   = CFRunLoopTimerCreate(kCFAllocatorDefault, CFAbsoluteTimeGetCurrent(), gPollInterval, 0, 0, __timerCallback, &context);
@@ -199,6 +209,7 @@ static void printHelp()
     printf("\n");
     printf("hidReportTest usage:\n\n");
     printf("\t-p    Parse descriptor data\n");
+    printf("\t-g    Generate report extractor header from descriptor data\n");
     printf("\t-i    Manually poll at a given interval (s)");
     printf("\t--usage <usage>\n");
     printf("\t--usagepage <usage page>\n");
@@ -222,6 +233,9 @@ int main (int argc, const char * argv[]) {
         else if ( 0 == strcmp("-p", argv[argi]) ) {
             gPrintDescriptor = TRUE;
         }
+        else if ( 0 == strcmp("-g", argv[argi]) ) {
+            gGenerateExtractors = TRUE;
+        }
         else if ( 0 == strcmp("-s", argv[argi]) ) {
             gSend = TRUE;
         }